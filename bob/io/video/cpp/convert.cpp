@@ -0,0 +1,1106 @@
+#include "convert.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <boost/format.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define BOB_IO_VIDEO_X86_SIMD 1
+#  include <immintrin.h>
+#endif
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * Converts a row of 'n' bytes into floats (or halfs), with scale and offset
+   */
+  typedef void (*row_kernel)(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst);
+
+  /**
+   * Converts 'n' bytes of packed pixels (a multiple of 3) into floats (or
+   * halfs), with per-band scale and offset
+   */
+  typedef void (*packed_kernel)(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst);
+
+  /**
+   * BT.601 YUV to RGB coefficients, with 16 fractional bits
+   */
+  struct YUVCoefficients {
+    int32_t y_offset;
+    int32_t y;
+    int32_t rv;
+    int32_t gu;
+    int32_t gv;
+    int32_t bu;
+  };
+
+  /**
+   * Converts 'width' pixels of a row, starting at pixel 'start', with
+   * each chroma sample covering two horizontally adjacent pixels
+   */
+  typedef void (*yuv_kernel)(const uint8_t* y, const uint8_t* u,
+      const uint8_t* v, size_t start, size_t width, const YUVCoefficients& c,
+      uint8_t* r, uint8_t* g, uint8_t* b);
+
+  /**
+   * RGB to YUV coefficients, with 16 fractional bits. Chroma is computed
+   * from sums of 4 pixels and adds CHROMA_BIAS.
+   */
+  struct RGBCoefficients {
+    int32_t yr;
+    int32_t yg;
+    int32_t yb;
+    int32_t y_bias; ///< luma offset and rounding
+    int32_t ur;
+    int32_t ug;
+    int32_t ub;
+    int32_t vr;
+    int32_t vg;
+    int32_t vb;
+  };
+
+  static const int32_t CHROMA_BIAS = (128 << 18) + (1 << 17);
+
+  /**
+   * Converts two rows of planar RGB pixels ('rows' holds their R, G and B
+   * bands: first row, then second row), starting at pixel 'start' (an even
+   * one), into two rows of luma and one row of chroma samples
+   */
+  typedef void (*rgb_kernel)(const uint8_t* const* rows, size_t start,
+      size_t width, const RGBCoefficients& c, uint8_t* y0, uint8_t* y1,
+      uint8_t* u, uint8_t* v);
+
+  /**
+   * Sums the absolute differences between 'n' bytes
+   */
+  typedef uint64_t (*sad_kernel)(const uint8_t* a, const uint8_t* b,
+      size_t n);
+
+  static inline uint16_t float_to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mantissa = x & 0x007fffff;
+    int32_t exponent = (x >> 23) & 0xff;
+
+    if (exponent == 0xff) //infinity or NaN
+      return sign | 0x7c00 | (mantissa? (0x0200 | (mantissa >> 13)) : 0);
+
+    exponent += 15 - 127;
+    if (exponent >= 0x1f) return sign | 0x7c00; //overflows to infinity
+
+    if (exponent <= 0) { //sub-normal
+      if (exponent < -10) return sign; //underflows to zero
+      mantissa |= 0x00800000;
+      uint32_t shift = 14 - exponent;
+      uint32_t half = mantissa >> shift;
+      uint32_t rest = mantissa & ((1u << shift) - 1);
+      uint32_t tie = 1u << (shift - 1);
+      if (rest > tie || (rest == tie && (half & 1))) ++half;
+      return sign | half;
+    }
+
+    uint32_t half = (exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) ++half; //may carry
+    return sign | half;
+  }
+
+  static void row_float32_scalar(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst) {
+    float* out = static_cast<float*>(dst);
+    for (size_t i=0; i<n; ++i) out[i] = float(src[i]) * scale + offset;
+  }
+
+  static void row_float16_scalar(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst) {
+    uint16_t* out = static_cast<uint16_t*>(dst);
+    for (size_t i=0; i<n; ++i)
+      out[i] = float_to_half(float(src[i]) * scale + offset);
+  }
+
+  static void packed_float32_scalar(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst) {
+    float* out = static_cast<float*>(dst);
+    for (size_t i=0; i<n; i+=3) {
+      out[i] = float(src[i]) * scale[0] + offset[0];
+      out[i+1] = float(src[i+1]) * scale[1] + offset[1];
+      out[i+2] = float(src[i+2]) * scale[2] + offset[2];
+    }
+  }
+
+  static void packed_float16_scalar(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst) {
+    uint16_t* out = static_cast<uint16_t*>(dst);
+    for (size_t i=0; i<n; i+=3) {
+      out[i] = float_to_half(float(src[i]) * scale[0] + offset[0]);
+      out[i+1] = float_to_half(float(src[i+1]) * scale[1] + offset[1]);
+      out[i+2] = float_to_half(float(src[i+2]) * scale[2] + offset[2]);
+    }
+  }
+
+  static inline uint8_t clamp_byte(int32_t value) {
+    return (value < 0)? 0 : ((value > 255)? 255 : value);
+  }
+
+  /**
+   * The reference: all other YUV kernels output exactly the same values
+   */
+  static void yuv_row_scalar(const uint8_t* y, const uint8_t* u,
+      const uint8_t* v, size_t start, size_t width, const YUVCoefficients& c,
+      uint8_t* r, uint8_t* g, uint8_t* b) {
+    for (size_t x=start; x<width; ++x) {
+      int32_t luma = (int32_t(y[x]) - c.y_offset) * c.y + (1 << 15);
+      int32_t cb = int32_t(u[x >> 1]) - 128;
+      int32_t cr = int32_t(v[x >> 1]) - 128;
+      r[x] = clamp_byte((luma + c.rv * cr) >> 16);
+      g[x] = clamp_byte((luma - c.gu * cb - c.gv * cr) >> 16);
+      b[x] = clamp_byte((luma + c.bu * cb) >> 16);
+    }
+  }
+
+  /**
+   * The reference: all other RGB kernels output exactly the same values
+   */
+  static void rgb_rows_scalar(const uint8_t* const* rows, size_t start,
+      size_t width, const RGBCoefficients& c, uint8_t* y0, uint8_t* y1,
+      uint8_t* u, uint8_t* v) {
+    const uint8_t* r0 = rows[0];
+    const uint8_t* g0 = rows[1];
+    const uint8_t* b0 = rows[2];
+    const uint8_t* r1 = rows[3];
+    const uint8_t* g1 = rows[4];
+    const uint8_t* b1 = rows[5];
+    for (size_t x=start; x<width; ++x) {
+      y0[x] = clamp_byte((c.yr * r0[x] + c.yg * g0[x] + c.yb * b0[x] +
+            c.y_bias) >> 16);
+      y1[x] = clamp_byte((c.yr * r1[x] + c.yg * g1[x] + c.yb * b1[x] +
+            c.y_bias) >> 16);
+    }
+    for (size_t x=start; x<width; x+=2) {
+      size_t next = (x + 1 < width)? x + 1 : x; //repeats the last column
+      int32_t r = r0[x] + r0[next] + r1[x] + r1[next];
+      int32_t g = g0[x] + g0[next] + g1[x] + g1[next];
+      int32_t b = b0[x] + b0[next] + b1[x] + b1[next];
+      u[x/2] = clamp_byte((c.ur * r + c.ug * g + c.ub * b + CHROMA_BIAS) >> 18);
+      v[x/2] = clamp_byte((c.vr * r + c.vg * g + c.vb * b + CHROMA_BIAS) >> 18);
+    }
+  }
+
+  static uint64_t sad_scalar(const uint8_t* a, const uint8_t* b, size_t n) {
+    uint64_t sum = 0;
+    for (size_t i=0; i<n; ++i) sum += (a[i] > b[i])? (a[i] - b[i]) : (b[i] - a[i]);
+    return sum;
+  }
+
+  /**
+   * Repeats the per-band values of packed pixels over 'n' lanes
+   */
+  static void repeat_bands(const float* values, size_t n, float* lanes) {
+    for (size_t i=0; i<n; ++i) lanes[i] = values[i % 3];
+  }
+
+#if defined(BOB_IO_VIDEO_X86_SIMD)
+
+  __attribute__((target("sse2")))
+  static void row_float32_sse2(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst) {
+    float* out = static_cast<float*>(dst);
+    const __m128 s = _mm_set1_ps(scale);
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i+16<=n; i+=16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+      __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+      __m128 v0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+      __m128 v1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+      __m128 v2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+      __m128 v3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(v0, s), o));
+      _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(v1, s), o));
+      _mm_storeu_ps(out + i + 8, _mm_add_ps(_mm_mul_ps(v2, s), o));
+      _mm_storeu_ps(out + i + 12, _mm_add_ps(_mm_mul_ps(v3, s), o));
+    }
+    row_float32_scalar(src + i, n - i, scale, offset, out + i);
+  }
+
+  __attribute__((target("sse2")))
+  static void row_float16_sse2(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst) {
+    //no half precision conversion before F16C: converts a chunk at a time
+    uint16_t* out = static_cast<uint16_t*>(dst);
+    float tmp[256];
+    for (size_t i=0; i<n; i+=256) {
+      size_t chunk = (n - i < 256)? (n - i) : 256;
+      row_float32_sse2(src + i, chunk, scale, offset, tmp);
+      for (size_t k=0; k<chunk; ++k) out[i + k] = float_to_half(tmp[k]);
+    }
+  }
+
+  /**
+   * Packed pixels are converted 12 bytes (4 pixels) at a time, so each
+   * vector lane always holds the same band
+   */
+  __attribute__((target("sse2")))
+  static void packed_float32_sse2(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst) {
+    float* out = static_cast<float*>(dst);
+    float s[12], o[12];
+    repeat_bands(scale, 12, s);
+    repeat_bands(offset, 12, o);
+    const __m128 s0 = _mm_loadu_ps(s), s1 = _mm_loadu_ps(s + 4), s2 = _mm_loadu_ps(s + 8);
+    const __m128 o0 = _mm_loadu_ps(o), o1 = _mm_loadu_ps(o + 4), o2 = _mm_loadu_ps(o + 8);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i+12<=n; i+=12) {
+      int32_t chunk[3];
+      std::memcpy(chunk, src + i, sizeof(chunk));
+      __m128i b0 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(chunk[0]), zero);
+      __m128i b1 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(chunk[1]), zero);
+      __m128i b2 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(chunk[2]), zero);
+      __m128 v0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(b0, zero));
+      __m128 v1 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(b1, zero));
+      __m128 v2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(b2, zero));
+      _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(v0, s0), o0));
+      _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_mul_ps(v1, s1), o1));
+      _mm_storeu_ps(out + i + 8, _mm_add_ps(_mm_mul_ps(v2, s2), o2));
+    }
+    packed_float32_scalar(src + i, n - i, scale, offset, out + i);
+  }
+
+  __attribute__((target("sse2")))
+  static void packed_float16_sse2(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst) {
+    //no half precision conversion before F16C: converts a chunk at a time
+    uint16_t* out = static_cast<uint16_t*>(dst);
+    float tmp[252]; //a multiple of 3
+    for (size_t i=0; i<n; i+=252) {
+      size_t chunk = (n - i < 252)? (n - i) : 252;
+      packed_float32_sse2(src + i, chunk, scale, offset, tmp);
+      for (size_t k=0; k<chunk; ++k) out[i + k] = float_to_half(tmp[k]);
+    }
+  }
+
+  __attribute__((target("sse2")))
+  static uint64_t sad_sse2(const uint8_t* a, const uint8_t* b, size_t n) {
+    __m128i sum = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i+16<=n; i+=16) {
+      __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(va, vb));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sum);
+    return lanes[0] + lanes[1] + sad_scalar(a + i, b + i, n - i);
+  }
+
+  __attribute__((target("avx2")))
+  static uint64_t sad_avx2(const uint8_t* a, const uint8_t* b, size_t n) {
+    __m256i sum = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i+32<=n; i+=32) {
+      __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+      __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(va, vb));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+      sad_scalar(a + i, b + i, n - i);
+  }
+
+  __attribute__((target("avx2")))
+  static void row_float32_avx2(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst) {
+    float* out = static_cast<float*>(dst);
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256 o = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for (; i+16<=n; i+=16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      __m256 v0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+      __m256 v1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+      _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(v0, s), o));
+      _mm256_storeu_ps(out + i + 8, _mm256_add_ps(_mm256_mul_ps(v1, s), o));
+    }
+    row_float32_scalar(src + i, n - i, scale, offset, out + i);
+  }
+
+  __attribute__((target("avx2,f16c")))
+  static void row_float16_avx2(const uint8_t* src, size_t n, float scale,
+      float offset, void* dst) {
+    uint16_t* out = static_cast<uint16_t*>(dst);
+    const __m256 s = _mm256_set1_ps(scale);
+    const __m256 o = _mm256_set1_ps(offset);
+    size_t i = 0;
+    for (; i+16<=n; i+=16) {
+      __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      __m256 v0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+      __m256 v1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+      v0 = _mm256_add_ps(_mm256_mul_ps(v0, s), o);
+      v1 = _mm256_add_ps(_mm256_mul_ps(v1, s), o);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+          _mm256_cvtps_ph(v0, _MM_FROUND_TO_NEAREST_INT));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+          _mm256_cvtps_ph(v1, _MM_FROUND_TO_NEAREST_INT));
+    }
+    row_float16_scalar(src + i, n - i, scale, offset, out + i);
+  }
+
+  /**
+   * Loads 8 bytes as 8 floats
+   */
+  __attribute__((target("avx2")))
+  static inline __m256 load8_avx2(const uint8_t* src) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(
+          _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))));
+  }
+
+  /**
+   * Packed pixels are converted 24 bytes (8 pixels) at a time, so each
+   * vector lane always holds the same band
+   */
+  __attribute__((target("avx2")))
+  static void packed_float32_avx2(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst) {
+    float* out = static_cast<float*>(dst);
+    float s[24], o[24];
+    repeat_bands(scale, 24, s);
+    repeat_bands(offset, 24, o);
+    const __m256 s0 = _mm256_loadu_ps(s), s1 = _mm256_loadu_ps(s + 8), s2 = _mm256_loadu_ps(s + 16);
+    const __m256 o0 = _mm256_loadu_ps(o), o1 = _mm256_loadu_ps(o + 8), o2 = _mm256_loadu_ps(o + 16);
+    size_t i = 0;
+    for (; i+24<=n; i+=24) {
+      __m256 v0 = load8_avx2(src + i);
+      __m256 v1 = load8_avx2(src + i + 8);
+      __m256 v2 = load8_avx2(src + i + 16);
+      _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(v0, s0), o0));
+      _mm256_storeu_ps(out + i + 8, _mm256_add_ps(_mm256_mul_ps(v1, s1), o1));
+      _mm256_storeu_ps(out + i + 16, _mm256_add_ps(_mm256_mul_ps(v2, s2), o2));
+    }
+    packed_float32_scalar(src + i, n - i, scale, offset, out + i);
+  }
+
+  __attribute__((target("avx2,f16c")))
+  static void packed_float16_avx2(const uint8_t* src, size_t n,
+      const float* scale, const float* offset, void* dst) {
+    uint16_t* out = static_cast<uint16_t*>(dst);
+    float s[24], o[24];
+    repeat_bands(scale, 24, s);
+    repeat_bands(offset, 24, o);
+    const __m256 s0 = _mm256_loadu_ps(s), s1 = _mm256_loadu_ps(s + 8), s2 = _mm256_loadu_ps(s + 16);
+    const __m256 o0 = _mm256_loadu_ps(o), o1 = _mm256_loadu_ps(o + 8), o2 = _mm256_loadu_ps(o + 16);
+    size_t i = 0;
+    for (; i+24<=n; i+=24) {
+      __m256 v0 = _mm256_add_ps(_mm256_mul_ps(load8_avx2(src + i), s0), o0);
+      __m256 v1 = _mm256_add_ps(_mm256_mul_ps(load8_avx2(src + i + 8), s1), o1);
+      __m256 v2 = _mm256_add_ps(_mm256_mul_ps(load8_avx2(src + i + 16), s2), o2);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+          _mm256_cvtps_ph(v0, _MM_FROUND_TO_NEAREST_INT));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+          _mm256_cvtps_ph(v1, _MM_FROUND_TO_NEAREST_INT));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 16),
+          _mm256_cvtps_ph(v2, _MM_FROUND_TO_NEAREST_INT));
+    }
+    packed_float16_scalar(src + i, n - i, scale, offset, out + i);
+  }
+
+  /**
+   * Computes 4 pixels from their luma and the chroma contributions of
+   * each, all in 32-bit lanes
+   */
+  __attribute__((target("sse4.1")))
+  static inline void yuv_pixels_sse41(__m128i y, __m128i rv, __m128i guv,
+      __m128i bu, __m128i y_offset, __m128i y_scale, __m128i& r, __m128i& g,
+      __m128i& b) {
+    __m128i luma = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(y, y_offset),
+          y_scale), _mm_set1_epi32(1 << 15));
+    r = _mm_srai_epi32(_mm_add_epi32(luma, rv), 16);
+    g = _mm_srai_epi32(_mm_sub_epi32(luma, guv), 16);
+    b = _mm_srai_epi32(_mm_add_epi32(luma, bu), 16);
+  }
+
+  /**
+   * Saturates 16 values in 32-bit lanes to bytes
+   */
+  __attribute__((target("sse4.1")))
+  static inline __m128i pack16_sse41(__m128i v0, __m128i v1, __m128i v2,
+      __m128i v3) {
+    return _mm_packus_epi16(_mm_packus_epi32(v0, v1),
+        _mm_packus_epi32(v2, v3));
+  }
+
+  /**
+   * Saturates 16 values in 32-bit lanes to bytes and stores them
+   */
+  __attribute__((target("sse4.1")))
+  static inline void store16_sse41(uint8_t* dst, __m128i v0, __m128i v1,
+      __m128i v2, __m128i v3) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+        pack16_sse41(v0, v1, v2, v3));
+  }
+
+  /**
+   * Converts 16 pixels (8 chroma samples) at a time
+   */
+  __attribute__((target("sse4.1")))
+  static void yuv_row_sse41(const uint8_t* y, const uint8_t* u,
+      const uint8_t* v, size_t start, size_t width, const YUVCoefficients& c,
+      uint8_t* r, uint8_t* g, uint8_t* b) {
+    const __m128i y_offset = _mm_set1_epi32(c.y_offset);
+    const __m128i y_scale = _mm_set1_epi32(c.y);
+    const __m128i c_rv = _mm_set1_epi32(c.rv), c_gu = _mm_set1_epi32(c.gu);
+    const __m128i c_gv = _mm_set1_epi32(c.gv), c_bu = _mm_set1_epi32(c.bu);
+    const __m128i bias = _mm_set1_epi32(128);
+    size_t x = start;
+    for (; x+16<=width; x+=16) {
+      __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+      __m128i cb8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x/2));
+      __m128i cr8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x/2));
+      __m128i rs[4], gs[4], bs[4];
+      for (int half=0; half<2; ++half) {
+        if (half) {
+          cb8 = _mm_srli_si128(cb8, 4);
+          cr8 = _mm_srli_si128(cr8, 4);
+        }
+        __m128i cb = _mm_sub_epi32(_mm_cvtepu8_epi32(cb8), bias);
+        __m128i cr = _mm_sub_epi32(_mm_cvtepu8_epi32(cr8), bias);
+        __m128i rv = _mm_mullo_epi32(cr, c_rv);
+        __m128i guv = _mm_add_epi32(_mm_mullo_epi32(cb, c_gu),
+            _mm_mullo_epi32(cr, c_gv));
+        __m128i bu = _mm_mullo_epi32(cb, c_bu);
+        //each chroma sample covers 2 pixels
+        yuv_pixels_sse41(_mm_cvtepu8_epi32(luma),
+            _mm_unpacklo_epi32(rv, rv), _mm_unpacklo_epi32(guv, guv),
+            _mm_unpacklo_epi32(bu, bu), y_offset, y_scale,
+            rs[2*half], gs[2*half], bs[2*half]);
+        yuv_pixels_sse41(_mm_cvtepu8_epi32(_mm_srli_si128(luma, 4)),
+            _mm_unpackhi_epi32(rv, rv), _mm_unpackhi_epi32(guv, guv),
+            _mm_unpackhi_epi32(bu, bu), y_offset, y_scale,
+            rs[2*half+1], gs[2*half+1], bs[2*half+1]);
+        luma = _mm_srli_si128(luma, 8);
+      }
+      store16_sse41(r + x, rs[0], rs[1], rs[2], rs[3]);
+      store16_sse41(g + x, gs[0], gs[1], gs[2], gs[3]);
+      store16_sse41(b + x, bs[0], bs[1], bs[2], bs[3]);
+    }
+    yuv_row_scalar(y, u, v, x, width, c, r, g, b);
+  }
+
+  /**
+   * Saturates 16 values in 32-bit lanes to bytes
+   */
+  __attribute__((target("avx2")))
+  static inline __m128i pack16_avx2(__m256i v0, __m256i v1) {
+    //packing works within 128-bit lanes: restores the order of the values
+    __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(v0, v1),
+        0xd8);
+    return _mm_packus_epi16(_mm256_castsi256_si128(words),
+        _mm256_extracti128_si256(words, 1));
+  }
+
+  /**
+   * Saturates 16 values in 32-bit lanes to bytes and stores them
+   */
+  __attribute__((target("avx2")))
+  static inline void store16_avx2(uint8_t* dst, __m256i v0, __m256i v1) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), pack16_avx2(v0, v1));
+  }
+
+  /**
+   * Converts 16 pixels (8 chroma samples) at a time
+   */
+  __attribute__((target("avx2")))
+  static void yuv_row_avx2(const uint8_t* y, const uint8_t* u,
+      const uint8_t* v, size_t start, size_t width, const YUVCoefficients& c,
+      uint8_t* r, uint8_t* g, uint8_t* b) {
+    const __m256i y_offset = _mm256_set1_epi32(c.y_offset);
+    const __m256i y_scale = _mm256_set1_epi32(c.y);
+    const __m256i c_rv = _mm256_set1_epi32(c.rv), c_gu = _mm256_set1_epi32(c.gu);
+    const __m256i c_gv = _mm256_set1_epi32(c.gv), c_bu = _mm256_set1_epi32(c.bu);
+    const __m256i bias = _mm256_set1_epi32(128);
+    const __m256i round = _mm256_set1_epi32(1 << 15);
+    const __m256i first = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i second = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+    size_t x = start;
+    for (; x+16<=width; x+=16) {
+      __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+      __m256i cb = _mm256_sub_epi32(_mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x/2))), bias);
+      __m256i cr = _mm256_sub_epi32(_mm256_cvtepu8_epi32(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x/2))), bias);
+      __m256i rv = _mm256_mullo_epi32(cr, c_rv);
+      __m256i guv = _mm256_add_epi32(_mm256_mullo_epi32(cb, c_gu),
+          _mm256_mullo_epi32(cr, c_gv));
+      __m256i bu = _mm256_mullo_epi32(cb, c_bu);
+      __m256i l0 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(
+              _mm256_cvtepu8_epi32(luma), y_offset), y_scale), round);
+      __m256i l1 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(
+              _mm256_cvtepu8_epi32(_mm_srli_si128(luma, 8)), y_offset),
+            y_scale), round);
+      //each chroma sample covers 2 pixels
+      __m256i rv0 = _mm256_permutevar8x32_epi32(rv, first);
+      __m256i rv1 = _mm256_permutevar8x32_epi32(rv, second);
+      __m256i guv0 = _mm256_permutevar8x32_epi32(guv, first);
+      __m256i guv1 = _mm256_permutevar8x32_epi32(guv, second);
+      __m256i bu0 = _mm256_permutevar8x32_epi32(bu, first);
+      __m256i bu1 = _mm256_permutevar8x32_epi32(bu, second);
+      store16_avx2(r + x, _mm256_srai_epi32(_mm256_add_epi32(l0, rv0), 16),
+          _mm256_srai_epi32(_mm256_add_epi32(l1, rv1), 16));
+      store16_avx2(g + x, _mm256_srai_epi32(_mm256_sub_epi32(l0, guv0), 16),
+          _mm256_srai_epi32(_mm256_sub_epi32(l1, guv1), 16));
+      store16_avx2(b + x, _mm256_srai_epi32(_mm256_add_epi32(l0, bu0), 16),
+          _mm256_srai_epi32(_mm256_add_epi32(l1, bu1), 16));
+    }
+    yuv_row_scalar(y, u, v, x, width, c, r, g, b);
+  }
+
+  /**
+   * Saturates 16 values in 32-bit lanes to bytes and stores them
+   */
+  __attribute__((target("avx512f")))
+  static inline void store16_avx512(uint8_t* dst, __m512i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+        _mm512_cvtusepi32_epi8(_mm512_max_epi32(v, _mm512_setzero_si512())));
+  }
+
+  /**
+   * Converts 32 pixels (16 chroma samples) at a time
+   */
+  __attribute__((target("avx512f")))
+  static void yuv_row_avx512(const uint8_t* y, const uint8_t* u,
+      const uint8_t* v, size_t start, size_t width, const YUVCoefficients& c,
+      uint8_t* r, uint8_t* g, uint8_t* b) {
+    const __m512i y_offset = _mm512_set1_epi32(c.y_offset);
+    const __m512i y_scale = _mm512_set1_epi32(c.y);
+    const __m512i c_rv = _mm512_set1_epi32(c.rv), c_gu = _mm512_set1_epi32(c.gu);
+    const __m512i c_gv = _mm512_set1_epi32(c.gv), c_bu = _mm512_set1_epi32(c.bu);
+    const __m512i bias = _mm512_set1_epi32(128);
+    const __m512i round = _mm512_set1_epi32(1 << 15);
+    const __m512i first = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3,
+        4, 4, 5, 5, 6, 6, 7, 7);
+    const __m512i second = _mm512_setr_epi32(8, 8, 9, 9, 10, 10, 11, 11,
+        12, 12, 13, 13, 14, 14, 15, 15);
+    size_t x = start;
+    for (; x+32<=width; x+=32) {
+      __m512i cb = _mm512_sub_epi32(_mm512_cvtepu8_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(u + x/2))), bias);
+      __m512i cr = _mm512_sub_epi32(_mm512_cvtepu8_epi32(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(v + x/2))), bias);
+      __m512i rv = _mm512_mullo_epi32(cr, c_rv);
+      __m512i guv = _mm512_add_epi32(_mm512_mullo_epi32(cb, c_gu),
+          _mm512_mullo_epi32(cr, c_gv));
+      __m512i bu = _mm512_mullo_epi32(cb, c_bu);
+      for (int half=0; half<2; ++half) {
+        __m512i luma = _mm512_add_epi32(_mm512_mullo_epi32(_mm512_sub_epi32(
+                _mm512_cvtepu8_epi32(_mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(y + x + 16*half))),
+                y_offset), y_scale), round);
+        //each chroma sample covers 2 pixels
+        const __m512i& index = half? second : first;
+        size_t at = x + 16*half;
+        store16_avx512(r + at, _mm512_srai_epi32(_mm512_add_epi32(luma,
+                _mm512_permutexvar_epi32(index, rv)), 16));
+        store16_avx512(g + at, _mm512_srai_epi32(_mm512_sub_epi32(luma,
+                _mm512_permutexvar_epi32(index, guv)), 16));
+        store16_avx512(b + at, _mm512_srai_epi32(_mm512_add_epi32(luma,
+                _mm512_permutexvar_epi32(index, bu)), 16));
+      }
+    }
+    yuv_row_scalar(y, u, v, x, width, c, r, g, b);
+  }
+
+  /**
+   * Computes 4 values from the first 4 bytes of each band
+   */
+  __attribute__((target("sse4.1")))
+  static inline __m128i luma4_sse41(__m128i r, __m128i g, __m128i b,
+      __m128i cr, __m128i cg, __m128i cb, __m128i bias) {
+    __m128i sum = _mm_add_epi32(_mm_mullo_epi32(_mm_cvtepu8_epi32(r), cr),
+        _mm_mullo_epi32(_mm_cvtepu8_epi32(g), cg));
+    sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(b), cb));
+    return _mm_srai_epi32(_mm_add_epi32(sum, bias), 16);
+  }
+
+  /**
+   * Computes 16 luma values from 16 bytes of each band
+   */
+  __attribute__((target("sse4.1")))
+  static inline __m128i luma16_sse41(__m128i r, __m128i g, __m128i b,
+      __m128i cr, __m128i cg, __m128i cb, __m128i bias) {
+    __m128i l0 = luma4_sse41(r, g, b, cr, cg, cb, bias);
+    __m128i l1 = luma4_sse41(_mm_srli_si128(r, 4), _mm_srli_si128(g, 4),
+        _mm_srli_si128(b, 4), cr, cg, cb, bias);
+    __m128i l2 = luma4_sse41(_mm_srli_si128(r, 8), _mm_srli_si128(g, 8),
+        _mm_srli_si128(b, 8), cr, cg, cb, bias);
+    __m128i l3 = luma4_sse41(_mm_srli_si128(r, 12), _mm_srli_si128(g, 12),
+        _mm_srli_si128(b, 12), cr, cg, cb, bias);
+    return pack16_sse41(l0, l1, l2, l3);
+  }
+
+  /**
+   * Computes 4 chroma values from the sums of 2x2 pixels of each band, in
+   * 32-bit lanes
+   */
+  __attribute__((target("sse4.1")))
+  static inline __m128i chroma4_sse41(__m128i r, __m128i g, __m128i b,
+      __m128i cr, __m128i cg, __m128i cb, __m128i bias) {
+    __m128i sum = _mm_add_epi32(_mm_mullo_epi32(r, cr), _mm_mullo_epi32(g, cg));
+    sum = _mm_add_epi32(sum, _mm_mullo_epi32(b, cb));
+    return _mm_srai_epi32(_mm_add_epi32(sum, bias), 18);
+  }
+
+  /**
+   * Sums the pairs of adjacent bytes of two rows, into 8 16-bit lanes
+   */
+  __attribute__((target("sse4.1")))
+  static inline __m128i pair_sums_sse41(__m128i row0, __m128i row1) {
+    const __m128i ones = _mm_set1_epi8(1);
+    return _mm_add_epi16(_mm_maddubs_epi16(row0, ones),
+        _mm_maddubs_epi16(row1, ones));
+  }
+
+  /**
+   * Converts 16 pixels of each row (8 chroma samples) at a time
+   */
+  __attribute__((target("sse4.1")))
+  static void rgb_rows_sse41(const uint8_t* const* rows, size_t start,
+      size_t width, const RGBCoefficients& c, uint8_t* y0, uint8_t* y1,
+      uint8_t* u, uint8_t* v) {
+    const __m128i yr = _mm_set1_epi32(c.yr), yg = _mm_set1_epi32(c.yg);
+    const __m128i yb = _mm_set1_epi32(c.yb), y_bias = _mm_set1_epi32(c.y_bias);
+    const __m128i ur = _mm_set1_epi32(c.ur), ug = _mm_set1_epi32(c.ug);
+    const __m128i ub = _mm_set1_epi32(c.ub);
+    const __m128i vr = _mm_set1_epi32(c.vr), vg = _mm_set1_epi32(c.vg);
+    const __m128i vb = _mm_set1_epi32(c.vb);
+    const __m128i c_bias = _mm_set1_epi32(CHROMA_BIAS);
+    size_t x = start;
+    for (; x+16<=width; x+=16) {
+      __m128i band[6];
+      for (int k=0; k<6; ++k)
+        band[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x),
+          luma16_sse41(band[0], band[1], band[2], yr, yg, yb, y_bias));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x),
+          luma16_sse41(band[3], band[4], band[5], yr, yg, yb, y_bias));
+      __m128i rs = pair_sums_sse41(band[0], band[3]);
+      __m128i gs = pair_sums_sse41(band[1], band[4]);
+      __m128i bs = pair_sums_sse41(band[2], band[5]);
+      __m128i r0 = _mm_cvtepi16_epi32(rs), r1 = _mm_cvtepi16_epi32(_mm_srli_si128(rs, 8));
+      __m128i g0 = _mm_cvtepi16_epi32(gs), g1 = _mm_cvtepi16_epi32(_mm_srli_si128(gs, 8));
+      __m128i b0 = _mm_cvtepi16_epi32(bs), b1 = _mm_cvtepi16_epi32(_mm_srli_si128(bs, 8));
+      __m128i uv = pack16_sse41(
+          chroma4_sse41(r0, g0, b0, ur, ug, ub, c_bias),
+          chroma4_sse41(r1, g1, b1, ur, ug, ub, c_bias),
+          chroma4_sse41(r0, g0, b0, vr, vg, vb, c_bias),
+          chroma4_sse41(r1, g1, b1, vr, vg, vb, c_bias));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x/2), uv);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x/2),
+          _mm_srli_si128(uv, 8));
+    }
+    rgb_rows_scalar(rows, x, width, c, y0, y1, u, v);
+  }
+
+  /**
+   * Computes 8 values from the first 8 bytes of each band
+   */
+  __attribute__((target("avx2")))
+  static inline __m256i luma8_avx2(__m128i r, __m128i g, __m128i b,
+      __m256i cr, __m256i cg, __m256i cb, __m256i bias) {
+    __m256i sum = _mm256_add_epi32(
+        _mm256_mullo_epi32(_mm256_cvtepu8_epi32(r), cr),
+        _mm256_mullo_epi32(_mm256_cvtepu8_epi32(g), cg));
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(b), cb));
+    return _mm256_srai_epi32(_mm256_add_epi32(sum, bias), 16);
+  }
+
+  /**
+   * Computes 16 luma values from 16 bytes of each band
+   */
+  __attribute__((target("avx2")))
+  static inline __m128i luma16_avx2(__m128i r, __m128i g, __m128i b,
+      __m256i cr, __m256i cg, __m256i cb, __m256i bias) {
+    return pack16_avx2(luma8_avx2(r, g, b, cr, cg, cb, bias),
+        luma8_avx2(_mm_srli_si128(r, 8), _mm_srli_si128(g, 8),
+          _mm_srli_si128(b, 8), cr, cg, cb, bias));
+  }
+
+  /**
+   * Computes 8 chroma values from the sums of 2x2 pixels of each band, in
+   * 32-bit lanes
+   */
+  __attribute__((target("avx2")))
+  static inline __m256i chroma8_avx2(__m256i r, __m256i g, __m256i b,
+      __m256i cr, __m256i cg, __m256i cb, __m256i bias) {
+    __m256i sum = _mm256_add_epi32(_mm256_mullo_epi32(r, cr),
+        _mm256_mullo_epi32(g, cg));
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(b, cb));
+    return _mm256_srai_epi32(_mm256_add_epi32(sum, bias), 18);
+  }
+
+  /**
+   * Converts 16 pixels of each row (8 chroma samples) at a time
+   */
+  __attribute__((target("avx2")))
+  static void rgb_rows_avx2(const uint8_t* const* rows, size_t start,
+      size_t width, const RGBCoefficients& c, uint8_t* y0, uint8_t* y1,
+      uint8_t* u, uint8_t* v) {
+    const __m256i yr = _mm256_set1_epi32(c.yr), yg = _mm256_set1_epi32(c.yg);
+    const __m256i yb = _mm256_set1_epi32(c.yb);
+    const __m256i y_bias = _mm256_set1_epi32(c.y_bias);
+    const __m256i ur = _mm256_set1_epi32(c.ur), ug = _mm256_set1_epi32(c.ug);
+    const __m256i ub = _mm256_set1_epi32(c.ub);
+    const __m256i vr = _mm256_set1_epi32(c.vr), vg = _mm256_set1_epi32(c.vg);
+    const __m256i vb = _mm256_set1_epi32(c.vb);
+    const __m256i c_bias = _mm256_set1_epi32(CHROMA_BIAS);
+    size_t x = start;
+    for (; x+16<=width; x+=16) {
+      __m128i band[6];
+      for (int k=0; k<6; ++k)
+        band[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y0 + x),
+          luma16_avx2(band[0], band[1], band[2], yr, yg, yb, y_bias));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(y1 + x),
+          luma16_avx2(band[3], band[4], band[5], yr, yg, yb, y_bias));
+      __m256i rs = _mm256_cvtepi16_epi32(pair_sums_sse41(band[0], band[3]));
+      __m256i gs = _mm256_cvtepi16_epi32(pair_sums_sse41(band[1], band[4]));
+      __m256i bs = _mm256_cvtepi16_epi32(pair_sums_sse41(band[2], band[5]));
+      __m128i uv = pack16_avx2(chroma8_avx2(rs, gs, bs, ur, ug, ub, c_bias),
+          chroma8_avx2(rs, gs, bs, vr, vg, vb, c_bias));
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x/2), uv);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x/2),
+          _mm_srli_si128(uv, 8));
+    }
+    rgb_rows_scalar(rows, x, width, c, y0, y1, u, v);
+  }
+
+#endif /* BOB_IO_VIDEO_X86_SIMD */
+
+  /**
+   * Instruction sets, from the least to the most capable
+   */
+  enum Level { SCALAR, SSE2, SSE41, AVX2, AVX512, LEVELS };
+
+  static const char* const LEVEL_NAMES[LEVELS] = {
+    "scalar", "sse2", "sse4.1", "avx2", "avx512"
+  };
+
+  /**
+   * The most capable instruction set of the running CPU
+   */
+  static Level cpu_level() {
+#if defined(BOB_IO_VIDEO_X86_SIMD)
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    if (avx2 && __builtin_cpu_supports("avx512f")) return AVX512;
+    if (avx2) return AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SSE41;
+    if (__builtin_cpu_supports("sse2")) return SSE2;
+#endif
+    return SCALAR;
+  }
+
+  /**
+   * The kernels to use on this CPU, selected once (or by
+   * set_conversion_isa())
+   */
+  struct Kernels {
+    Level level;
+    row_kernel float32;
+    row_kernel float16;
+    packed_kernel packed_float32;
+    packed_kernel packed_float16;
+    yuv_kernel yuv;
+    rgb_kernel rgb;
+    sad_kernel sad;
+
+    Kernels() { select(cpu_level()); }
+
+    void select(Level l) {
+      level = l;
+      float32 = row_float32_scalar;
+      float16 = row_float16_scalar;
+      packed_float32 = packed_float32_scalar;
+      packed_float16 = packed_float16_scalar;
+      yuv = yuv_row_scalar;
+      rgb = rgb_rows_scalar;
+      sad = sad_scalar;
+#if defined(BOB_IO_VIDEO_X86_SIMD)
+      if (l >= SSE2) {
+        float32 = row_float32_sse2;
+        float16 = row_float16_sse2;
+        packed_float32 = packed_float32_sse2;
+        packed_float16 = packed_float16_sse2;
+        sad = sad_sse2;
+      }
+      if (l >= SSE41) {
+        yuv = yuv_row_sse41;
+        rgb = rgb_rows_sse41;
+      }
+      if (l >= AVX2) {
+        float32 = row_float32_avx2;
+        float16 = row_float16_avx2;
+        packed_float32 = packed_float32_avx2;
+        packed_float16 = packed_float16_avx2;
+        yuv = yuv_row_avx2;
+        rgb = rgb_rows_avx2;
+        sad = sad_avx2;
+      }
+      if (l >= AVX512) yuv = yuv_row_avx512;
+#endif
+    }
+  };
+
+  static Kernels& kernels() {
+    static Kernels k;
+    return k;
+  }
+
+  static const float IDENTITY_SCALE[3] = {1.f, 1.f, 1.f};
+  static const float IDENTITY_OFFSET[3] = {0.f, 0.f, 0.f};
+
+  /**
+   * Splits each row of the packed image in bands and converts those
+   */
+  static void rgb24_to_planar(const uint8_t* src, size_t height,
+      size_t width, void* dst, size_t element_size, row_kernel kernel,
+      const float* scale, const float* offset) {
+
+    if (!scale) scale = IDENTITY_SCALE;
+    if (!offset) offset = IDENTITY_OFFSET;
+
+    std::vector<uint8_t> bands(3 * width);
+    uint8_t* r = &bands[0];
+    uint8_t* g = r + width;
+    uint8_t* b = g + width;
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t plane = height * width * element_size;
+    size_t row = width * element_size;
+
+    for (size_t y=0; y<height; ++y, src+=3*width) {
+      for (size_t x=0; x<width; ++x) {
+        r[x] = src[3*x];
+        g[x] = src[3*x+1];
+        b[x] = src[3*x+2];
+      }
+      kernel(r, width, scale[0], offset[0], out + y*row);
+      kernel(g, width, scale[1], offset[1], out + plane + y*row);
+      kernel(b, width, scale[2], offset[2], out + 2*plane + y*row);
+    }
+  }
+
+  void rgb24_to_planar_float32(const uint8_t* src, size_t height,
+      size_t width, float* dst, const float* scale, const float* offset) {
+    rgb24_to_planar(src, height, width, dst, sizeof(float),
+        kernels().float32, scale, offset);
+  }
+
+  void rgb24_to_planar_float16(const uint8_t* src, size_t height,
+      size_t width, uint16_t* dst, const float* scale, const float* offset) {
+    rgb24_to_planar(src, height, width, dst, sizeof(uint16_t),
+        kernels().float16, scale, offset);
+  }
+
+  /**
+   * Converts each band of the planar image
+   */
+  static void planar_to(const uint8_t* src, size_t height, size_t width,
+      void* dst, size_t element_size, row_kernel kernel, const float* scale,
+      const float* offset) {
+    if (!scale) scale = IDENTITY_SCALE;
+    if (!offset) offset = IDENTITY_OFFSET;
+    size_t n = height * width;
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    for (size_t band=0; band<3; ++band)
+      kernel(src + band*n, n, scale[band], offset[band],
+          out + band*n*element_size);
+  }
+
+  void planar_to_float32(const uint8_t* src, size_t height, size_t width,
+      float* dst, const float* scale, const float* offset) {
+    planar_to(src, height, width, dst, sizeof(float), kernels().float32,
+        scale, offset);
+  }
+
+  void planar_to_float16(const uint8_t* src, size_t height, size_t width,
+      uint16_t* dst, const float* scale, const float* offset) {
+    planar_to(src, height, width, dst, sizeof(uint16_t), kernels().float16,
+        scale, offset);
+  }
+
+  void rgb24_to_packed_float32(const uint8_t* src, size_t height,
+      size_t width, float* dst, const float* scale, const float* offset) {
+    kernels().packed_float32(src, 3 * height * width,
+        scale? scale : IDENTITY_SCALE, offset? offset : IDENTITY_OFFSET, dst);
+  }
+
+  void rgb24_to_packed_float16(const uint8_t* src, size_t height,
+      size_t width, uint16_t* dst, const float* scale, const float* offset) {
+    kernels().packed_float16(src, 3 * height * width,
+        scale? scale : IDENTITY_SCALE, offset? offset : IDENTITY_OFFSET, dst);
+  }
+
+  /**
+   * BT.601 coefficients, from ITU-R BT.601 luma weights (0.299, 0.587,
+   * 0.114), scaled to 16 fractional bits
+   */
+  static YUVCoefficients bt601_coefficients(bool full_range) {
+    double luma = full_range? 1. : 255. / 219.;
+    double chroma = full_range? 1. : 255. / 224.;
+    double rv = 1.402 * chroma;
+    double bu = 1.772 * chroma;
+    YUVCoefficients c;
+    c.y_offset = full_range? 0 : 16;
+    c.y = std::lround(luma * 65536.);
+    c.rv = std::lround(rv * 65536.);
+    c.gu = std::lround(bu * 0.114 / 0.587 * 65536.);
+    c.gv = std::lround(rv * 0.299 / 0.587 * 65536.);
+    c.bu = std::lround(bu * 65536.);
+    return c;
+  }
+
+  void yuv_to_planar_rgb24(YUVFormat format, bool full_range,
+      const uint8_t* const* planes, const int* linesizes, size_t height,
+      size_t width, uint8_t* dst) {
+
+    static const YUVCoefficients LIMITED = bt601_coefficients(false);
+    static const YUVCoefficients FULL = bt601_coefficients(true);
+    const YUVCoefficients& c = full_range? FULL : LIMITED;
+    yuv_kernel kernel = kernels().yuv;
+
+    size_t plane = height * width;
+    uint8_t* r = dst;
+    uint8_t* g = dst + plane;
+    uint8_t* b = dst + 2 * plane;
+
+    //interleaved chroma is split once per chroma row
+    size_t chroma_width = (width + 1) / 2;
+    std::vector<uint8_t> chroma(format == NV12? 2 * chroma_width : 0);
+    size_t split = height; //the chroma row in 'chroma'
+
+    for (size_t row=0; row<height; ++row) {
+      size_t chroma_row = (format == YUV422P)? row : row / 2;
+      const uint8_t* y = planes[0] + std::ptrdiff_t(row) * linesizes[0];
+      const uint8_t* u;
+      const uint8_t* v;
+      if (format == NV12) {
+        u = &chroma[0];
+        v = u + chroma_width;
+        if (chroma_row != split) {
+          const uint8_t* uv = planes[1] +
+            std::ptrdiff_t(chroma_row) * linesizes[1];
+          uint8_t* cb = &chroma[0];
+          uint8_t* cr = cb + chroma_width;
+          for (size_t x=0; x<chroma_width; ++x) {
+            cb[x] = uv[2*x];
+            cr[x] = uv[2*x+1];
+          }
+          split = chroma_row;
+        }
+      }
+      else {
+        u = planes[1] + std::ptrdiff_t(chroma_row) * linesizes[1];
+        v = planes[2] + std::ptrdiff_t(chroma_row) * linesizes[2];
+      }
+      kernel(y, u, v, 0, width, c, r + row*width, g + row*width,
+          b + row*width);
+    }
+  }
+
+  /**
+   * RGB to YUV coefficients of a colour matrix, given by its luma weights
+   * for red and blue, scaled to 16 fractional bits
+   */
+  static RGBCoefficients rgb_coefficients(YUVMatrix matrix,
+      bool full_range) {
+    double kr = (matrix == BT709)? 0.2126 : 0.299;
+    double kb = (matrix == BT709)? 0.0722 : 0.114;
+    double kg = 1. - kr - kb;
+    double luma = (full_range? 1. : 219. / 255.) * 65536.;
+    double chroma = (full_range? 1. : 224. / 255.) * 65536.;
+    RGBCoefficients c;
+    c.yr = std::lround(kr * luma);
+    c.yg = std::lround(kg * luma);
+    c.yb = std::lround(luma) - c.yr - c.yg; //white maps to the top of the range
+    c.y_bias = ((full_range? 0 : 16) << 16) + (1 << 15);
+    c.ur = std::lround(-kr / (2. * (1. - kb)) * chroma);
+    c.ug = std::lround(-kg / (2. * (1. - kb)) * chroma);
+    c.ub = -c.ur - c.ug; //greys have no chroma
+    c.vg = std::lround(-kg / (2. * (1. - kr)) * chroma);
+    c.vb = std::lround(-kb / (2. * (1. - kr)) * chroma);
+    c.vr = -c.vg - c.vb;
+    return c;
+  }
+
+  void rgb_to_yuv420p(const uint8_t* src, size_t height, size_t width,
+      YUVMatrix matrix, bool full_range, uint8_t* const* planes,
+      const int* linesizes) {
+    rgb_to_yuv420p(src, height * width, width, height, width, matrix,
+        full_range, planes, linesizes);
+  }
+
+  void rgb_to_yuv420p(const uint8_t* src, std::ptrdiff_t band_stride,
+      std::ptrdiff_t row_stride, size_t height, size_t width,
+      YUVMatrix matrix, bool full_range, uint8_t* const* planes,
+      const int* linesizes) {
+
+    static const RGBCoefficients COEFFICIENTS[2][2] = {
+      {rgb_coefficients(BT601, false), rgb_coefficients(BT601, true)},
+      {rgb_coefficients(BT709, false), rgb_coefficients(BT709, true)},
+    };
+    const RGBCoefficients& c = COEFFICIENTS[matrix == BT709][full_range];
+    rgb_kernel kernel = kernels().rgb;
+
+    for (size_t row=0; row<height; row+=2) {
+      size_t next = (row + 1 < height)? row + 1 : row; //repeats the last row
+      const uint8_t* r = src + std::ptrdiff_t(row) * row_stride;
+      const uint8_t* n = src + std::ptrdiff_t(next) * row_stride;
+      const uint8_t* rows[6] = {
+        r, r + band_stride, r + 2*band_stride,
+        n, n + band_stride, n + 2*band_stride,
+      };
+      kernel(rows, 0, width, c,
+          planes[0] + std::ptrdiff_t(row) * linesizes[0],
+          planes[0] + std::ptrdiff_t(next) * linesizes[0],
+          planes[1] + std::ptrdiff_t(row/2) * linesizes[1],
+          planes[2] + std::ptrdiff_t(row/2) * linesizes[2]);
+    }
+  }
+
+  uint64_t sum_abs_difference(const uint8_t* a, const uint8_t* b, size_t n) {
+    return kernels().sad(a, b, n);
+  }
+
+  const char* conversion_isa() {
+    return LEVEL_NAMES[kernels().level];
+  }
+
+  void set_conversion_isa(const std::string& isa) {
+    Level best = cpu_level();
+    if (isa.empty()) {
+      kernels().select(best);
+      return;
+    }
+    for (int l=SCALAR; l<LEVELS; ++l) {
+      if (isa != LEVEL_NAMES[l]) continue;
+      if (l > best) {
+        boost::format m("bob::io::video::set_conversion_isa(`%s') failed: the running CPU only supports up to `%s'");
+        m % isa % LEVEL_NAMES[best];
+        throw std::runtime_error(m.str());
+      }
+      kernels().select(static_cast<Level>(l));
+      return;
+    }
+    boost::format m("bob::io::video::set_conversion_isa(`%s') failed: unknown instruction set (use one of `scalar', `sse2', `sse4.1', `avx2' or `avx512')");
+    m % isa;
+    throw std::runtime_error(m.str());
+  }
+
+}}}
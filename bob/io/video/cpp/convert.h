@@ -0,0 +1,131 @@
+#ifndef BOB_IO_VIDEO_CONVERT_H
+#define BOB_IO_VIDEO_CONVERT_H
+
+#include <cstddef>
+#include <string>
+#include <stdint.h>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * Converts a packed RGB24 image (height, width, 3) into planar single
+   * precision floats (3, height, width), computing
+   * value * scale[band] + offset[band] for each band (multiplication and
+   * addition are not fused, so results match a numpy computation in float32
+   * bit by bit). Uses the widest SIMD instruction set available on the
+   * running CPU (see conversion_isa()).
+   */
+  void rgb24_to_planar_float32(const uint8_t* src, size_t height,
+      size_t width, float* dst, const float* scale, const float* offset);
+
+  /**
+   * Same as rgb24_to_planar_float32(), but outputs IEEE 754 half precision
+   * floats (as their 16-bit patterns), rounding to the nearest even value.
+   */
+  void rgb24_to_planar_float16(const uint8_t* src, size_t height,
+      size_t width, uint16_t* dst, const float* scale, const float* offset);
+
+  /**
+   * Converts a packed RGB24 image (height, width, 3) into packed single
+   * precision floats (height, width, 3), computing
+   * value * scale[band] + offset[band], like rgb24_to_planar_float32().
+   */
+  void rgb24_to_packed_float32(const uint8_t* src, size_t height,
+      size_t width, float* dst, const float* scale, const float* offset);
+
+  /**
+   * Same as rgb24_to_packed_float32(), but outputs half precision floats,
+   * like rgb24_to_planar_float16().
+   */
+  void rgb24_to_packed_float16(const uint8_t* src, size_t height,
+      size_t width, uint16_t* dst, const float* scale, const float* offset);
+
+  /**
+   * Same as rgb24_to_planar_float32(), but from planar 8-bit RGB data (3,
+   * height, width)
+   */
+  void planar_to_float32(const uint8_t* src, size_t height, size_t width,
+      float* dst, const float* scale, const float* offset);
+
+  /**
+   * Same as rgb24_to_planar_float16(), but from planar 8-bit RGB data (3,
+   * height, width)
+   */
+  void planar_to_float16(const uint8_t* src, size_t height, size_t width,
+      uint16_t* dst, const float* scale, const float* offset);
+
+  /**
+   * Layouts of YUV pictures yuv_to_planar_rgb24() converts from
+   */
+  enum YUVFormat {
+    YUV420P, ///< Y, U and V planes, chroma halved in both directions
+    YUV422P, ///< Y, U and V planes, chroma halved horizontally
+    NV12 ///< Y plane and interleaved UV plane, chroma halved in both directions
+  };
+
+  /**
+   * Converts a YUV picture with BT.601 coefficients, in limited (16-235) or
+   * full (JPEG) range, into planar 8-bit RGB (3, height, width) at 'dst'.
+   * Chroma samples are not interpolated (each one covers 2 or 4 pixels).
+   * 'planes' and 'linesizes' point to the picture planes and the number of
+   * bytes between their rows. All instruction sets compute in fixed point
+   * with 16 fractional bits and output exactly the same values.
+   */
+  void yuv_to_planar_rgb24(YUVFormat format, bool full_range,
+      const uint8_t* const* planes, const int* linesizes, size_t height,
+      size_t width, uint8_t* dst);
+
+  /**
+   * Colour matrices for rgb_to_yuv420p()
+   */
+  enum YUVMatrix {
+    BT601, ///< ITU-R BT.601, for standard definition
+    BT709 ///< ITU-R BT.709, for high definition
+  };
+
+  /**
+   * Converts planar 8-bit RGB data (3, height, width) at 'src' into a
+   * yuv420p picture, in limited (16-235 for luma) or full range, writing
+   * the Y, U and V planes given in 'planes', whose rows are 'linesizes'
+   * bytes apart. Each chroma sample is computed from the average colour of
+   * the (up to) 4 pixels it covers. All instruction sets compute in fixed
+   * point with 16 fractional bits and output exactly the same values.
+   */
+  void rgb_to_yuv420p(const uint8_t* src, size_t height, size_t width,
+      YUVMatrix matrix, bool full_range, uint8_t* const* planes,
+      const int* linesizes);
+
+  /**
+   * Same as above, but the colour bands at 'src' are 'band_stride' bytes
+   * apart and their rows 'row_stride' bytes apart (e.g. for a crop of a
+   * larger image): only the pixels of each row must be contiguous.
+   */
+  void rgb_to_yuv420p(const uint8_t* src, std::ptrdiff_t band_stride,
+      std::ptrdiff_t row_stride, size_t height, size_t width,
+      YUVMatrix matrix, bool full_range, uint8_t* const* planes,
+      const int* linesizes);
+
+  /**
+   * Returns the sum of the absolute differences between the 'n' bytes at
+   * 'a' and the ones at 'b' (e.g. two luma planes)
+   */
+  uint64_t sum_abs_difference(const uint8_t* a, const uint8_t* b, size_t n);
+
+  /**
+   * The name of the instruction set used by the conversions above:
+   * "avx512", "avx2", "sse4.1", "sse2" or "scalar". Conversions that have no
+   * implementation for an instruction set use the best one below.
+   */
+  const char* conversion_isa();
+
+  /**
+   * Restricts the conversions above to the given instruction set (and the
+   * ones below it), which must be supported by the running CPU. An empty
+   * name selects the best one available. This is meant for testing and
+   * benchmarking and should not be called while conversions are running.
+   */
+  void set_conversion_isa(const std::string& isa);
+
+}}}
+
+#endif /* BOB_IO_VIDEO_CONVERT_H */
@@ -0,0 +1,147 @@
+#include "frame_cache.h"
+
+#include <cstring>
+#include <functional>
+#include <boost/format.hpp>
+
+#include <sys/stat.h>
+
+namespace bob { namespace io { namespace video {
+
+  FrameCache& FrameCache::instance() {
+    static FrameCache cache;
+    return cache;
+  }
+
+  std::string FrameCache::file_identity(const std::string& filename) {
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0) return std::string();
+    boost::format m("%d:%d:%d:%d.%09d");
+    m % st.st_dev % st.st_ino % st.st_size % st.st_mtim.tv_sec % st.st_mtim.tv_nsec;
+    return m.str();
+  }
+
+  FrameCache::FrameCache() :
+    m_budget(0),
+    m_size(0),
+    m_hits(0),
+    m_misses(0)
+  {
+  }
+
+  bool FrameCache::Key::operator== (const Key& other) const {
+    return frame == other.frame && file == other.file && format == other.format;
+  }
+
+  size_t FrameCache::KeyHash::operator() (const Key& key) const {
+    size_t seed = std::hash<std::string>()(key.file);
+    seed ^= std::hash<size_t>()(key.frame) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    seed ^= std::hash<std::string>()(key.format) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    return seed;
+  }
+
+  bool FrameCache::enabled() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget > 0;
+  }
+
+  void FrameCache::set_budget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_budget = bytes;
+    shrink(m_budget);
+  }
+
+  size_t FrameCache::budget() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_budget;
+  }
+
+  size_t FrameCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+  }
+
+  size_t FrameCache::frames() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+  }
+
+  uint64_t FrameCache::hits() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+  }
+
+  uint64_t FrameCache::misses() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+  }
+
+  void FrameCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    shrink(0);
+    m_hits = 0;
+    m_misses = 0;
+  }
+
+  bool FrameCache::lookup(const std::string& file, size_t frame,
+      const std::string& format, uint8_t* data, size_t size) {
+
+    Key key;
+    key.file = file;
+    key.frame = frame;
+    key.format = format;
+
+    data_type found;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      map_type::iterator it = m_index.find(key);
+      if (it == m_index.end() || it->second->second->size() != size) {
+        ++m_misses;
+        return false;
+      }
+      m_lru.splice(m_lru.begin(), m_lru, it->second); //most recently used
+      found = it->second->second;
+      ++m_hits;
+    }
+
+    // the entry may be evicted meanwhile, but we hold a reference to it
+    std::memcpy(data, &(*found)[0], size);
+    return true;
+  }
+
+  void FrameCache::insert(const std::string& file, size_t frame,
+      const std::string& format, const uint8_t* data, size_t size) {
+
+    Key key;
+    key.file = file;
+    key.frame = frame;
+    key.format = format;
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (size == 0 || size > m_budget) return;
+      if (m_index.find(key) != m_index.end()) return; //already there
+    }
+
+    // copies outside the lock
+    data_type copy(new std::vector<uint8_t>(data, data + size));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (size > m_budget) return; //budget may have changed meanwhile
+    if (m_index.find(key) != m_index.end()) return; //raced with another thread
+    shrink(m_budget - size);
+    m_lru.push_front(std::make_pair(key, copy));
+    m_index[key] = m_lru.begin();
+    m_size += size;
+  }
+
+  void FrameCache::shrink(size_t bytes) {
+    while (m_size > bytes && !m_lru.empty()) {
+      m_size -= m_lru.back().second->size();
+      m_index.erase(m_lru.back().first);
+      m_lru.pop_back();
+    }
+  }
+
+}}}
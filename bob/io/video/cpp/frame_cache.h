@@ -0,0 +1,146 @@
+#ifndef BOB_IO_VIDEO_FRAME_CACHE_H
+#define BOB_IO_VIDEO_FRAME_CACHE_H
+
+#include <string>
+#include <list>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * A process-wide least-recently-used cache of decoded video frames, shared
+   * by all readers and their iterators. Entries are keyed by the identity of
+   * the file (device, inode, size and modification time), the frame index
+   * and a string describing the output format of the frame. The cache holds
+   * at most budget() bytes of frame data and starts disabled (zero budget).
+   *
+   * All methods are thread-safe. Frame data is copied in and out of the
+   * cache, so callers never share buffers with it.
+   */
+  class FrameCache {
+
+    public:
+
+      /**
+       * Returns the process-wide cache
+       */
+      static FrameCache& instance();
+
+      /**
+       * Returns a string identifying the contents of a file on disk, or an
+       * empty string if the file cannot be stat'ed.
+       */
+      static std::string file_identity(const std::string& filename);
+
+      /**
+       * Tells if the cache is enabled (i.e., has a non-zero budget)
+       */
+      bool enabled() const;
+
+      /**
+       * Sets the maximum number of bytes of frame data the cache may hold,
+       * evicting the least recently used frames if required. Zero disables
+       * the cache and drops all its contents.
+       */
+      void set_budget(size_t bytes);
+
+      /**
+       * The maximum number of bytes of frame data the cache may hold
+       */
+      size_t budget() const;
+
+      /**
+       * The number of bytes of frame data currently held
+       */
+      size_t size() const;
+
+      /**
+       * The number of frames currently held
+       */
+      size_t frames() const;
+
+      /**
+       * Number of successful lookups since the last clear()
+       */
+      uint64_t hits() const;
+
+      /**
+       * Number of failed lookups since the last clear()
+       */
+      uint64_t misses() const;
+
+      /**
+       * Drops all cached frames and resets the hit/miss counters
+       */
+      void clear();
+
+      /**
+       * Copies the frame with the given key into 'data', which must be
+       * 'size' bytes long, and marks it as the most recently used. Returns
+       * 'false' (and does not touch 'data') if there is no such frame with
+       * the given size.
+       */
+      bool lookup(const std::string& file, size_t frame,
+          const std::string& format, uint8_t* data, size_t size);
+
+      /**
+       * Stores a copy of the given frame, evicting the least recently used
+       * ones until it fits the budget. Frames larger than the budget are not
+       * stored.
+       */
+      void insert(const std::string& file, size_t frame,
+          const std::string& format, const uint8_t* data, size_t size);
+
+    private: //only one instance
+
+      FrameCache();
+
+      FrameCache(const FrameCache& other);
+
+      FrameCache& operator= (const FrameCache& other);
+
+    private: //types
+
+      struct Key {
+        std::string file;
+        size_t frame;
+        std::string format;
+        bool operator== (const Key& other) const;
+      };
+
+      struct KeyHash {
+        size_t operator() (const Key& key) const;
+      };
+
+      typedef boost::shared_ptr<const std::vector<uint8_t> > data_type;
+      typedef std::list<std::pair<Key, data_type> > list_type;
+      typedef std::unordered_map<Key, list_type::iterator, KeyHash> map_type;
+
+    private: //methods
+
+      /**
+       * Evicts least recently used entries until we hold at most 'bytes'.
+       * Must be called with the lock held.
+       */
+      void shrink(size_t bytes);
+
+    private: //representation
+
+      mutable std::mutex m_mutex; ///< protects everything below
+      size_t m_budget; ///< maximum number of bytes to hold
+      size_t m_size; ///< number of bytes currently held
+      uint64_t m_hits; ///< number of successful lookups
+      uint64_t m_misses; ///< number of failed lookups
+      list_type m_lru; ///< entries, most recently used first
+      map_type m_index; ///< key to entry in m_lru
+
+  };
+
+}}}
+
+#endif /* BOB_IO_VIDEO_FRAME_CACHE_H */
@@ -0,0 +1,97 @@
+#include "frame_index.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace bob { namespace io { namespace video {
+
+  FrameIndex::FrameIndex(const std::string& filename,
+      boost::shared_ptr<const MappedFile> mapping) :
+    m_usable(true),
+    m_size(0)
+  {
+    boost::shared_ptr<AVFormatContext> format_context =
+      make_input_format_context(filename, mapping);
+    int stream_index = find_video_stream(filename, format_context);
+    m_time_base = format_context->streams[stream_index]->time_base;
+
+    // (pts, seek timestamp) of keyframes, in decoding order
+    std::vector<std::pair<int64_t, int64_t> > keyframes;
+
+    boost::shared_ptr<AVPacket> pkt = make_empty_packet(filename);
+    while (av_read_frame(format_context.get(), pkt.get()) >= 0) {
+      if (pkt->stream_index == stream_index) {
+        ++m_size;
+        int64_t pts = (pkt->pts != (int64_t)AV_NOPTS_VALUE)? pkt->pts : pkt->dts;
+        if (pts == (int64_t)AV_NOPTS_VALUE) m_usable = false;
+        else {
+          m_pts.push_back(pts);
+          if (pkt->flags & AV_PKT_FLAG_KEY) {
+            int64_t ts = (pkt->dts != (int64_t)AV_NOPTS_VALUE)? pkt->dts : pts;
+            keyframes.push_back(std::make_pair(pts, ts));
+          }
+        }
+      }
+      av_packet_unref(pkt.get());
+    }
+
+    std::sort(m_pts.begin(), m_pts.end());
+    if (std::adjacent_find(m_pts.begin(), m_pts.end()) != m_pts.end())
+      m_usable = false; ///< cannot map timestamps to frames
+    if (keyframes.empty()) m_usable = false;
+
+    if (!m_usable) {
+      m_pts.clear();
+      return;
+    }
+
+    std::sort(keyframes.begin(), keyframes.end());
+    for (size_t k=0; k<keyframes.size(); ++k) {
+      m_keyframes.push_back(frame_at(keyframes[k].first));
+      m_keyframe_ts.push_back(keyframes[k].second);
+    }
+  }
+
+  FrameIndex::~FrameIndex() {
+  }
+
+  int64_t FrameIndex::pts(size_t frame) const {
+    if (frame >= m_pts.size()) return AV_NOPTS_VALUE;
+    return m_pts[frame];
+  }
+
+  int64_t FrameIndex::frame_at(int64_t pts) const {
+    std::vector<int64_t>::const_iterator it =
+      std::lower_bound(m_pts.begin(), m_pts.end(), pts);
+    if (it == m_pts.end() || *it != pts) return -1;
+    return it - m_pts.begin();
+  }
+
+  size_t FrameIndex::frame_from(int64_t pts) const {
+    if (!m_usable) return m_size;
+    return std::lower_bound(m_pts.begin(), m_pts.end(), pts) - m_pts.begin();
+  }
+
+  size_t FrameIndex::keyframe_before(size_t frame) const {
+    std::vector<size_t>::const_iterator it =
+      std::upper_bound(m_keyframes.begin(), m_keyframes.end(), frame);
+    if (it == m_keyframes.begin()) return 0;
+    return *(--it);
+  }
+
+  size_t FrameIndex::keyframe_after(size_t frame) const {
+    std::vector<size_t>::const_iterator it =
+      std::lower_bound(m_keyframes.begin(), m_keyframes.end(), frame);
+    if (it == m_keyframes.end()) return m_size;
+    return *it;
+  }
+
+  int64_t FrameIndex::seek_timestamp(size_t keyframe) const {
+    std::vector<size_t>::const_iterator it =
+      std::lower_bound(m_keyframes.begin(), m_keyframes.end(), keyframe);
+    if (it == m_keyframes.end() || *it != keyframe) return AV_NOPTS_VALUE;
+    return m_keyframe_ts[it - m_keyframes.begin()];
+  }
+
+}}}
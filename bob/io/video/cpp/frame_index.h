@@ -0,0 +1,117 @@
+#ifndef BOB_IO_VIDEO_FRAME_INDEX_H
+#define BOB_IO_VIDEO_FRAME_INDEX_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include "mapped_file.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * An index of the frames in the video stream of a file, built by demuxing
+   * (but not decoding) the whole file once. It maps frame numbers (in
+   * presentation order) to timestamps and tells where the keyframes are, so
+   * readers can seek close to any frame instead of decoding from the start.
+   *
+   * Objects of this type are immutable after construction and can be freely
+   * shared.
+   */
+  class FrameIndex {
+
+    public:
+
+      /**
+       * Scans the video stream in the given file. If a memory mapping of the
+       * file is given, it is used for reading.
+       */
+      FrameIndex(const std::string& filename,
+          boost::shared_ptr<const MappedFile> mapping=boost::shared_ptr<const MappedFile>());
+
+      /**
+       * Destructor virtualization
+       */
+      virtual ~FrameIndex();
+
+      /**
+       * Tells if the timestamps in the stream can be used for seeking. This
+       * is not the case, for example, if some packets carry no timestamps or
+       * if no keyframes were found.
+       */
+      inline bool usable() const { return m_usable; }
+
+      /**
+       * Number of frames (packets) in the video stream
+       */
+      inline size_t size() const { return m_size; }
+
+      /**
+       * The time base of the timestamps in this index
+       */
+      inline AVRational time_base() const { return m_time_base; }
+
+      /**
+       * The presentation timestamp of the given frame, in time_base() units.
+       * Only valid if usable().
+       */
+      int64_t pts(size_t frame) const;
+
+      /**
+       * The number of the frame with the given presentation timestamp, or -1
+       * if there is no such frame (or the index is not usable).
+       */
+      int64_t frame_at(int64_t pts) const;
+
+      /**
+       * The number of the first frame with a presentation timestamp at or
+       * after the given one, or size() if there is no such frame (or the
+       * index is not usable).
+       */
+      size_t frame_from(int64_t pts) const;
+
+      /**
+       * The number of the last keyframe at or before the given frame. Returns
+       * 0 if there is no such keyframe (or the index is not usable).
+       */
+      size_t keyframe_before(size_t frame) const;
+
+      /**
+       * The number of the first keyframe at or after the given frame.
+       * Returns size() if there is no such keyframe (or the index is not
+       * usable).
+       */
+      size_t keyframe_after(size_t frame) const;
+
+      /**
+       * The timestamp to pass to av_seek_frame() to land on the given
+       * keyframe, as returned by keyframe_before().
+       */
+      int64_t seek_timestamp(size_t keyframe) const;
+
+    private: //not implemented
+
+      FrameIndex(const FrameIndex& other);
+
+      FrameIndex& operator= (const FrameIndex& other);
+
+    private: //representation
+
+      bool m_usable; ///< timestamps can be used for seeking
+      size_t m_size; ///< number of frames
+      AVRational m_time_base; ///< time base of timestamps
+      std::vector<int64_t> m_pts; ///< sorted presentation timestamps
+      std::vector<size_t> m_keyframes; ///< sorted keyframe numbers
+      std::vector<int64_t> m_keyframe_ts; ///< seek targets for keyframes
+
+  };
+
+}}}
+
+#endif /* BOB_IO_VIDEO_FRAME_INDEX_H */
@@ -0,0 +1,45 @@
+#include "input_stream.h"
+
+#include <cerrno>
+#include <boost/format.hpp>
+#include <unistd.h>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+namespace bob { namespace io { namespace video {
+
+  InputStream::InputStream(const std::string& name) :
+    m_name(name)
+  {
+  }
+
+  InputStream::~InputStream() {
+  }
+
+  static std::string fd_name(int fd) {
+    boost::format m("<fd %d>");
+    m % fd;
+    return m.str();
+  }
+
+  FileDescriptorInputStream::FileDescriptorInputStream(int fd) :
+    InputStream(fd_name(fd)),
+    m_fd(fd)
+  {
+  }
+
+  FileDescriptorInputStream::~FileDescriptorInputStream() {
+  }
+
+  int FileDescriptorInputStream::read(uint8_t* buffer, int size) {
+    ssize_t n;
+    do {
+      n = ::read(m_fd, buffer, size);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return AVERROR(errno);
+    return n;
+  }
+
+}}}
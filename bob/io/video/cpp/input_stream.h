@@ -0,0 +1,88 @@
+#ifndef BOB_IO_VIDEO_INPUT_STREAM_H
+#define BOB_IO_VIDEO_INPUT_STREAM_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * A forward-only (non-seekable) source of bytes, such as a pipe or a
+   * socket, that can feed the FFmpeg demuxer through a custom AVIOContext.
+   * Implement read() to plug in other types of sources.
+   */
+  class InputStream {
+
+    public:
+
+      /**
+       * Builds a new stream with the given (printable) name, used for
+       * reporting.
+       */
+      InputStream(const std::string& name);
+
+      /**
+       * Destructor virtualization
+       */
+      virtual ~InputStream();
+
+      /**
+       * A printable name for this stream
+       */
+      inline const std::string& name() const { return m_name; }
+
+      /**
+       * Reads at most 'size' bytes into 'buffer'. Returns the number of bytes
+       * read, zero when the stream has reached its end or a negative FFmpeg
+       * error code (AVERROR(errno)) in case of problems. Implementations
+       * should not throw, as they are called from within FFmpeg.
+       */
+      virtual int read(uint8_t* buffer, int size) =0;
+
+    private: //not implemented
+
+      InputStream(const InputStream& other);
+
+      InputStream& operator= (const InputStream& other);
+
+    private: //representation
+
+      std::string m_name; ///< printable name
+
+  };
+
+  /**
+   * A stream reading from an (already open) file descriptor, e.g. the
+   * reading end of a pipe. The descriptor is not closed by this object.
+   */
+  class FileDescriptorInputStream: public InputStream {
+
+    public:
+
+      /**
+       * Reads from the given file descriptor
+       */
+      FileDescriptorInputStream(int fd);
+
+      /**
+       * Destructor virtualization
+       */
+      virtual ~FileDescriptorInputStream();
+
+      /**
+       * The file descriptor being read
+       */
+      inline int fd() const { return m_fd; }
+
+      virtual int read(uint8_t* buffer, int size);
+
+    private: //representation
+
+      int m_fd; ///< the file descriptor to read from
+
+  };
+
+}}}
+
+#endif /* BOB_IO_VIDEO_INPUT_STREAM_H */
@@ -0,0 +1,81 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <boost/format.hpp>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * Size of the region we ask the kernel to prefetch when the file is first
+   * mapped (container headers live there).
+   */
+  static const size_t HEADER_PREFETCH = 1 << 20;
+
+  MappedFile::MappedFile(const std::string& filename) :
+    m_filename(filename),
+    m_data(0),
+    m_size(0)
+  {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      int error = errno;
+      boost::format m("bob::io::video::open(filename=`%s', O_RDONLY) failed: cannot open file for memory mapping - system reports error %d == `%s'");
+      m % filename % error % std::strerror(error);
+      throw std::runtime_error(m.str());
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      int error = errno;
+      ::close(fd);
+      boost::format m("bob::io::video::fstat(filename=`%s') failed: cannot get file size for memory mapping - system reports error %d == `%s'");
+      m % filename % error % std::strerror(error);
+      throw std::runtime_error(m.str());
+    }
+
+    if (!S_ISREG(st.st_mode) || st.st_size <= 0) {
+      ::close(fd);
+      boost::format m("bob::io::video::MappedFile(filename=`%s') failed: only non-empty regular files can be memory mapped");
+      m % filename;
+      throw std::runtime_error(m.str());
+    }
+
+    void* data = ::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd); ///< the mapping keeps its own reference to the file
+
+    if (data == MAP_FAILED) {
+      boost::format m("bob::io::video::mmap(filename=`%s', size=%d) failed: system reports error %d == `%s'");
+      m % filename % st.st_size % error % std::strerror(error);
+      throw std::runtime_error(m.str());
+    }
+
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = st.st_size;
+
+    will_need(0, HEADER_PREFETCH);
+  }
+
+  MappedFile::~MappedFile() {
+    if (m_data) ::munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+
+  void MappedFile::will_need(size_t offset, size_t length) const {
+    if (offset >= m_size) return;
+    if (length > m_size - offset) length = m_size - offset;
+
+    // madvise() requires page-aligned addresses
+    static const size_t page = ::sysconf(_SC_PAGESIZE);
+    size_t aligned = offset - (offset % page);
+    ::madvise(const_cast<uint8_t*>(m_data) + aligned, length + (offset - aligned),
+        MADV_WILLNEED);
+  }
+
+}}}
@@ -0,0 +1,71 @@
+#ifndef BOB_IO_VIDEO_MAPPED_FILE_H
+#define BOB_IO_VIDEO_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * A read-only memory mapping of a whole (local) video file. The mapping is
+   * established with MAP_SHARED, so pages are served from the operating
+   * system's page cache and are shared by every reader, iterator and process
+   * accessing the same file. Objects of this type are immutable after
+   * construction and can be freely shared between threads.
+   */
+  class MappedFile {
+
+    public:
+
+      /**
+       * Maps the given file in memory or raises, if that is not possible
+       * (e.g. the file does not exist, it is empty or it is not a regular
+       * file).
+       */
+      MappedFile(const std::string& filename);
+
+      /**
+       * Unmaps the file
+       */
+      virtual ~MappedFile();
+
+      /**
+       * The name of the file that was mapped
+       */
+      inline const std::string& filename() const { return m_filename; }
+
+      /**
+       * Start of the mapped region
+       */
+      inline const uint8_t* data() const { return m_data; }
+
+      /**
+       * Size of the mapped region, in bytes
+       */
+      inline size_t size() const { return m_size; }
+
+      /**
+       * Hints the kernel that the given region (clipped to the mapping) will
+       * be read soon (madvise(MADV_WILLNEED)). This is a hint only and never
+       * fails.
+       */
+      void will_need(size_t offset, size_t length) const;
+
+    private: //not implemented
+
+      MappedFile(const MappedFile& other);
+
+      MappedFile& operator= (const MappedFile& other);
+
+    private: //representation
+
+      std::string m_filename; ///< the name of the file mapped
+      const uint8_t* m_data; ///< start of the mapped region
+      size_t m_size; ///< size of the mapped region
+
+  };
+
+}}}
+
+#endif /* BOB_IO_VIDEO_MAPPED_FILE_H */
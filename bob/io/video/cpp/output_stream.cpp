@@ -0,0 +1,65 @@
+#include "output_stream.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/avutil.h>
+#include <libavformat/avio.h>
+}
+
+namespace bob { namespace io { namespace video {
+
+  OutputStream::OutputStream(const std::string& name) :
+    m_name(name)
+  {
+  }
+
+  OutputStream::~OutputStream() {
+  }
+
+  bool OutputStream::seekable() const {
+    return false;
+  }
+
+  int64_t OutputStream::seek(int64_t, int) {
+    return AVERROR(ENOSYS);
+  }
+
+  MemoryOutputStream::MemoryOutputStream() :
+    OutputStream("<memory>"),
+    m_pos(0)
+  {
+  }
+
+  MemoryOutputStream::~MemoryOutputStream() {
+  }
+
+  int MemoryOutputStream::write(const uint8_t* buffer, int size) {
+    //muxers may go back to fill in headers, overwriting what was written
+    if (m_pos + size > m_data.size()) m_data.resize(m_pos + size);
+    std::memcpy(m_data.data() + m_pos, buffer, size);
+    m_pos += size;
+    return size;
+  }
+
+  bool MemoryOutputStream::seekable() const {
+    return true;
+  }
+
+  int64_t MemoryOutputStream::seek(int64_t offset, int whence) {
+    int64_t pos;
+    switch (whence & ~AVSEEK_FORCE) {
+      case AVSEEK_SIZE: return m_data.size();
+      case SEEK_SET: pos = offset; break;
+      case SEEK_CUR: pos = m_pos + offset; break;
+      case SEEK_END: pos = m_data.size() + offset; break;
+      default: return AVERROR(EINVAL);
+    }
+    if (pos < 0) return AVERROR(EINVAL);
+    m_pos = pos; ///< writing past the end fills the gap with zeros
+    return pos;
+  }
+
+}}}
@@ -0,0 +1,110 @@
+#ifndef BOB_IO_VIDEO_OUTPUT_STREAM_H
+#define BOB_IO_VIDEO_OUTPUT_STREAM_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * A sink of bytes, such as a memory buffer or a socket, that the FFmpeg
+   * muxer can write to through a custom AVIOContext. Implement write() (and,
+   * for sinks that can go back, seekable() and seek()) to plug in other
+   * types of sinks.
+   */
+  class OutputStream {
+
+    public:
+
+      /**
+       * Builds a new stream with the given (printable) name, used for
+       * reporting and, if it looks like a filename, to guess the output
+       * format from its extension.
+       */
+      OutputStream(const std::string& name);
+
+      /**
+       * Destructor virtualization
+       */
+      virtual ~OutputStream();
+
+      /**
+       * A printable name for this stream
+       */
+      inline const std::string& name() const { return m_name; }
+
+      /**
+       * Writes 'size' bytes from 'buffer'. Returns the number of bytes
+       * written or a negative FFmpeg error code (AVERROR(errno)) in case of
+       * problems. Implementations should not throw, as they are called from
+       * within FFmpeg.
+       */
+      virtual int write(const uint8_t* buffer, int size) =0;
+
+      /**
+       * Tells if seek() may be used. Muxers that go back to fill in headers
+       * once the file is written (e.g. MP4) need it, unless they write
+       * fragmented files.
+       */
+      virtual bool seekable() const;
+
+      /**
+       * Moves the writing position as fseek() would ('whence' is SEEK_SET,
+       * SEEK_CUR or SEEK_END) and returns it, or returns a negative FFmpeg
+       * error code. If 'whence' is AVSEEK_SIZE, returns the size of the
+       * stream without moving. The default implementation cannot seek.
+       */
+      virtual int64_t seek(int64_t offset, int whence);
+
+    private: //not implemented
+
+      OutputStream(const OutputStream& other);
+
+      OutputStream& operator= (const OutputStream& other);
+
+    private: //representation
+
+      std::string m_name; ///< printable name
+
+  };
+
+  /**
+   * A stream writing into a growable memory buffer, which can be sought
+   */
+  class MemoryOutputStream: public OutputStream {
+
+    public:
+
+      /**
+       * Starts with an empty buffer
+       */
+      MemoryOutputStream();
+
+      /**
+       * Destructor virtualization
+       */
+      virtual ~MemoryOutputStream();
+
+      /**
+       * The bytes written so far
+       */
+      inline const std::vector<uint8_t>& data() const { return m_data; }
+
+      virtual int write(const uint8_t* buffer, int size);
+
+      virtual bool seekable() const;
+
+      virtual int64_t seek(int64_t offset, int whence);
+
+    private: //representation
+
+      std::vector<uint8_t> m_data; ///< the bytes written
+      size_t m_pos; ///< the writing position
+
+  };
+
+}}}
+
+#endif /* BOB_IO_VIDEO_OUTPUT_STREAM_H */
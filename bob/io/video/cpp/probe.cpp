@@ -0,0 +1,71 @@
+#include "probe.h"
+#include "utils.h"
+
+namespace bob { namespace io { namespace video {
+
+  Probe probe(const std::string& filename, int64_t probesize,
+      int64_t analyzeduration) {
+    return probe(filename,
+        make_probe_format_context(filename, probesize, analyzeduration));
+  }
+
+  Probe probe(const std::string& filename,
+      boost::shared_ptr<AVFormatContext> format_context) {
+
+    Probe retval;
+    retval.filename = filename;
+
+    retval.format_name = format_context->iformat->name;
+    if (format_context->iformat->long_name)
+      retval.format_long_name = format_context->iformat->long_name;
+
+    int stream_index = find_video_stream(filename, format_context);
+    AVStream* stream = format_context->streams[stream_index];
+    AVCodecParameters* codecpar = stream->codecpar;
+
+    // names of the decoder that would be used, without opening it
+    const AVCodec* codec = avcodec_find_decoder(codecpar->codec_id);
+    const AVCodecDescriptor* descriptor =
+      avcodec_descriptor_get(codecpar->codec_id);
+    if (codec) {
+      retval.codec_name = codec->name;
+      if (codec->long_name) retval.codec_long_name = codec->long_name;
+    }
+    else if (descriptor) {
+      retval.codec_name = descriptor->name;
+      if (descriptor->long_name)
+        retval.codec_long_name = descriptor->long_name;
+    }
+
+    retval.width = codecpar->width;
+    retval.height = codecpar->height;
+
+    if (format_context->duration != (int64_t)AV_NOPTS_VALUE) {
+      retval.duration = format_context->duration;
+    }
+    else if (stream->duration != (int64_t)AV_NOPTS_VALUE) {
+      AVRational microseconds = {1, AV_TIME_BASE};
+      retval.duration = av_rescale_q(stream->duration, stream->time_base,
+          microseconds);
+    }
+    else retval.duration = 0;
+
+    retval.number_of_frames = stream->nb_frames;
+    if (retval.number_of_frames > 0) {
+      //number of frames is known
+      retval.frame_rate = retval.duration?
+        (double(retval.number_of_frames) * AV_TIME_BASE) / double(retval.duration) :
+        av_q2d(stream->avg_frame_rate);
+    }
+    else {
+      //number of frames is not known
+      retval.frame_rate = av_q2d(stream->avg_frame_rate);
+      // removed the use of r_frame_rate as it is depricated now and libAV advices to use avg_frame_rate instead
+      //retval.frame_rate = av_q2d(stream->r_frame_rate);
+      retval.number_of_frames = (int)(retval.frame_rate * retval.duration / AV_TIME_BASE);
+    }
+
+    return retval;
+  }
+
+}}}
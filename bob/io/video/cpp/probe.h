@@ -0,0 +1,56 @@
+#ifndef BOB_IO_VIDEO_PROBE_H
+#define BOB_IO_VIDEO_PROBE_H
+
+#include <string>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * Metadata about the (first) video stream of a file, as reported by its
+   * container.
+   */
+  struct Probe {
+    std::string filename; ///< the name of the file probed
+    std::string format_name; ///< the name of the ffmpeg format
+    std::string format_long_name; ///< long version of format_name
+    std::string codec_name; ///< the name of the ffmpeg codec
+    std::string codec_long_name; ///< long version of codec_name
+    size_t height; ///< the height of the video frames (number of rows)
+    size_t width; ///< the width of the video frames (number of columns)
+    size_t number_of_frames; ///< the number of frames (may be estimated)
+    double frame_rate; ///< rate of frames in the video stream
+    uint64_t duration; ///< in microseconds, for the whole video
+  };
+
+  /**
+   * Reads the metadata of the video stream in a file, without ever opening
+   * a decoder. Values are read from the stream parameters set by the
+   * demuxer. The container header is often enough: packets are only read if
+   * it does not describe the stream, within the given limits - 'probesize'
+   * (in bytes) and 'analyzeduration' (in microseconds). Zero means FFmpeg's
+   * defaults. A Reader always reads packets to complete the stream
+   * information, so on files with incomplete headers the frame rate and the
+   * number of frames it reports may differ from the ones probed here.
+   *
+   * Raises if the file cannot be opened or contains no video stream.
+   */
+  Probe probe(const std::string& filename, int64_t probesize=0,
+      int64_t analyzeduration=0);
+
+  /**
+   * Describes the video stream of an already opened input format context.
+   * This is what probe() and Reader use to fill in their metadata.
+   */
+  Probe probe(const std::string& filename,
+      boost::shared_ptr<AVFormatContext> format_context);
+
+}}}
+
+#endif /* BOB_IO_VIDEO_PROBE_H */
@@ -3,40 +3,162 @@
 #include <stdexcept>
 #include <boost/format.hpp>
 #include <boost/preprocessor.hpp>
+#include <boost/make_shared.hpp>
 #include <limits>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
 
 #include <bob.io.base/blitz_array.h>
 
+extern "C" {
+#include <libavutil/pixdesc.h>
+#include <libavutil/motion_vector.h>
+}
+
+#include "convert.h"
+
 namespace bob { namespace io { namespace video {
 
-  Reader::Reader(const std::string& filename, bool check) {
+  /**
+   * Describes the frames we store in the FrameCache: RGB, 8 bits per band, in
+   * C-order. The layout is appended to this and, for other output types,
+   * their element type, scale and offset.
+   */
+  static const std::string CACHE_FORMAT("rgb24");
+
+  static bob::io::base::array::ElementType output_dtype
+    (Reader::OutputType type) {
+    switch (type) {
+      case Reader::FLOAT32: return bob::io::base::array::t_float32;
+      case Reader::FLOAT16: return bob::io::base::array::t_uint16;
+      default: return bob::io::base::array::t_uint8;
+    }
+  }
+
+  static bool is_contiguous(const bob::io::base::array::typeinfo& info) {
+    return (info.stride[2] == 1) &&
+      (info.stride[1] == info.shape[2]) &&
+      (info.stride[0] == info.shape[1]*info.shape[2]);
+  }
+
+  template <typename T>
+  static void copy_frame(const void* src, bob::io::base::array::interface& dst) {
+    const bob::io::base::array::typeinfo& info = dst.type();
+    blitz::TinyVector<int,3> shape;
+    blitz::TinyVector<int,3> stride;
+    shape = info.shape[0], info.shape[1], info.shape[2];
+    stride = info.stride[0], info.stride[1], info.stride[2];
+    blitz::Array<T,3> to(static_cast<T*>(dst.ptr()), shape, stride,
+        blitz::neverDeleteData);
+    blitz::Array<T,3> from(static_cast<T*>(const_cast<void*>(src)), shape,
+        blitz::neverDeleteData);
+    to = from;
+  }
+
+  /**
+   * Copies a frame stored in C-order at 'src' into 'dst', which may have any
+   * strides
+   */
+  static void copy_frame(const void* src, bob::io::base::array::interface& dst) {
+    switch (dst.type().dtype) {
+      case bob::io::base::array::t_float32:
+        copy_frame<float>(src, dst);
+        break;
+      case bob::io::base::array::t_uint16:
+        copy_frame<uint16_t>(src, dst);
+        break;
+      default:
+        copy_frame<uint8_t>(src, dst);
+    }
+  }
+
+  /**
+   * Tells how yuv_to_planar_rgb24() can convert a decoded picture. Like the
+   * scaler, only the JPEG formats are taken as full range.
+   */
+  static bool yuv_format(const AVFrame* frame, YUVFormat& format,
+      bool& full_range) {
+    full_range = false;
+    switch (frame->format) {
+      case AV_PIX_FMT_YUVJ420P:
+        full_range = true; //fall through
+      case AV_PIX_FMT_YUV420P:
+        format = YUV420P;
+        return true;
+      case AV_PIX_FMT_YUVJ422P:
+        full_range = true; //fall through
+      case AV_PIX_FMT_YUV422P:
+        format = YUV422P;
+        return true;
+      case AV_PIX_FMT_NV12:
+        format = NV12;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Reader::Reader(const std::string& filename, bool check, bool mmap) :
+    m_layout(PLANAR),
+    m_native_yuv(false)
+  {
+    store_output(UINT8, 0, 0);
+    if (mmap) m_mapping = boost::make_shared<MappedFile>(filename);
     open(filename, check);
   }
 
+  Reader::Reader(boost::shared_ptr<InputStream> stream, bool check) :
+    m_input(stream),
+    m_layout(PLANAR),
+    m_native_yuv(false)
+  {
+    store_output(UINT8, 0, 0);
+    open(stream->name(), check);
+  }
+
   Reader::Reader(const Reader& other) {
     *this = other;
   }
 
   Reader& Reader::operator= (const Reader& other) {
+    if (other.streaming()) {
+      boost::format m("bob::io::video::Reader::operator=(stream=`%s') failed: readers on forward-only input streams cannot be copied");
+      m % other.filename();
+      throw std::runtime_error(m.str());
+    }
+    m_mapping = other.m_mapping; ///< read-only, can be shared
+    m_index = other.built_frame_index(); ///< idem
+    m_input.reset();
+    m_input_context.reset();
+    m_layout = other.m_layout;
+    m_native_yuv = other.m_native_yuv;
+    store_output(other.m_output, other.m_scale, other.m_offset);
     open(other.filename(), other.m_check);
     return *this;
   }
 
   void Reader::open(const std::string& filename, bool check) {
     m_filepath = filename;
+    m_check = check;
+    if (!m_input) m_identity = FrameCache::file_identity(m_filepath);
 
-    boost::shared_ptr<AVFormatContext> format_ctxt =
-      make_input_format_context(m_filepath);
+    boost::shared_ptr<AVFormatContext> format_ctxt = m_input?
+      make_input_format_context(m_filepath, m_input) :
+      make_input_format_context(m_filepath, m_mapping);
 
-    m_formatname = format_ctxt->iformat->name;
-    m_formatname_long = format_ctxt->iformat->long_name;
+    Probe info = probe(m_filepath, format_ctxt);
 
-    int stream_index = find_video_stream(m_filepath, format_ctxt);
+    m_formatname = info.format_name;
+    m_formatname_long = info.format_long_name;
 
-    AVCodec* codec = find_decoder(m_filepath, format_ctxt, stream_index);
+    //makes sure we can decode this stream
+    int stream_index = find_video_stream(m_filepath, format_ctxt);
+    find_decoder(m_filepath, format_ctxt, stream_index);
 
-    m_codecname = codec->name;
-    m_codecname_long = codec->long_name;
+    m_codecname = info.codec_name;
+    m_codecname_long = info.codec_long_name;
 
     /**
      * Runs a format/codec check on user request
@@ -54,28 +176,28 @@ namespace bob { namespace io { namespace video {
       }
     }
 
-    boost::shared_ptr<AVCodecContext> codec_ctxt =
-      make_decoder_context(m_filepath, format_ctxt->streams[stream_index],
-          codec);
-
     /**
-     * Copies some information from the context just opened
+     * Copies some information from the stream parameters (we don't need to
+     * open a decoder for this)
      */
-    m_width = codec_ctxt->width;
-    m_height = codec_ctxt->height;
-    m_duration = format_ctxt->duration;
-    m_nframes = format_ctxt->streams[stream_index]->nb_frames;
-    if (m_nframes > 0) {
-      //number of frames is known
-      m_framerate = (double(m_nframes) * AV_TIME_BASE) / double(m_duration);
-    }
-    else {
-      //number of frames is not known
-      m_framerate = av_q2d(format_ctxt->streams[stream_index]->avg_frame_rate);
-      // removed the use of r_frame_rate as it is depricated now and libAV advices to use avg_frame_rate instead
-      //m_framerate = av_q2d(format_ctxt->streams[stream_index]->r_frame_rate);
-      m_nframes = (int)(m_framerate * m_duration / AV_TIME_BASE);
-    }
+    m_width = info.width;
+    m_height = info.height;
+    m_duration = info.duration;
+    m_nframes = info.number_of_frames;
+    m_framerate = info.frame_rate;
+
+    AVStream* stream = format_ctxt->streams[stream_index];
+    m_bitrate = (stream->codecpar->bit_rate > 0)? stream->codecpar->bit_rate : 0;
+    m_time_base = stream->time_base;
+    m_start_pts = (stream->start_time != (int64_t)AV_NOPTS_VALUE)?
+      stream->start_time : 0;
+
+    //frames are located from timestamps estimated from the frame rate, as
+    //long as it is constant
+    AVRational rate = stream->avg_frame_rate;
+    m_frame_ticks = (rate.num > 0 && rate.den > 0 &&
+        !av_cmp_q(rate, stream->r_frame_rate))?
+      1. / (av_q2d(rate) * av_q2d(m_time_base)) : 0.;
 
     /**
      * This will create a local description of the contents of the stream, in
@@ -101,19 +223,156 @@ namespace bob { namespace io { namespace video {
     /**
      * This will make sure we can interface with the io subsystem
      */
-    m_typeinfo_video.dtype = m_typeinfo_frame.dtype = bob::io::base::array::t_uint8;
+    update_types();
+
+    //keeps the stream context around for the first iterator, as the stream
+    //cannot be re-opened
+    if (m_input) m_input_context = format_ctxt;
+
+  }
+
+  Reader::~Reader() {
+  }
+
+  void Reader::update_types() {
+    m_typeinfo_video.dtype = m_typeinfo_frame.dtype = output_dtype(m_output);
     m_typeinfo_video.nd = 4;
     m_typeinfo_frame.nd = 3;
     m_typeinfo_video.shape[0] = m_nframes;
-    m_typeinfo_video.shape[1] = m_typeinfo_frame.shape[0] = 3;
-    m_typeinfo_video.shape[2] = m_typeinfo_frame.shape[1] = m_height;
-    m_typeinfo_video.shape[3] = m_typeinfo_frame.shape[2] = m_width;
+    if (m_layout == PACKED) {
+      m_typeinfo_video.shape[1] = m_typeinfo_frame.shape[0] = m_height;
+      m_typeinfo_video.shape[2] = m_typeinfo_frame.shape[1] = m_width;
+      m_typeinfo_video.shape[3] = m_typeinfo_frame.shape[2] = 3;
+    }
+    else {
+      m_typeinfo_video.shape[1] = m_typeinfo_frame.shape[0] = 3;
+      m_typeinfo_video.shape[2] = m_typeinfo_frame.shape[1] = m_height;
+      m_typeinfo_video.shape[3] = m_typeinfo_frame.shape[2] = m_width;
+    }
     m_typeinfo_frame.update_strides();
     m_typeinfo_video.update_strides();
+  }
+
+  void Reader::store_output(OutputType type, const float* scale,
+      const float* offset) {
 
+    if (type != UINT8 && type != FLOAT32 && type != FLOAT16) {
+      boost::format m("bob::io::video::Reader::set_output(filename=`%s') failed: unsupported output type (%d)");
+      m % m_filepath % (int)type;
+      throw std::runtime_error(m.str());
+    }
+
+    for (size_t k=0; k<3; ++k) {
+      bool scaled = (scale && scale[k] != 1.f) || (offset && offset[k] != 0.f);
+      if (type == UINT8 && scaled) {
+        boost::format m("bob::io::video::Reader::set_output(filename=`%s') failed: only floating-point outputs can be scaled");
+        m % m_filepath;
+        throw std::runtime_error(m.str());
+      }
+    }
+
+    m_output = type;
+    for (size_t k=0; k<3; ++k) {
+      m_scale[k] = scale? scale[k] : 1.f;
+      m_offset[k] = offset? offset[k] : 0.f;
+    }
+
+    //frames are only served from the cache in the same output format
+    std::ostringstream format;
+    format.precision(std::numeric_limits<float>::digits10 + 3);
+    format << CACHE_FORMAT << ((m_layout == PACKED)? "/packed" : "/planar");
+    if (m_native_yuv && m_layout == PLANAR) format << "/native";
+    if (m_output != UINT8) {
+      format << ((m_output == FLOAT32)? "/float32" : "/float16");
+      format << "/scale=" << m_scale[0] << ',' << m_scale[1] << ',' << m_scale[2];
+      format << "/offset=" << m_offset[0] << ',' << m_offset[1] << ',' << m_offset[2];
+    }
+    m_output_format = format.str();
   }
 
-  Reader::~Reader() {
+  void Reader::set_output(OutputType type, const float* scale,
+      const float* offset) {
+    store_output(type, scale, offset);
+    update_types();
+  }
+
+  void Reader::set_layout(Layout layout) {
+    if (layout != PLANAR && layout != PACKED) {
+      boost::format m("bob::io::video::Reader::set_layout(filename=`%s') failed: unsupported layout (%d)");
+      m % m_filepath % (int)layout;
+      throw std::runtime_error(m.str());
+    }
+    m_layout = layout;
+    store_output(m_output, m_scale, m_offset); //updates the cache format
+    update_types();
+  }
+
+  void Reader::set_native_yuv(bool native) {
+    m_native_yuv = native;
+    store_output(m_output, m_scale, m_offset); //updates the cache format
+  }
+
+  bool Reader::convert(const AVFrame* frame, void* dst, uint8_t* buffer) const {
+    YUVFormat format;
+    bool full_range;
+    if (!yuv_format(frame, format, full_range)) return false;
+    if (frame->width != (int)m_width || frame->height != (int)m_height)
+      return false;
+
+    uint8_t* rgb = (m_output == UINT8)? static_cast<uint8_t*>(dst) : buffer;
+    yuv_to_planar_rgb24(format, full_range, frame->data, frame->linesize,
+        m_height, m_width, rgb);
+
+    switch (m_output) {
+      case FLOAT32:
+        planar_to_float32(rgb, m_height, m_width, static_cast<float*>(dst),
+            m_scale, m_offset);
+        break;
+      case FLOAT16:
+        planar_to_float16(rgb, m_height, m_width,
+            static_cast<uint16_t*>(dst), m_scale, m_offset);
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+
+  void Reader::convert(const blitz::Array<uint8_t,3>& rgb, void* dst) const {
+    if (m_layout == PACKED) {
+      switch (m_output) {
+        case FLOAT32:
+          rgb24_to_packed_float32(rgb.data(), rgb.extent(0), rgb.extent(1),
+              static_cast<float*>(dst), m_scale, m_offset);
+          break;
+        case FLOAT16:
+          rgb24_to_packed_float16(rgb.data(), rgb.extent(0), rgb.extent(1),
+              static_cast<uint16_t*>(dst), m_scale, m_offset);
+          break;
+        default:
+          std::memcpy(dst, rgb.data(), rgb.size());
+      }
+      return;
+    }
+
+    switch (m_output) {
+      case FLOAT32:
+        rgb24_to_planar_float32(rgb.data(), rgb.extent(0), rgb.extent(1),
+            static_cast<float*>(dst), m_scale, m_offset);
+        break;
+      case FLOAT16:
+        rgb24_to_planar_float16(rgb.data(), rgb.extent(0), rgb.extent(1),
+            static_cast<uint16_t*>(dst), m_scale, m_offset);
+        break;
+      default:
+        {
+          //now we copy from one container to the other, using our Blitz++ technique
+          blitz::Array<uint8_t,3> planar(static_cast<uint8_t*>(dst),
+              blitz::shape(rgb.extent(2), rgb.extent(0), rgb.extent(1)),
+              blitz::neverDeleteData);
+          planar = rgb.transpose(2,0,1);
+        }
+    }
   }
 
   size_t Reader::load(blitz::Array<uint8_t,4>& data,
@@ -124,23 +383,43 @@ namespace bob { namespace io { namespace video {
 
   size_t Reader::load(bob::io::base::array::interface& b,
       bool throw_on_error, void (*check)(void)) const {
+    return load(b, (std::vector<FrameInfo>*)0, throw_on_error, check);
+  }
+
+  size_t Reader::load(bob::io::base::array::interface& b,
+      std::vector<FrameInfo>& info, bool throw_on_error,
+      void (*check)(void)) const {
+    return load(b, &info, throw_on_error, check);
+  }
+
+  size_t Reader::load(bob::io::base::array::interface& b,
+      std::vector<FrameInfo>* info, bool throw_on_error,
+      void (*check)(void)) const {
 
     //checks if the output array shape conforms to the video specifications,
-    //otherwise, throw.
-    if (!m_typeinfo_video.is_compatible(b.type())) {
+    //otherwise, throw. Streaming readers accept any number of frames.
+    bob::io::base::array::typeinfo video_type(m_typeinfo_video);
+    if (streaming() && b.type().nd == 4) {
+      video_type.shape[0] = b.type().shape[0];
+      video_type.update_strides();
+    }
+    if (!video_type.is_compatible(b.type())) {
       boost::format s("input buffer (%s) does not conform to the video size specifications (%s)");
-      s % b.type().str() % m_typeinfo_video.str();
+      s % b.type().str() % video_type.str();
       throw std::runtime_error(s.str());
     }
 
     unsigned long int frame_size = m_typeinfo_frame.buffer_size();
     uint8_t* ptr = static_cast<uint8_t*>(b.ptr());
     size_t frames_read = 0;
+    size_t capacity = video_type.shape[0];
 
-    for (const_iterator it=begin(); it!=end();) {
+    for (const_iterator it=begin(); it!=end() && frames_read<capacity;) {
       if (check) check(); ///< runs user check function before we start our work
       bob::io::base::array::blitz_array ref(static_cast<void*>(ptr), m_typeinfo_frame);
-      if (it.read(ref, throw_on_error)) {
+      FrameInfo frame_info;
+      if (it.read(ref, info? &frame_info : 0, throw_on_error)) {
+        if (info) info->push_back(frame_info);
         ptr += frame_size;
         ++frames_read;
       }
@@ -150,6 +429,234 @@ namespace bob { namespace io { namespace video {
     return frames_read;
   }
 
+  size_t Reader::load(bob::io::base::array::interface& b, size_t start,
+      size_t stop, size_t step, bool throw_on_error,
+      void (*check)(void)) const {
+    return load(b, (std::vector<FrameInfo>*)0, start, stop, step,
+        throw_on_error, check);
+  }
+
+  size_t Reader::load(bob::io::base::array::interface& b,
+      std::vector<FrameInfo>& info, size_t start, size_t stop, size_t step,
+      bool throw_on_error, void (*check)(void)) const {
+    return load(b, &info, start, stop, step, throw_on_error, check);
+  }
+
+  size_t Reader::load(bob::io::base::array::interface& b,
+      std::vector<FrameInfo>* info, size_t start, size_t stop, size_t step,
+      bool throw_on_error, void (*check)(void)) const {
+
+    if (!step) {
+      boost::format m("bob::io::video::Reader::load(filename=`%s', start=%d, stop=%d, step=%d) failed: the step cannot be zero");
+      m % m_filepath % start % stop % step;
+      throw std::runtime_error(m.str());
+    }
+
+    //the output array must hold exactly the frames in the range
+    if (!streaming()) stop = std::min(stop, m_nframes);
+    size_t count = (stop > start)? ((stop - start - 1) / step + 1) : 0;
+    bob::io::base::array::typeinfo range_type(m_typeinfo_video);
+    range_type.shape[0] = count;
+    range_type.update_strides();
+    if (!range_type.is_compatible(b.type())) {
+      boost::format s("input buffer (%s) does not conform to the size specifications of frames [%d:%d:%d] of the video (%s)");
+      s % b.type().str() % start % stop % step % range_type.str();
+      throw std::runtime_error(s.str());
+    }
+
+    unsigned long int frame_size = m_typeinfo_frame.buffer_size();
+    uint8_t* ptr = static_cast<uint8_t*>(b.ptr());
+    size_t frames_read = 0;
+    if (!count) return 0;
+
+    //seeks to the keyframe before 'start' and then, between frames, to the
+    //keyframes before the next one, if any, on the first read
+    const_iterator it = begin();
+    if (start) it.seek(start);
+
+    while (it != end() && frames_read < count) {
+      if (check) check(); ///< runs user check function before we start our work
+      bob::io::base::array::blitz_array ref(static_cast<void*>(ptr), m_typeinfo_frame);
+      FrameInfo frame_info;
+      if (!it.read(ref, info? &frame_info : 0, throw_on_error)) break;
+      if (info) info->push_back(frame_info);
+      ptr += frame_size;
+      ++frames_read;
+      if (step > 1 && frames_read < count) it.seek(it.cur() + step - 1);
+    }
+
+    return frames_read;
+  }
+
+  boost::shared_ptr<const FrameIndex> Reader::frame_index() const {
+    if (streaming()) {
+      boost::format m("bob::io::video::Reader::frame_index(stream=`%s') failed: forward-only input streams cannot be indexed");
+      m % m_filepath;
+      throw std::runtime_error(m.str());
+    }
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    if (!m_index) m_index = boost::make_shared<FrameIndex>(m_filepath, m_mapping);
+    return m_index;
+  }
+
+  boost::shared_ptr<const FrameIndex> Reader::built_frame_index() const {
+    std::lock_guard<std::mutex> lock(m_index_mutex);
+    return m_index;
+  }
+
+  int64_t Reader::estimated_pts(size_t frame) const {
+    return m_start_pts + llround(frame * m_frame_ticks);
+  }
+
+  int64_t Reader::estimated_frame(int64_t pts) const {
+    if (!estimated_seeking() || pts == (int64_t)AV_NOPTS_VALUE) return -1;
+    double frame = (pts - m_start_pts) / m_frame_ticks;
+    int64_t retval = llround(frame);
+    if (retval < 0 || std::fabs(frame - retval) > 0.25) return -1;
+    return retval;
+  }
+
+  size_t Reader::frame_at_time(double seconds) const {
+    if (streaming()) {
+      boost::format m("bob::io::video::Reader::frame_at_time(stream=`%s', seconds=%g) failed: forward-only input streams cannot be addressed by time");
+      m % m_filepath % seconds;
+      throw std::runtime_error(m.str());
+    }
+    if (!(seconds >= 0.)) seconds = 0.; ///< also catches NaNs
+
+    AVRational microseconds = {1, 1000000};
+    int64_t timestamp = m_start_pts + av_rescale_q_rnd(llround(seconds * 1e6),
+        microseconds, m_time_base, AV_ROUND_UP);
+
+    //without the frame index, decodes from the keyframe before that time
+    //up to the first frame presented at or after it
+    boost::shared_ptr<const FrameIndex> index = built_frame_index();
+    if (!index && estimated_seeking()) {
+      const_iterator it = begin();
+      if (!it.parent()) return 0; ///< no frames
+      int64_t found = it.seek_time(timestamp, false);
+      if (found >= 0) return std::min((size_t)found, m_nframes);
+    }
+
+    size_t frame;
+    if (!index) index = frame_index(); ///< timestamps cannot be estimated
+    if (index->usable()) frame = index->frame_from(timestamp);
+    else {
+      //no usable timestamps: estimates from the average frame rate
+      frame = std::ceil(std::floor(seconds * 1e6 + 0.5) * 1e-6 * m_framerate - 1e-6);
+    }
+
+    return std::min(frame, m_nframes);
+  }
+
+  size_t Reader::motion(std::vector<FrameMotion>& motion, size_t start,
+      size_t stop, double threshold, bool throw_on_error) const {
+
+    if (!streaming()) stop = std::min(stop, m_nframes);
+    if (start >= stop) return 0;
+
+    //the first frame is compared to the one before it, if any
+    const_iterator it = begin();
+    std::vector<uint8_t> previous, current;
+    if (start) {
+      if (start > 1) it.seek(start - 1);
+      if (it == end() || !it.luma(previous, throw_on_error)) return 0;
+    }
+
+    double last = std::numeric_limits<double>::quiet_NaN();
+    size_t frames = 0;
+    while (it != end() && it.cur() < stop) {
+      if (!it.luma(current, throw_on_error)) break;
+      FrameMotion m;
+      m.difference = previous.empty()?
+        std::numeric_limits<double>::quiet_NaN() :
+        (double)sum_abs_difference(&previous[0], &current[0],
+            current.size()) / current.size();
+      //comparisons with NaN are false: the first frame is always a cut
+      m.scene_cut = !(m.difference < threshold) &&
+        !(m.difference < 2 * last);
+      motion.push_back(m);
+      last = m.difference;
+      previous.swap(current);
+      ++frames;
+    }
+
+    return frames;
+  }
+
+  size_t Reader::motion_vectors(std::vector<MotionVector>& vectors,
+      size_t start, size_t stop, bool throw_on_error) const {
+
+    if (!streaming()) stop = std::min(stop, m_nframes);
+    if (start >= stop) return 0;
+
+    const_iterator it(this, true);
+    if (start) it.seek(start);
+
+    size_t frames = 0;
+    while (it != end() && it.cur() < stop) {
+      if (!it.motion_vectors(vectors, throw_on_error)) break;
+      ++frames;
+    }
+
+    return frames;
+  }
+
+  void rasterize_motion_vectors(const std::vector<MotionVector>& vectors,
+      size_t first, size_t frames, size_t height, size_t width, size_t block,
+      float* flow) {
+
+    if (!block) throw std::runtime_error("bob::io::video::rasterize_motion_vectors() failed: the block size cannot be zero");
+
+    size_t rows = (height + block - 1) / block;
+    size_t cols = (width + block - 1) / block;
+    size_t cells = rows * cols;
+    std::fill(flow, flow + frames * 2 * cells, 0.f);
+    std::vector<float> weights(frames * cells, 0.f);
+
+    for (size_t i=0; i<vectors.size(); ++i) {
+      const MotionVector& v = vectors[i];
+      if (v.frame < (int64_t)first || v.frame >= (int64_t)(first + frames))
+        continue;
+      //displacement from the past to the future
+      float dx = v.dst_x - v.src_x;
+      float dy = v.dst_y - v.src_y;
+      if (v.source > 0) { dx = -dx; dy = -dy; }
+
+      //block area, clipped to the frame
+      int64_t x0 = std::max<int64_t>(v.dst_x - v.w / 2, 0);
+      int64_t y0 = std::max<int64_t>(v.dst_y - v.h / 2, 0);
+      int64_t x1 = std::min<int64_t>(v.dst_x - v.w / 2 + v.w, width);
+      int64_t y1 = std::min<int64_t>(v.dst_y - v.h / 2 + v.h, height);
+      if (x0 >= x1 || y0 >= y1) continue;
+
+      size_t frame = v.frame - first;
+      float* fx = flow + frame * 2 * cells;
+      float* fy = fx + cells;
+      float* w = &weights[frame * cells];
+      for (int64_t r=y0/block; r<=(y1-1)/(int64_t)block; ++r) {
+        int64_t h = std::min<int64_t>(y1, (r+1)*block) -
+          std::max<int64_t>(y0, r*block);
+        for (int64_t c=x0/block; c<=(x1-1)/(int64_t)block; ++c) {
+          float area = h * (std::min<int64_t>(x1, (c+1)*block) -
+              std::max<int64_t>(x0, c*block));
+          fx[r*cols + c] += area * dx;
+          fy[r*cols + c] += area * dy;
+          w[r*cols + c] += area;
+        }
+      }
+    }
+
+    for (size_t frame=0; frame<frames; ++frame) {
+      float* fx = flow + frame * 2 * cells;
+      float* fy = fx + cells;
+      const float* w = &weights[frame * cells];
+      for (size_t k=0; k<cells; ++k) {
+        if (w[k] > 0) { fx[k] /= w[k]; fy[k] /= w[k]; }
+      }
+    }
+  }
+
   Reader::const_iterator Reader::begin() const {
     return Reader::const_iterator(this);
   }
@@ -158,35 +665,78 @@ namespace bob { namespace io { namespace video {
     return Reader::const_iterator();
   }
 
-  Reader::const_iterator::const_iterator(const Reader* parent) :
+  Reader::const_iterator::const_iterator(const Reader* parent,
+      bool motion_vectors) :
     m_parent(parent),
-    m_current_frame(std::numeric_limits<size_t>::max())
+    m_current_frame(std::numeric_limits<size_t>::max()),
+    m_decoder_frame(0),
+    m_pending(false),
+    m_motion_vectors(motion_vectors)
   {
     init();
   }
 
   Reader::const_iterator::const_iterator():
     m_parent(0),
-    m_current_frame(std::numeric_limits<size_t>::max())
+    m_current_frame(std::numeric_limits<size_t>::max()),
+    m_decoder_frame(0),
+    m_pending(false),
+    m_motion_vectors(false)
   {
   }
 
   Reader::const_iterator::const_iterator
     (const Reader::const_iterator& other) :
       m_parent(other.m_parent),
-      m_current_frame(std::numeric_limits<size_t>::max())
+      m_current_frame(std::numeric_limits<size_t>::max()),
+      m_decoder_frame(0),
+      m_pending(false),
+      m_motion_vectors(other.m_motion_vectors)
   {
+    if (m_parent && m_parent->streaming()) {
+      boost::format m("bob::io::video::Reader::const_iterator(stream=`%s') failed: iterators on forward-only input streams cannot be copied");
+      m % m_parent->filename();
+      throw std::runtime_error(m.str());
+    }
     init();
     (*this) += other.m_current_frame;
   }
 
+  Reader::const_iterator::const_iterator
+    (Reader::const_iterator&& other) :
+      m_parent(other.m_parent),
+      m_format_context(other.m_format_context),
+      m_stream_index(other.m_stream_index),
+      m_codec(other.m_codec),
+      m_stream(other.m_stream),
+      m_codec_context(other.m_codec_context),
+      m_context_frame(other.m_context_frame),
+      m_swscaler(other.m_swscaler),
+      m_gray_scaler(other.m_gray_scaler),
+      m_current_frame(other.m_current_frame),
+      m_decoder_frame(other.m_decoder_frame),
+      m_pending(other.m_pending),
+      m_motion_vectors(other.m_motion_vectors),
+      m_cache_file(other.m_cache_file)
+  {
+    m_rgb_array.reference(other.m_rgb_array);
+    m_output_buffer.swap(other.m_output_buffer);
+    other.reset();
+  }
+
   Reader::const_iterator::~const_iterator() {
     reset();
   }
 
   Reader::const_iterator& Reader::const_iterator::operator= (const Reader::const_iterator& other) {
+    if (other.m_parent && other.m_parent->streaming()) {
+      boost::format m("bob::io::video::Reader::const_iterator::operator=(stream=`%s') failed: iterators on forward-only input streams cannot be copied");
+      m % other.m_parent->filename();
+      throw std::runtime_error(m.str());
+    }
     reset();
     m_parent = other.m_parent;
+    m_motion_vectors = other.m_motion_vectors;
     init();
     (*this) += other.m_current_frame;
     return *this;
@@ -194,37 +744,242 @@ namespace bob { namespace io { namespace video {
 
   void Reader::const_iterator::init() {
 
+    //frames may be served from the cache: in this case, ffmpeg is only set up
+    //on the first miss
+    if (!m_parent->streaming() && FrameCache::instance().enabled())
+      m_cache_file = m_parent->m_identity;
+    if (m_cache_file.empty()) open_decoder();
+
+    //at this point we are ready to start reading out frames.
+    m_current_frame = 0;
+
+    //the file maybe valid, but contain zero frames... We check for this here:
+    //(streams are only known to be empty once we reach their end)
+    if (!m_parent->streaming() &&
+        m_current_frame >= m_parent->numberOfFrames()) {
+      //transforms the current iterator in "end"
+      reset();
+    }
+
+  }
+
+  void Reader::const_iterator::open_decoder() {
+
     //ffmpeg initialization
     const std::string& filename = m_parent->filename();
-    m_format_context = make_input_format_context(filename);
+    if (m_parent->streaming()) {
+      //the stream was opened by the reader and can only be consumed once
+      m_format_context = m_parent->m_input_context;
+      m_parent->m_input_context.reset();
+      if (!m_format_context) {
+        boost::format m("bob::io::video::Reader::const_iterator(stream=`%s') failed: forward-only input streams can only be iterated once");
+        m % filename;
+        m_parent = 0;
+        throw std::runtime_error(m.str());
+      }
+    }
+    else {
+      m_format_context = make_input_format_context(filename,
+          m_parent->m_mapping);
+    }
     m_stream_index = find_video_stream(filename, m_format_context);
     m_codec = find_decoder(filename, m_format_context, m_stream_index);
     m_codec_context = make_decoder_context(filename,
-        m_format_context->streams[m_stream_index], m_codec);
+        m_format_context->streams[m_stream_index], m_codec, m_motion_vectors);
     m_swscaler = make_scaler(filename, m_codec_context,
         m_codec_context->pix_fmt, AV_PIX_FMT_RGB24);
+    m_gray_scaler.reset();
     m_context_frame = make_empty_frame(filename);
     m_rgb_array.reference(blitz::Array<uint8_t,3>(m_codec_context->height,
           m_codec_context->width, 3));
+    m_decoder_frame = 0;
+    m_pending = false;
 
-    //at this point we are ready to start reading out frames.
-    m_current_frame = 0;
+  }
 
-    //the file maybe valid, but contain zero frames... We check for this here:
-    if (m_current_frame >= m_parent->numberOfFrames()) {
-      //transforms the current iterator in "end"
-      reset();
+  bool Reader::const_iterator::catch_up(bool throw_on_error) {
+    if (!m_format_context) open_decoder();
+
+    //seeks if we have to go backwards or if we know there is a keyframe
+    //between the decoder position and the current frame: the frame index
+    //is only built for videos with a variable frame rate
+    bool backwards = (m_current_frame < m_decoder_frame);
+    if (backwards || m_current_frame > m_decoder_frame) {
+      bool seeked = false;
+      boost::shared_ptr<const FrameIndex> index = m_parent->built_frame_index();
+      if (!index && backwards && !m_parent->estimated_seeking())
+        index = m_parent->frame_index();
+      if (index) {
+        if (index->usable()) {
+          size_t keyframe = index->keyframe_before(m_current_frame);
+          if (backwards || keyframe > m_decoder_frame) {
+            seeked = seek_decoder(*index, keyframe, throw_on_error);
+            if (!seeked) backwards = true; ///< undefined position: rewind
+          }
+        }
+      }
+      else if (!m_parent->streaming() && m_parent->estimated_seeking()) {
+        if (backwards || keyframe_before(m_current_frame) > m_decoder_frame) {
+          seeked = seek_decoder(throw_on_error);
+          if (!seeked) backwards = true; ///< undefined position: rewind
+        }
+      }
+      if (!seeked && backwards) open_decoder(); //rewinds
     }
 
+    while (m_decoder_frame < m_current_frame) {
+      if (m_pending) m_pending = false; //drops the decoded frame
+      else {
+        bool ok = skip_video_frame(m_parent->m_filepath, m_decoder_frame,
+            m_stream_index, m_format_context, m_codec_context, m_context_frame,
+            throw_on_error);
+        if (!ok) return false;
+      }
+      ++m_decoder_frame;
+    }
+    return true;
+  }
+
+  bool Reader::const_iterator::seek_decoder(const FrameIndex& index,
+      size_t keyframe, bool throw_on_error) {
+
+    int64_t timestamp = index.seek_timestamp(keyframe);
+    if (timestamp == (int64_t)AV_NOPTS_VALUE) return false;
+    if (!seek_video_stream(m_stream_index, m_format_context, m_codec_context,
+          timestamp)) return false;
+    m_pending = false;
+
+    //decodes up to the current frame, identifying frames by their timestamps,
+    //as pictures decoded right after a keyframe may come before it
+    int64_t last = -1;
+    while (true) {
+      bool ok = skip_video_frame(m_parent->m_filepath, keyframe,
+          m_stream_index, m_format_context, m_codec_context, m_context_frame,
+          throw_on_error);
+      if (!ok) return false;
+
+      int64_t frame = index.frame_at(m_context_frame->best_effort_timestamp);
+      if (frame < 0) {
+        if (last < 0) return false; //cannot tell where we landed
+        frame = last + 1;
+      }
+      if (last < 0 && frame > (int64_t)m_current_frame) return false; //too far
+      last = frame;
+
+      if (frame >= (int64_t)m_current_frame) {
+        m_decoder_frame = m_current_frame;
+        m_pending = true;
+        return true;
+      }
+    }
+  }
+
+  bool Reader::const_iterator::seek_decoder(bool throw_on_error) {
+
+    //demuxers that seek by decoding timestamps may land after the current
+    //frame: we then try again, before the picture we landed on
+    int64_t timestamp = m_parent->estimated_pts(m_current_frame);
+    for (size_t attempt=0; attempt<3; ++attempt) {
+      if (!seek_video_stream(m_stream_index, m_format_context,
+            m_codec_context, timestamp)) return false;
+      m_pending = false;
+
+      //decodes up to the current frame, identifying frames by their
+      //timestamps, which must match the frame rate
+      int64_t last = -1;
+      while (true) {
+        bool ok = skip_video_frame(m_parent->m_filepath, m_current_frame,
+            m_stream_index, m_format_context, m_codec_context,
+            m_context_frame, throw_on_error);
+        if (!ok) return false;
+
+        int64_t frame =
+          m_parent->estimated_frame(m_context_frame->best_effort_timestamp);
+        if (frame < 0 || frame <= last) return false;
+        if (last < 0 && frame > (int64_t)m_current_frame) { //too far
+          timestamp -= llround((frame - (int64_t)m_current_frame + 1) *
+              m_parent->m_frame_ticks);
+          break;
+        }
+        if (frame > (int64_t)m_current_frame) return false; //missing frame
+        last = frame;
+
+        if (frame == (int64_t)m_current_frame) {
+          m_decoder_frame = m_current_frame;
+          m_pending = true;
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  int64_t Reader::const_iterator::seek_time(int64_t timestamp,
+      bool throw_on_error) {
+
+    if (!m_format_context) open_decoder();
+
+    //demuxers that seek by decoding timestamps may land after frames
+    //presented at or after the time: we then try again, earlier
+    int64_t target = timestamp;
+    for (size_t attempt=0; attempt<3; ++attempt) {
+      if (avformat_seek_file(m_format_context.get(), m_stream_index,
+            std::numeric_limits<int64_t>::min(), target, target, 0) < 0)
+        return -1;
+      avcodec_flush_buffers(m_codec_context.get());
+      m_pending = false;
+
+      int64_t last = -1;
+      while (true) {
+        bool ok = skip_video_frame(m_parent->m_filepath, m_current_frame,
+            m_stream_index, m_format_context, m_codec_context,
+            m_context_frame, throw_on_error);
+        if (!ok) return (last < 0)? -1 : m_parent->numberOfFrames();
+
+        int64_t pts = m_context_frame->best_effort_timestamp;
+        int64_t frame = m_parent->estimated_frame(pts);
+        if (frame < 0 || frame <= last) return -1;
+        if (pts < timestamp) {
+          last = frame;
+          continue;
+        }
+        if (last < 0 && frame > 0) { //too far
+          target -= (pts - target) + llround(m_parent->m_frame_ticks);
+          break;
+        }
+
+        m_current_frame = m_decoder_frame = frame;
+        m_pending = true;
+        return frame;
+      }
+    }
+
+    return -1;
+  }
+
+  size_t Reader::const_iterator::keyframe_before(size_t frame) {
+    if (!m_format_context) open_decoder();
+    AVStream* stream = m_format_context->streams[m_stream_index];
+    int entry = av_index_search_timestamp(stream,
+        m_parent->estimated_pts(frame), AVSEEK_FLAG_BACKWARD);
+    if (entry < 0) return 0;
+    int64_t keyframe =
+      m_parent->estimated_frame(stream->index_entries[entry].timestamp);
+    return (keyframe > 0 && keyframe <= (int64_t)frame)? keyframe : 0;
   }
 
   void Reader::const_iterator::reset() {
     m_context_frame.reset();
     m_swscaler.reset();
+    m_gray_scaler.reset();
     m_codec_context.reset();
     m_codec = 0;
     m_format_context.reset();
     m_current_frame = std::numeric_limits<size_t>::max(); //that means "end"
+    m_decoder_frame = 0;
+    m_pending = false;
+    m_cache_file.clear();
     m_parent = 0;
   }
 
@@ -236,6 +991,16 @@ namespace bob { namespace io { namespace video {
 
   bool Reader::const_iterator::read(bob::io::base::array::interface& data,
       bool throw_on_error) {
+    return read(data, 0, throw_on_error);
+  }
+
+  bool Reader::const_iterator::read(bob::io::base::array::interface& data,
+      FrameInfo& info, bool throw_on_error) {
+    return read(data, &info, throw_on_error);
+  }
+
+  bool Reader::const_iterator::read(bob::io::base::array::interface& data,
+      FrameInfo* frame_info, bool throw_on_error) {
 
     if (!m_parent) {
       //we are already past the end of the stream
@@ -243,7 +1008,8 @@ namespace bob { namespace io { namespace video {
     }
 
     //checks if we have not passed the end of the video sequence already
-    if(m_current_frame >= m_parent->numberOfFrames()) {
+    if(!m_parent->streaming() &&
+        m_current_frame >= m_parent->numberOfFrames()) {
 
       if (throw_on_error) {
         boost::format m("you are trying to read past the file end (next frame no. to be read would be %d) on file %s, which contains only %d frames");
@@ -265,30 +1031,195 @@ namespace bob { namespace io { namespace video {
       throw std::runtime_error(s.str());
     }
 
-    //we are going to need another copy step - use our internal array
-    bool ok = read_video_frame(m_parent->m_filepath, m_current_frame,
+    //frames are produced in C-order, then copied if the output has other
+    //strides
+    bool contiguous = is_contiguous(info);
+    size_t frame_size = m_parent->m_typeinfo_frame.buffer_size();
+    uint8_t* out = static_cast<uint8_t*>(data.ptr());
+    if (!contiguous) {
+      m_output_buffer.resize(frame_size);
+      out = &m_output_buffer[0];
+    }
+
+    if (!m_cache_file.empty() && !frame_info) {
+      if (FrameCache::instance().lookup(m_cache_file, m_current_frame,
+            m_parent->m_output_format, out, frame_size)) {
+        if (!contiguous) copy_frame(out, data);
+        ++m_current_frame;
+        return true;
+      }
+    }
+
+    bool ok = catch_up(throw_on_error);
+
+    //packed 8-bit frames are scaled straight into the output, others need
+    //another conversion step - use our internal array
+    bool direct = (m_parent->m_layout == PACKED && m_parent->m_output == UINT8);
+    uint8_t* picture = direct? out : m_rgb_array.data();
+    //with native YUV conversion, pictures are decoded first, then converted
+    //by our kernels if in a supported format (m_rgb_array is their scratch)
+    bool native = m_parent->m_native_yuv && m_parent->m_layout == PLANAR;
+    if (ok && (m_pending || native)) {
+      if (!m_pending) ok = skip_video_frame(m_parent->m_filepath,
+          m_current_frame, m_stream_index, m_format_context, m_codec_context,
+          m_context_frame, throw_on_error);
+      m_pending = false;
+      if (ok) native = native &&
+        m_parent->convert(m_context_frame.get(), out, m_rgb_array.data());
+      if (ok && !native) ok = scale_video_frame(m_parent->m_filepath,
+          m_current_frame, m_codec_context, m_swscaler, m_context_frame,
+          picture, throw_on_error);
+    }
+    else if (ok) ok = read_video_frame(m_parent->m_filepath, m_current_frame,
         m_stream_index, m_format_context, m_codec_context, m_swscaler,
-        m_context_frame, m_rgb_array.data(), throw_on_error);
+        m_context_frame, picture, throw_on_error);
 
     if (ok) {
 
-      //now we copy from one container to the other, using our Blitz++ technique
-      blitz::TinyVector<int,3> shape;
-      blitz::TinyVector<int,3> stride;
+      if (!direct && !native) m_parent->convert(m_rgb_array, out);
+      if (!contiguous) copy_frame(out, data);
+
+      if (frame_info) {
+        const AVFrame* frame = m_context_frame.get();
+        frame_info->pts = frame->best_effort_timestamp;
+        frame_info->time = (frame_info->pts != (int64_t)AV_NOPTS_VALUE)?
+          (frame_info->pts - m_parent->m_start_pts) * av_q2d(m_parent->m_time_base) :
+          std::numeric_limits<double>::quiet_NaN();
+        frame_info->keyframe = frame->key_frame;
+        frame_info->pict_type = av_get_picture_type_char(frame->pict_type);
+        frame_info->packet_size = frame->pkt_size;
+      }
 
-      shape = info.shape[0], info.shape[1], info.shape[2];
-      stride = info.stride[0], info.stride[1], info.stride[2];
-      blitz::Array<uint8_t,3> dst(static_cast<uint8_t*>(data.ptr()),
-          shape, stride, blitz::neverDeleteData);
+      if (!m_cache_file.empty()) {
+        FrameCache::instance().insert(m_cache_file, m_current_frame,
+            m_parent->m_output_format, out, frame_size);
+      }
 
-      dst = m_rgb_array.transpose(2,0,1);
       ++m_current_frame;
+      ++m_decoder_frame;
 
     }
 
+    //no more frames available: transforms the current iterator in "end"
+    else reset();
+
     return ok;
   }
 
+  bool Reader::const_iterator::decode(bool throw_on_error) {
+
+    if (!m_parent) {
+      //we are already past the end of the stream
+      throw std::runtime_error("video iterator for file has already reached its end and was reset");
+    }
+
+    //checks if we have not passed the end of the video sequence already
+    if(!m_parent->streaming() &&
+        m_current_frame >= m_parent->numberOfFrames()) {
+
+      if (throw_on_error) {
+        boost::format m("you are trying to read past the file end (next frame no. to be read would be %d) on file %s, which contains only %d frames");
+        m % m_current_frame % m_parent->m_filepath % m_parent->m_nframes;
+        throw std::runtime_error(m.str());
+      }
+
+      reset();
+      return false;
+    }
+
+    bool ok = catch_up(throw_on_error);
+    if (ok && !m_pending) ok = skip_video_frame(m_parent->m_filepath,
+        m_current_frame, m_stream_index, m_format_context, m_codec_context,
+        m_context_frame, throw_on_error);
+    m_pending = false;
+
+    //no more frames available: transforms the current iterator in "end"
+    if (!ok) reset();
+
+    return ok;
+  }
+
+  bool Reader::const_iterator::luma(std::vector<uint8_t>& plane,
+      bool throw_on_error) {
+
+    if (!decode(throw_on_error)) return false;
+
+    const AVFrame* frame = m_context_frame.get();
+    int height = m_codec_context->height;
+    int width = m_codec_context->width;
+    plane.resize((size_t)height * width);
+
+    //YUV and grayscale pictures with 8-bit samples have their luma in the
+    //first plane: it is copied as is
+    const AVPixFmtDescriptor* desc =
+      av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    bool direct = desc && desc->nb_components &&
+      !(desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL |
+            AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL)) &&
+      desc->comp[0].plane == 0 && desc->comp[0].step == 1 &&
+      desc->comp[0].offset == 0 && desc->comp[0].shift == 0 &&
+      desc->comp[0].depth == 8 &&
+      frame->width == width && frame->height == height;
+
+    if (direct) {
+      for (int y=0; y<height; ++y)
+        std::memcpy(&plane[(size_t)y * width],
+            frame->data[0] + (ptrdiff_t)y * frame->linesize[0], width);
+    }
+    else {
+      if (!m_gray_scaler) m_gray_scaler = make_scaler(m_parent->filename(),
+          m_codec_context, m_codec_context->pix_fmt, AV_PIX_FMT_GRAY8);
+      uint8_t* planes[] = {&plane[0], 0};
+      int linesize[] = {width, 0};
+      int conv_height = sws_scale(m_gray_scaler.get(), frame->data,
+          frame->linesize, 0, height, planes, linesize);
+      if (conv_height < 0) {
+        if (throw_on_error) {
+          boost::format m("bob::io::video::sws_scale() failed: could not scale frame %d of file `%s' to grayscale - ffmpeg reports error %d");
+          m % m_current_frame % m_parent->m_filepath % conv_height;
+          reset();
+          throw std::runtime_error(m.str());
+        }
+        reset();
+        return false;
+      }
+    }
+
+    ++m_current_frame;
+    ++m_decoder_frame;
+    return true;
+  }
+
+  bool Reader::const_iterator::motion_vectors(
+      std::vector<MotionVector>& vectors, bool throw_on_error) {
+
+    if (!decode(throw_on_error)) return false;
+
+    const AVFrameSideData* side = av_frame_get_side_data(
+        m_context_frame.get(), AV_FRAME_DATA_MOTION_VECTORS);
+    if (side) {
+      const AVMotionVector* mvs =
+        reinterpret_cast<const AVMotionVector*>(side->data);
+      size_t n = side->size / sizeof(AVMotionVector);
+      for (size_t i=0; i<n; ++i) {
+        MotionVector v;
+        v.frame = m_current_frame;
+        v.source = mvs[i].source;
+        v.w = mvs[i].w;
+        v.h = mvs[i].h;
+        v.src_x = mvs[i].src_x;
+        v.src_y = mvs[i].src_y;
+        v.dst_x = mvs[i].dst_x;
+        v.dst_y = mvs[i].dst_y;
+        vectors.push_back(v);
+      }
+    }
+
+    ++m_current_frame;
+    ++m_decoder_frame;
+    return true;
+  }
+
   /**
    * This method does essentially the same as read(), except it skips a few
    * operations to get a better performance.
@@ -300,17 +1231,30 @@ namespace bob { namespace io { namespace video {
     }
 
     //checks if we have not passed the end of the video sequence already
-    if(m_current_frame >= m_parent->numberOfFrames()) {
+    if(!m_parent->streaming() &&
+        m_current_frame >= m_parent->numberOfFrames()) {
       reset();
       return *this;
     }
 
+    //frames may come from the cache or the decoder may lag behind (after a
+    //seek): only decode when actually reading
+    if (!m_cache_file.empty() || m_pending ||
+        m_decoder_frame != m_current_frame) {
+      ++m_current_frame;
+      return *this;
+    }
+
     //we are going to need another copy step - use our internal array
     try {
       bool ok = skip_video_frame(m_parent->m_filepath, m_current_frame,
           m_stream_index, m_format_context, m_codec_context, m_context_frame,
           true);
-      if (ok) ++m_current_frame;
+      if (ok) {
+        ++m_current_frame;
+        ++m_decoder_frame;
+      }
+      else reset();
     }
     catch (std::runtime_error& e) {
       reset();
@@ -324,6 +1268,30 @@ namespace bob { namespace io { namespace video {
     return *this;
   }
 
+  Reader::const_iterator& Reader::const_iterator::seek(size_t frame) {
+    if (!m_parent) {
+      //we are already past the end of the stream
+      throw std::runtime_error("video iterator for file has already reached its end and was reset");
+    }
+
+    if (m_parent->streaming()) {
+      if (frame < m_current_frame) {
+        boost::format m("bob::io::video::Reader::const_iterator::seek(stream=`%s', frame=%d) failed: forward-only input streams cannot be rewound (current frame is %d)");
+        m % m_parent->filename() % frame % m_current_frame;
+        throw std::runtime_error(m.str());
+      }
+      return (*this) += (frame - m_current_frame);
+    }
+
+    if (frame >= m_parent->numberOfFrames()) {
+      reset();
+      return *this;
+    }
+
+    m_current_frame = frame;
+    return *this;
+  }
+
   bool Reader::const_iterator::operator== (const const_iterator& other) {
     return (this->m_parent == other.m_parent) && (this->m_current_frame == other.m_current_frame);
   }
@@ -332,4 +1300,178 @@ namespace bob { namespace io { namespace video {
     return !(*this == other);
   }
 
+  Reader::const_reverse_iterator Reader::rbegin(size_t buffer_size) const {
+    return Reader::const_reverse_iterator(this, buffer_size);
+  }
+
+  Reader::const_reverse_iterator Reader::rend() const {
+    return Reader::const_reverse_iterator();
+  }
+
+  Reader::const_reverse_iterator::const_reverse_iterator(const Reader* parent,
+      size_t buffer_size) :
+    m_parent(parent),
+    m_current_frame(std::numeric_limits<size_t>::max()),
+    m_capacity(1),
+    m_first(0),
+    m_count(0)
+  {
+    //the index, if built, tells how many frames there really are (read()
+    //also copes with streams ending before the announced number of frames)
+    size_t frames = m_parent->numberOfFrames();
+    boost::shared_ptr<const FrameIndex> index = m_parent->built_frame_index();
+    if (index && index->size() && index->size() < frames)
+      frames = index->size();
+
+    if (!frames) { //transforms the current iterator in "end"
+      reset();
+      return;
+    }
+
+    m_current_frame = frames - 1;
+    size_t frame_size = m_parent->m_typeinfo_frame.buffer_size();
+    if (buffer_size > frame_size) m_capacity = buffer_size / frame_size;
+  }
+
+  Reader::const_reverse_iterator::const_reverse_iterator() :
+    m_parent(0),
+    m_current_frame(std::numeric_limits<size_t>::max()),
+    m_capacity(1),
+    m_first(0),
+    m_count(0)
+  {
+  }
+
+  Reader::const_reverse_iterator::const_reverse_iterator
+    (Reader::const_reverse_iterator&& other) :
+      m_parent(other.m_parent),
+      m_current_frame(other.m_current_frame),
+      m_capacity(other.m_capacity),
+      m_decoder(other.m_decoder),
+      m_first(other.m_first),
+      m_count(other.m_count)
+  {
+    m_buffer.reference(other.m_buffer);
+    other.reset();
+  }
+
+  Reader::const_reverse_iterator::~const_reverse_iterator() {
+    reset();
+  }
+
+  void Reader::const_reverse_iterator::reset() {
+    m_decoder.reset();
+    m_buffer.free();
+    m_first = 0;
+    m_count = 0;
+    m_current_frame = std::numeric_limits<size_t>::max(); //that means "end"
+    m_parent = 0;
+  }
+
+  bool Reader::const_reverse_iterator::fill(size_t frame,
+      bool throw_on_error) {
+
+    if (!m_decoder || !m_decoder->parent())
+      m_decoder.reset(new const_iterator(m_parent));
+    if (!m_decoder->parent()) return false; //empty file
+
+    //decodes from the keyframe before the frame, if we know where it is
+    boost::shared_ptr<const FrameIndex> index = m_parent->built_frame_index();
+    if (!index && !m_parent->estimated_seeking())
+      index = m_parent->frame_index();
+    size_t first = 0;
+    if (index) first = index->usable()? index->keyframe_before(frame) : 0;
+    else first = m_decoder->keyframe_before(frame);
+    if (frame - first + 1 > m_capacity) first = frame + 1 - m_capacity;
+
+    size_t needed = frame - first + 1;
+    size_t frame_size = m_parent->m_typeinfo_frame.buffer_size();
+    if ((size_t)m_buffer.extent(0) < needed ||
+        (size_t)m_buffer.extent(1) != frame_size) {
+      m_buffer.resize(needed, frame_size);
+    }
+
+    m_first = first;
+    m_count = 0;
+    m_decoder->seek(first);
+    while (m_count < needed && m_decoder->parent()) {
+      bob::io::base::array::blitz_array slot(static_cast<void*>(
+            &m_buffer(static_cast<int>(m_count), 0)),
+          m_parent->m_typeinfo_frame);
+      if (!m_decoder->read(slot, throw_on_error)) break;
+      ++m_count;
+    }
+
+    return m_count > 0;
+  }
+
+  bool Reader::const_reverse_iterator::read(blitz::Array<uint8_t,3>& data,
+      bool throw_on_error) {
+    bob::io::base::array::blitz_array tmp(data);
+    return read(tmp, throw_on_error);
+  }
+
+  bool Reader::const_reverse_iterator::read
+    (bob::io::base::array::interface& data, bool throw_on_error) {
+
+    if (!m_parent) {
+      //we are already past the start of the stream
+      throw std::runtime_error("reverse video iterator for file has already reached the first frame and was reset");
+    }
+
+    const bob::io::base::array::typeinfo& info = data.type();
+
+    //checks if the output array shape conforms to the video specifications,
+    //otherwise, throw
+    if (!info.is_compatible(m_parent->m_typeinfo_frame)) {
+      boost::format s("input buffer (%s) does not conform to the video frame size specifications (%s)");
+      s % info.str() % m_parent->m_typeinfo_frame.str();
+      throw std::runtime_error(s.str());
+    }
+
+    //buffered frames are only good while the output type is the same
+    if ((size_t)m_buffer.extent(1) != m_parent->m_typeinfo_frame.buffer_size())
+      m_count = 0;
+
+    if (!m_count || m_current_frame < m_first ||
+        m_current_frame >= m_first + m_count) {
+      if (!fill(m_current_frame, throw_on_error)) {
+        reset();
+        return false;
+      }
+      //the stream may end before the announced number of frames
+      if (m_current_frame >= m_first + m_count)
+        m_current_frame = m_first + m_count - 1;
+    }
+
+    const uint8_t* frame = &m_buffer(static_cast<int>(m_current_frame - m_first), 0);
+    if (is_contiguous(info)) std::memcpy(data.ptr(), frame, m_buffer.extent(1));
+    else copy_frame(frame, data);
+
+    ++(*this);
+    return true;
+  }
+
+  Reader::const_reverse_iterator& Reader::const_reverse_iterator::operator++ () {
+    return (*this) += 1;
+  }
+
+  Reader::const_reverse_iterator& Reader::const_reverse_iterator::operator+= (size_t frames) {
+    if (!m_parent) {
+      //we are already past the start of the stream
+      throw std::runtime_error("reverse video iterator for file has already reached the first frame and was reset");
+    }
+    if (frames > m_current_frame) reset();
+    else m_current_frame -= frames;
+    return *this;
+  }
+
+  bool Reader::const_reverse_iterator::operator== (const const_reverse_iterator& other) {
+    return (this->m_parent == other.m_parent) && (this->m_current_frame == other.m_current_frame);
+  }
+
+  bool Reader::const_reverse_iterator::operator!= (const const_reverse_iterator& other) {
+    return !(*this == other);
+  }
+
 }}}
@@ -2,14 +2,71 @@
 #define BOB_IO_VIDEO_READER_H
 
 #include <string>
+#include <vector>
+#include <limits>
+#include <mutex>
 #include <blitz/array.h>
 #include <stdint.h>
 
 #include <bob.io.base/array.h>
 #include "utils.h"
+#include "frame_cache.h"
+#include "frame_index.h"
+#include "probe.h"
 
 namespace bob { namespace io { namespace video {
 
+  /**
+   * Metadata of a decoded frame, as reported by the decoder
+   */
+  struct FrameInfo {
+    int64_t pts; ///< best effort presentation timestamp, in the stream time base
+    double time; ///< presentation time, in seconds since the stream start (NaN if unknown)
+    bool keyframe; ///< the frame is a keyframe
+    char pict_type; ///< picture type: 'I', 'P', 'B', ... or '?' if unknown
+    int32_t packet_size; ///< size of the packet holding the frame, in bytes (-1 if unknown)
+  };
+
+  /**
+   * Amount of motion between a frame and the previous one, as computed by
+   * Reader::motion()
+   */
+  struct FrameMotion {
+    double difference; ///< mean absolute luma difference to the previous frame, 0 to 255 (NaN for the first frame)
+    bool scene_cut; ///< the frame is likely the first of a new shot
+  };
+
+  /**
+   * A motion vector exported by the decoder, as returned by
+   * Reader::motion_vectors(): the block of w x h pixels centered on (dst_x,
+   * dst_y) in the frame is predicted from the one centered on (src_x, src_y)
+   * in a reference frame
+   */
+  struct MotionVector {
+    int32_t frame; ///< number of the frame the block belongs to
+    int32_t source; ///< the reference frame is in the past (< 0) or in the future (> 0)
+    uint8_t w; ///< block width, in pixels
+    uint8_t h; ///< block height, in pixels
+    int16_t src_x; ///< horizontal position of the block in the reference frame
+    int16_t src_y; ///< vertical position of the block in the reference frame
+    int16_t dst_x; ///< horizontal position of the block in the frame
+    int16_t dst_y; ///< vertical position of the block in the frame
+  };
+
+  /**
+   * Rasterizes the motion vectors of frames first, first+1, ...,
+   * first+frames-1 into a block-level flow field at 'flow', organized as
+   * (frames, 2, ceil(height/block), ceil(width/block)), where the 2 planes
+   * hold the horizontal and vertical displacements, in pixels per frame,
+   * from the past to the future (vectors pointing to future frames are
+   * reversed). Each cell is the average of the vectors covering it,
+   * weighted by the covered area, and zero if no vector covers it (e.g.
+   * intra-coded blocks). Vectors of other frames are ignored.
+   */
+  void rasterize_motion_vectors(const std::vector<MotionVector>& vectors,
+      size_t first, size_t frames, size_t height, size_t width, size_t block,
+      float* flow);
+
   /**
    * Reader objects can read data from video files. The current
    * implementation uses FFMPEG which is a stable freely available
@@ -33,11 +90,28 @@ namespace bob { namespace io { namespace video {
        * combination of format and codec are known to work and have been
        * tested, otherwise an exception is raised. If you set 'check' to
        * 'false', though, we will ignore this check.
+       *
+       * If 'mmap' is set to 'true', the whole file is memory mapped once and
+       * all demuxing done by this reader, its iterators and copies is served
+       * from that (read-only, shared) mapping, instead of opening a new file
+       * handle each time. Use this for local files on fast storage.
+       */
+      Reader(const std::string& filename, bool check=true, bool mmap=false);
+
+      /**
+       * Opens a forward-only input stream (e.g. a pipe) for reading. The
+       * container header is parsed immediately. Streaming readers can only
+       * be traversed once, from the start to the end, with a single iterator
+       * (or load()). Operations that would require rewinding the input, such
+       * as copying the reader or its iterators, raise. The number of frames
+       * is the one announced by the container, if any: iteration always
+       * proceeds until the end of the stream.
        */
-      Reader(const std::string& filename, bool check=true);
+      Reader(boost::shared_ptr<InputStream> stream, bool check=true);
 
       /**
-       * Opens a new Video stream copying information from another VideoStream
+       * Opens a new Video stream copying information from another VideoStream.
+       * Raises if the other reader is a streaming one.
        */
       Reader(const Reader& other);
 
@@ -56,6 +130,16 @@ namespace bob { namespace io { namespace video {
        */
       inline const std::string& filename() const { return m_filepath; }
 
+      /**
+       * Returns if this reader serves input from a memory mapping of the file
+       */
+      inline bool mapped() const { return (bool)m_mapping; }
+
+      /**
+       * Returns if this reader decodes a forward-only input stream
+       */
+      inline bool streaming() const { return (bool)m_input; }
+
       /**
        * Returns the height of the frames in the first video stream.
        */
@@ -76,6 +160,12 @@ namespace bob { namespace io { namespace video {
        */
       double frameRate() const { return m_framerate; }
 
+      /**
+       * Returns the bit rate of the first video stream, in bits per second,
+       * or 0 if the file does not tell it
+       */
+      inline double bitRate() const { return m_bitrate; }
+
       /**
        * Duration of the video stream, in microseconds
        */
@@ -110,6 +200,74 @@ namespace bob { namespace io { namespace video {
        */
       inline const std::string& info() const { return m_formatted_info; }
 
+      /**
+       * Element types frames can be output in
+       */
+      enum OutputType {
+        UINT8, ///< the decoded values, in [0, 255] (default)
+        FLOAT32, ///< single precision floats
+        FLOAT16 ///< half precision floats, as their 16-bit patterns
+      };
+
+      /**
+       * Sets the element type of the frames output by load() and the
+       * iterators. Floating-point frames hold value * scale[band] +
+       * offset[band], computed while converting the decoded pictures, with
+       * no intermediate copy (e.g. a scale of 1/255 maps bands to [0, 1]).
+       * 'scale' and 'offset' point to 3 values (one per band) or are null,
+       * meaning 1 and 0 for all bands. UINT8 outputs cannot be scaled.
+       *
+       * This changes video_type() and frame_type(). As bob.io.base has no
+       * half precision type, those report 'uint16' for FLOAT16 outputs.
+       */
+      void set_output(OutputType type, const float* scale=0,
+          const float* offset=0);
+
+      /**
+       * Returns the element type of the frames output by this reader
+       */
+      inline OutputType output_type() const { return m_output; }
+
+      /**
+       * Sets the layout of the frames output by load() and the iterators:
+       * PLANAR (color-bands, height, width), the default, or PACKED (height,
+       * width, color-bands). Packed 8-bit frames are written by the scaler
+       * straight into contiguous output buffers. This changes video_type()
+       * and frame_type().
+       */
+      void set_layout(Layout layout);
+
+      /**
+       * Returns the layout of the frames output by this reader
+       */
+      inline Layout layout() const { return m_layout; }
+
+      /**
+       * Converts decoded YUV pictures (yuv420p, yuvj420p, yuv422p, yuvj422p
+       * and nv12) with our own SIMD kernels (see yuv_to_planar_rgb24())
+       * instead of the software scaler, when frames are output in the PLANAR
+       * layout. 8-bit frames are then converted straight into the output,
+       * with no transposition. Pictures in other formats still go through
+       * the scaler. Results may differ from the scaler's by a few levels, as
+       * the scaler does its own rounding. This is off by default.
+       */
+      void set_native_yuv(bool native);
+
+      /**
+       * Tells if this reader converts YUV pictures with our own kernels
+       */
+      inline bool native_yuv() const { return m_native_yuv; }
+
+      /**
+       * Returns the per-band scale of floating-point outputs
+       */
+      inline const float* output_scale() const { return m_scale; }
+
+      /**
+       * Returns the per-band offset of floating-point outputs
+       */
+      inline const float* output_offset() const { return m_offset; }
+
       /**
        * Returns the typing information for this video
        */
@@ -152,10 +310,121 @@ namespace bob { namespace io { namespace video {
        * matter what you chose here, it is your task to verify the return value
        * of this method matches the number of frames indicated by
        * numberOfFrames().
+       *
+       * For streaming readers, the buffer may hold any number of frames: we
+       * read until either the buffer is full or the stream ends.
        */
       size_t load(bob::io::base::array::interface& b,
           bool throw_on_error=false, void (*check)(void)=0) const;
 
+      /**
+       * Loads all of the video stream in a buffer, like above, also
+       * appending the metadata of each frame read to 'info'. Frames are
+       * always decoded (and never served from the FrameCache), as the cache
+       * does not keep metadata.
+       */
+      size_t load(bob::io::base::array::interface& b,
+          std::vector<FrameInfo>& info, bool throw_on_error=false,
+          void (*check)(void)=0) const;
+
+      /**
+       * Loads frames start, start+step, ... (up to, but excluding, 'stop')
+       * of the video stream in a buffer organized as (frames, color-bands,
+       * height, width), which must hold exactly that many frames ('stop' is
+       * clipped to numberOfFrames()). The input is sought to the keyframe
+       * before 'start' (and, for large steps, before each frame read), as
+       * const_iterator::seek() does, so only the frames in the range, plus
+       * the ones since their keyframe, are decoded. The whole file is not
+       * scanned first, unless the video has a variable frame rate.
+       *
+       * The flag 'throw_on_error' has the same meaning as for load() above.
+       * Returns the number of frames read.
+       *
+       * Streaming readers are decoded forward, skipping frames before
+       * 'start', and 'stop' is not clipped.
+       */
+      size_t load(bob::io::base::array::interface& b, size_t start,
+          size_t stop, size_t step=1, bool throw_on_error=false,
+          void (*check)(void)=0) const;
+
+      /**
+       * Loads a range of frames in a buffer, like above, also appending the
+       * metadata of each frame read to 'info'.
+       */
+      size_t load(bob::io::base::array::interface& b,
+          std::vector<FrameInfo>& info, size_t start, size_t stop,
+          size_t step=1, bool throw_on_error=false,
+          void (*check)(void)=0) const;
+
+      /**
+       * Returns the index of frames and keyframes of this file, which is
+       * built (by demuxing the whole file once) on the first call and shared
+       * by all iterators and copies of this reader. Iterators seek with it
+       * once it is built. Before that, they only build it themselves for
+       * videos with a variable frame rate: otherwise, frames are located
+       * from their timestamps, estimated from the frame rate. Raises for
+       * streaming readers.
+       */
+      boost::shared_ptr<const FrameIndex> frame_index() const;
+
+      /**
+       * Tells if the frame_index() was already built, by an explicit call or
+       * while seeking
+       */
+      inline bool has_frame_index() const { return !!built_frame_index(); }
+
+      /**
+       * Returns the number of the first frame presented at or after the given
+       * time, in seconds since the stream start (normally, the presentation
+       * time of the first frame), or numberOfFrames() if there
+       * is no such frame. The input is sought to the keyframe before that
+       * time and decoded up to the first picture presented at or after it,
+       * whose number is told by its timestamp. Videos with a variable frame
+       * rate use the frame_index() instead, so this is exact for them too.
+       * If the timestamps in the file cannot be used, the frame number is
+       * estimated from the average frame rate. Times are rounded to the
+       * microsecond. Raises for streaming readers.
+       */
+      size_t frame_at_time(double seconds) const;
+
+      /**
+       * Appends the FrameMotion of frames start, start+1, ... (up to, but
+       * excluding, 'stop', which is clipped to numberOfFrames()) to
+       * 'motion'. Frames are decoded, but not converted to RGB: their luma
+       * plane is compared to the one of the previous frame (so decoding
+       * starts at frame start-1, seeking like load() does), which makes this
+       * a cheap way to find the frames worth reading. A frame is flagged as a
+       * scene cut if its difference is at least 'threshold' and not less
+       * than twice the difference of the frame before (so steady, fast
+       * motion is not mistaken for cuts). The difference of the first frame
+       * of the video is NaN and it is always flagged as a scene cut.
+       *
+       * The flag 'throw_on_error' has the same meaning as for load().
+       * Returns the number of frames processed. Streaming readers are
+       * decoded forward, skipping frames before start-1, and 'stop' is not
+       * clipped.
+       */
+      size_t motion(std::vector<FrameMotion>& motion, size_t start=0,
+          size_t stop=std::numeric_limits<size_t>::max(),
+          double threshold=30., bool throw_on_error=false) const;
+
+      /**
+       * Appends the motion vectors of frames start, start+1, ... (up to, but
+       * excluding, 'stop', which is clipped to numberOfFrames()) to
+       * 'vectors', as exported by the decoder (e.g. H.264 and MPEG-4 ones:
+       * decoders of intra-only codecs export none). This is a cheap proxy
+       * for the optical flow: frames are decoded (with
+       * AV_CODEC_FLAG2_EXPORT_MVS), but not converted to RGB. The input is
+       * sought to the keyframe before 'start' like load() does.
+       *
+       * The flag 'throw_on_error' has the same meaning as for load().
+       * Returns the number of frames decoded. Streaming readers are decoded
+       * forward, skipping frames before 'start', and 'stop' is not clipped.
+       */
+      size_t motion_vectors(std::vector<MotionVector>& vectors,
+          size_t start=0, size_t stop=std::numeric_limits<size_t>::max(),
+          bool throw_on_error=false) const;
+
     private: //methods
 
       /**
@@ -163,6 +432,47 @@ namespace bob { namespace io { namespace video {
        */
       void open(const std::string& filename, bool check);
 
+      /**
+       * Sets up the typing information from the video size and the output
+       * settings
+       */
+      void update_types();
+
+      /**
+       * Validates and stores the output settings, without touching the
+       * typing information
+       */
+      void store_output(OutputType type, const float* scale,
+          const float* offset);
+
+      /**
+       * Converts a decoded RGB24 picture (height, width, 3) into a frame of
+       * the output type and layout, in C-order, at 'dst'
+       */
+      void convert(const blitz::Array<uint8_t,3>& rgb, void* dst) const;
+
+      /**
+       * Converts a decoded YUV picture into a planar frame of the output
+       * type, in C-order, at 'dst', using 'buffer' (3 * height * width
+       * bytes) for floating-point outputs. Returns false, without touching
+       * the output, if the picture is not in a format our kernels support.
+       */
+      bool convert(const AVFrame* frame, void* dst, uint8_t* buffer) const;
+
+      /**
+       * Loads the video, filling in frame metadata if 'info' is set
+       */
+      size_t load(bob::io::base::array::interface& b,
+          std::vector<FrameInfo>* info, bool throw_on_error,
+          void (*check)(void)) const;
+
+      /**
+       * Loads a range of frames, filling in frame metadata if 'info' is set
+       */
+      size_t load(bob::io::base::array::interface& b,
+          std::vector<FrameInfo>* info, size_t start, size_t stop,
+          size_t step, bool throw_on_error, void (*check)(void)) const;
+
     public: //iterators
 
       /**
@@ -180,6 +490,13 @@ namespace bob { namespace io { namespace video {
            */
           const_iterator(const const_iterator& other);
 
+          /**
+           * Move constructor. Takes over the ffmpeg infrastructure of the
+           * other iterator, which is left pointing to "end". This is cheap
+           * and also works for streaming readers.
+           */
+          const_iterator(const_iterator&& other);
+
           /**
            * Destructor virtualization
            */
@@ -218,6 +535,19 @@ namespace bob { namespace io { namespace video {
            */
           const_iterator& operator+= (size_t frames);
 
+          /**
+           * Moves the iterator to the given frame, forwards or backwards,
+           * return self. Decoding is deferred to the next read(): the input
+           * is then sought to the last keyframe before that frame instead of
+           * decoding all frames in between, and decoded pictures are
+           * identified by their timestamps (see Reader::frame_index()).
+           * Moving forward within the current group of pictures decodes
+           * forward, without seeking. If the file cannot be sought, we
+           * rewind and decode forward. Moving past the last frame points to
+           * "end". Streaming readers can only move forward.
+           */
+          const_iterator& seek(size_t frame);
+
           /**
            * Compares two iterators for equality
            */
@@ -242,6 +572,11 @@ namespace bob { namespace io { namespace video {
            * position, an exception is raised if you try to read() the
            * iterator.
            *
+           * If the process-wide FrameCache is enabled, frames are looked up
+           * there before decoding and decoded frames are stored in it. In
+           * this case, the ffmpeg infrastructure is only set up (and the
+           * iterator only decodes up to its position) on the first miss.
+           *
            * The flag 'throw_on_error' controls the error reporting behavior
            * when reading. By default it is 'false', which means we **won't**
            * report problems reading this stream. We just silently truncate the
@@ -252,6 +587,15 @@ namespace bob { namespace io { namespace video {
            */
           bool read (bob::io::base::array::interface& b, bool throw_on_error=false);
 
+          /**
+           * Reads the currently pointed frame and advances one position, like
+           * above, also filling in the metadata of the frame. The frame is
+           * always decoded (and never served from the FrameCache), as the
+           * cache does not keep metadata.
+           */
+          bool read (bob::io::base::array::interface& b, FrameInfo& info,
+              bool throw_on_error=false);
+
           /**
            * Reads the currently pointed frame and advances one position.
            * Please note that when you call this method in a loop, you don't
@@ -297,9 +641,10 @@ namespace bob { namespace io { namespace video {
 
           /**
            * The only way to build a new iterator is to use the parent's
-           * begin()/end() methods.
+           * begin()/end() methods. Iterators of motion_vectors() have their
+           * decoder export motion vectors.
            */
-          const_iterator(const Reader* parent);
+          const_iterator(const Reader* parent, bool motion_vectors=false);
 
           /**
            * This creates an iterator pointing to "end"
@@ -313,6 +658,84 @@ namespace bob { namespace io { namespace video {
            */
           void init();
 
+          /**
+           * Reads the current frame, filling in its metadata if 'frame_info'
+           * is set
+           */
+          bool read (bob::io::base::array::interface& b, FrameInfo* frame_info,
+              bool throw_on_error);
+
+          /**
+           * Sets up the ffmpeg infrastructure to decode from the first frame
+           */
+          void open_decoder();
+
+          /**
+           * Makes sure the decoder is set up and has consumed all frames
+           * before the current one. Returns 'false' if the stream ends before.
+           */
+          bool catch_up(bool throw_on_error);
+
+          /**
+           * Seeks the input to the given keyframe and decodes up to the
+           * current frame, which is left pending in the context frame.
+           * Returns 'false' if that is not possible, in which case the
+           * decoder must be re-opened.
+           */
+          bool seek_decoder(const FrameIndex& index, size_t keyframe,
+              bool throw_on_error);
+
+          /**
+           * Seeks the input to the last keyframe before the current frame,
+           * located from the timestamp of the frame estimated by the reader,
+           * and decodes up to the current frame, as above. Returns 'false'
+           * if that is not possible (e.g. timestamps do not match the frame
+           * rate), in which case the decoder must be re-opened.
+           */
+          bool seek_decoder(bool throw_on_error);
+
+          /**
+           * Seeks the input to the last keyframe before the given timestamp
+           * and decodes up to the first frame presented at or after it,
+           * which becomes the current frame, pending in the context frame.
+           * Returns its number, from its timestamp as estimated by the
+           * reader, or the number of frames if the stream ends before. If
+           * frames cannot be identified (e.g. their timestamps do not match
+           * the frame rate), returns -1 and the decoder must be re-opened.
+           */
+          int64_t seek_time(int64_t timestamp, bool throw_on_error);
+
+          /**
+           * Returns the number of the last keyframe at or before the given
+           * frame the demuxer knows of (from the index of the container,
+           * without reading the file), or 0 if it knows of none. Only valid
+           * if the reader estimated_seeking().
+           */
+          size_t keyframe_before(size_t frame);
+
+          /**
+           * Decodes the current frame into the context frame, without
+           * moving to the next one. Returns 'false' (and transforms this
+           * iterator in "end") at the end of the stream, like read().
+           */
+          bool decode(bool throw_on_error);
+
+          /**
+           * Decodes the current frame and copies its luma plane (height *
+           * width bytes) into 'plane', converting the picture to grayscale
+           * if it has no 8-bit luma plane, then moves to the next frame.
+           * Returns 'false' at the end of the stream, like read().
+           */
+          bool luma(std::vector<uint8_t>& plane, bool throw_on_error);
+
+          /**
+           * Decodes the current frame and appends its motion vectors to
+           * 'vectors', then moves to the next frame. Returns 'false' at the
+           * end of the stream, like read().
+           */
+          bool motion_vectors(std::vector<MotionVector>& vectors,
+              bool throw_on_error);
+
         private: //representation
           const Reader* m_parent; ///< who generated me
           boost::shared_ptr<AVFormatContext> m_format_context; ///< format context
@@ -323,7 +746,130 @@ namespace bob { namespace io { namespace video {
           boost::shared_ptr<AVFrame> m_context_frame; ///< from file
           blitz::Array<uint8_t,3> m_rgb_array; ///< temporary
           boost::shared_ptr<SwsContext> m_swscaler; ///< software scaler
+          boost::shared_ptr<SwsContext> m_gray_scaler; ///< for luma(), on demand
           size_t m_current_frame; ///< the current frame to be read
+          size_t m_decoder_frame; ///< the next frame the decoder will output
+          bool m_pending; ///< m_decoder_frame is decoded in m_context_frame
+          bool m_motion_vectors; ///< the decoder exports motion vectors
+          std::string m_cache_file; ///< file identity, if using the cache
+          std::vector<uint8_t> m_output_buffer; ///< for strided outputs
+
+        public: //friendship
+
+          friend class Reader; //required for construction
+          friend class const_reverse_iterator; //decodes with us
+      };
+
+      /**
+       * Iterators that traverse the video from its last frame to the first
+       * one. Frames are decoded one group of pictures (GOP) at a time: the
+       * input is sought to the keyframe before the current frame, the frames
+       * from there on are decoded once into a buffer and emitted back to
+       * front. Then, we move to the previous GOP. With a seekable file, a
+       * reverse traversal costs about as much as a forward one. If a GOP does
+       * not fit the buffer, only its last frames are kept and the GOP is
+       * decoded again for the earlier ones.
+       */
+      class const_reverse_iterator {
+
+        public: //public API for reverse video iterators
+
+          /**
+           * Move constructor. The other iterator is left pointing to "end".
+           */
+          const_reverse_iterator(const_reverse_iterator&& other);
+
+          /**
+           * Destructor virtualization
+           */
+          virtual ~const_reverse_iterator();
+
+          /**
+           * Moves one frame towards the start of the video, return self. This
+           * does not decode anything.
+           */
+          const_reverse_iterator& operator++ ();
+
+          /**
+           * Moves N frames towards the start of the video, return self. This
+           * does not decode anything. Going beyond the first frame points to
+           * "end".
+           */
+          const_reverse_iterator& operator+= (size_t frames);
+
+          /**
+           * Compares two iterators for equality
+           */
+          bool operator== (const const_reverse_iterator& other);
+
+          /**
+           * Compares two iterators for inequality
+           */
+          bool operator!= (const const_reverse_iterator& other);
+
+          /**
+           * Reads the currently pointed frame and moves one frame towards the
+           * start of the video. The 'data' format is (color-bands, height,
+           * width). The flag 'throw_on_error' has the same meaning as for
+           * const_iterator::read().
+           */
+          bool read (bob::io::base::array::interface& b, bool throw_on_error=false);
+
+          /**
+           * Reads the currently pointed frame and moves one frame towards the
+           * start of the video. The 'data' format is (color-bands, height,
+           * width).
+           */
+          bool read (blitz::Array<uint8_t,3>& data, bool throw_on_error=false);
+
+          /**
+           * Makes this iterator point to "end", freeing all resources
+           */
+          void reset();
+
+          /**
+           * Tells the current frame number
+           */
+          inline size_t cur() const { return m_current_frame; }
+
+          /**
+           * Gets the parent
+           */
+          const Reader* parent() const { return m_parent; }
+
+        private: //cannot create or copy iterators
+
+          /**
+           * The only way to build a new iterator is to use the parent's
+           * rbegin()/rend() methods.
+           */
+          const_reverse_iterator(const Reader* parent, size_t buffer_size);
+
+          /**
+           * This creates an iterator pointing to "end"
+           */
+          const_reverse_iterator();
+
+          const_reverse_iterator(const const_reverse_iterator& other);
+
+          const_reverse_iterator& operator= (const const_reverse_iterator& other);
+
+        private: //methods
+
+          /**
+           * Decodes the GOP holding the given frame (or its last frames, if
+           * it does not fit the buffer) into the buffer
+           */
+          bool fill(size_t frame, bool throw_on_error);
+
+        private: //representation
+          const Reader* m_parent; ///< who generated me
+          size_t m_current_frame; ///< the current frame to be read
+          size_t m_capacity; ///< maximum number of frames to buffer
+          boost::shared_ptr<const_iterator> m_decoder; ///< forward decoder
+          blitz::Array<uint8_t,2> m_buffer; ///< (frames, bytes per frame)
+          size_t m_first; ///< number of the first frame in the buffer
+          size_t m_count; ///< number of valid frames in the buffer
 
         public: //friendship
 
@@ -341,14 +887,62 @@ namespace bob { namespace io { namespace video {
        */
       const_iterator end() const;
 
+      /**
+       * Returns a reverse iterator pointing to the last frame of the video,
+       * using at most 'buffer_size' bytes (but at least one frame) to hold
+       * decoded frames. Raises for streaming readers.
+       */
+      const_reverse_iterator rbegin(size_t buffer_size=(128 << 20)) const;
+
+      /**
+       * Returns a reverse iterator pointing past the first frame of the video
+       */
+      const_reverse_iterator rend() const;
+
     private: //our representation
 
+      /**
+       * Returns the frame_index() if some call already built it, or an empty
+       * pointer otherwise. Never demuxes the file.
+       */
+      boost::shared_ptr<const FrameIndex> built_frame_index() const;
+
+      /**
+       * Tells if frames can be located without the frame_index(), from
+       * timestamps estimated from the frame rate: this is only the case for
+       * videos with a constant frame rate
+       */
+      inline bool estimated_seeking() const { return m_frame_ticks > 0.; }
+
+      /**
+       * Returns the timestamp of the given frame, estimated from the frame
+       * rate. Only valid if estimated_seeking().
+       */
+      int64_t estimated_pts(size_t frame) const;
+
+      /**
+       * Returns the number of the frame with the given timestamp, estimated
+       * from the frame rate, or -1 if the timestamp is not the one of a
+       * frame (within a quarter of a frame) or estimated_seeking() is false
+       */
+      int64_t estimated_frame(int64_t pts) const;
+
       std::string m_filepath; ///< the name of the file we are manipulating
       bool m_check; ///< shall I check for compatibility when opening?
+      boost::shared_ptr<const MappedFile> m_mapping; ///< shared input mapping
+      boost::shared_ptr<InputStream> m_input; ///< forward-only input, if any
+      std::string m_identity; ///< identity of the file, for the frame cache
+      mutable std::mutex m_index_mutex; ///< protects m_index
+      mutable boost::shared_ptr<const FrameIndex> m_index; ///< built on demand
+      mutable boost::shared_ptr<AVFormatContext> m_input_context; ///< opened stream, handed over to the first iterator
       size_t m_height; ///< the height of the video frames (number of rows)
       size_t m_width; ///< the width of the video frames (number of columns)
       size_t m_nframes; ///< the number of frames in this video file
       double m_framerate; ///< rate of frames in the video stream
+      double m_bitrate; ///< bits per second in the video stream, if known
+      AVRational m_time_base; ///< time base of the video stream timestamps
+      int64_t m_start_pts; ///< timestamp of the stream start
+      double m_frame_ticks; ///< duration of a frame in m_time_base units, 0 if variable
       uint64_t m_duration; ///< in microsseconds, for the whole video
       std::string m_formatname; ///< the name of the ffmpeg format to be used
       std::string m_formatname_long; ///< long version of m_formatname
@@ -357,6 +951,12 @@ namespace bob { namespace io { namespace video {
       std::string m_formatted_info; ///< printable information about the video
       bob::io::base::array::typeinfo m_typeinfo_video; ///< read whole video type
       bob::io::base::array::typeinfo m_typeinfo_frame; ///< read single frame type
+      Layout m_layout; ///< layout of output frames
+      bool m_native_yuv; ///< converts YUV pictures with our own kernels
+      OutputType m_output; ///< element type of output frames
+      float m_scale[3]; ///< per-band scale of floating-point outputs
+      float m_offset[3]; ///< per-band offset of floating-point outputs
+      std::string m_output_format; ///< describes output frames, for the frame cache
   };
 
 }}}
@@ -0,0 +1,326 @@
+#include "scanner.h"
+
+#include <set>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/format.hpp>
+#include <boost/filesystem.hpp>
+
+#include <sys/stat.h>
+
+namespace fs = boost::filesystem;
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * First line of cache files. Bump the version when the format changes.
+   */
+  static const char* CACHE_MAGIC = "bob.io.video scan cache 1";
+
+  static const size_t CACHE_FIELDS = 14;
+
+  static std::string lowercase(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s;
+  }
+
+  /**
+   * Escapes tabs, new lines and backslashes so strings can be stored in a
+   * tab separated line
+   */
+  static std::string escape(const std::string& s) {
+    std::string retval;
+    retval.reserve(s.size());
+    for (size_t i=0; i<s.size(); ++i) {
+      switch (s[i]) {
+        case '\\': retval += "\\\\"; break;
+        case '\t': retval += "\\t"; break;
+        case '\n': retval += "\\n"; break;
+        case '\r': retval += "\\r"; break;
+        default: retval += s[i];
+      }
+    }
+    return retval;
+  }
+
+  static bool unescape(const std::string& s, std::string& retval) {
+    retval.clear();
+    for (size_t i=0; i<s.size(); ++i) {
+      if (s[i] != '\\') { retval += s[i]; continue; }
+      if (++i == s.size()) return false;
+      switch (s[i]) {
+        case '\\': retval += '\\'; break;
+        case 't': retval += '\t'; break;
+        case 'n': retval += '\n'; break;
+        case 'r': retval += '\r'; break;
+        default: return false;
+      }
+    }
+    return true;
+  }
+
+  static bool parse(const std::string& s, uint64_t& value) {
+    if (s.empty()) return false;
+    char* end = 0;
+    errno = 0;
+    value = std::strtoull(s.c_str(), &end, 10);
+    return !errno && *end == '\0';
+  }
+
+  static bool parse(const std::string& s, int64_t& value) {
+    if (s.empty()) return false;
+    char* end = 0;
+    errno = 0;
+    value = std::strtoll(s.c_str(), &end, 10);
+    return !errno && *end == '\0';
+  }
+
+  static bool parse(const std::string& s, double& value) {
+    if (s.empty()) return false;
+    char* end = 0;
+    value = std::strtod(s.c_str(), &end);
+    return *end == '\0';
+  }
+
+  static std::string serialize(const ScanEntry& e) {
+    std::ostringstream line;
+    line.precision(std::numeric_limits<double>::digits10 + 2);
+    line << escape(e.path) << '\t' << e.size << '\t' << e.mtime << '\t'
+      << (e.ok? 1 : 0) << '\t' << escape(e.error) << '\t'
+      << escape(e.info.format_name) << '\t'
+      << escape(e.info.format_long_name) << '\t'
+      << escape(e.info.codec_name) << '\t'
+      << escape(e.info.codec_long_name) << '\t'
+      << e.info.height << '\t' << e.info.width << '\t'
+      << e.info.number_of_frames << '\t' << e.info.frame_rate << '\t'
+      << e.info.duration;
+    return line.str();
+  }
+
+  static bool deserialize(const std::string& line, ScanEntry& e) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (size_t tab = line.find('\t'); tab != std::string::npos;
+        start = tab + 1, tab = line.find('\t', start))
+      fields.push_back(line.substr(start, tab - start));
+    fields.push_back(line.substr(start));
+    if (fields.size() != CACHE_FIELDS) return false;
+
+    uint64_t ok, height, width, nframes;
+    bool good = unescape(fields[0], e.path) &&
+      parse(fields[1], e.size) &&
+      parse(fields[2], e.mtime) &&
+      parse(fields[3], ok) &&
+      unescape(fields[4], e.error) &&
+      unescape(fields[5], e.info.format_name) &&
+      unescape(fields[6], e.info.format_long_name) &&
+      unescape(fields[7], e.info.codec_name) &&
+      unescape(fields[8], e.info.codec_long_name) &&
+      parse(fields[9], height) &&
+      parse(fields[10], width) &&
+      parse(fields[11], nframes) &&
+      parse(fields[12], e.info.frame_rate) &&
+      parse(fields[13], e.info.duration);
+    if (!good) return false;
+
+    e.ok = (ok != 0);
+    e.cached = true;
+    e.info.filename = e.path;
+    e.info.height = height;
+    e.info.width = width;
+    e.info.number_of_frames = nframes;
+    return true;
+  }
+
+  /**
+   * Fills in the size and modification time of a file. Returns 'false' and
+   * sets the entry error if the file cannot be stat'ed.
+   */
+  static bool stat_entry(ScanEntry& e) {
+    struct stat st;
+    if (::stat(e.path.c_str(), &st) != 0) {
+      e.error = std::strerror(errno);
+      return false;
+    }
+    e.size = st.st_size;
+    e.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+  }
+
+  /**
+   * Adds the regular files found by walking a directory with the given
+   * iterator type to 'files', if their extension is in 'exts' (or 'exts' is
+   * empty)
+   */
+  template <typename Iterator>
+  static void collect(const fs::path& root, const std::set<std::string>& exts,
+      std::set<std::string>& files) {
+    for (Iterator it(root), end; it != end; ++it) {
+      if (!fs::is_regular_file(it->status())) continue;
+      if (!exts.empty() &&
+          !exts.count(lowercase(it->path().extension().string()))) continue;
+      files.insert(it->path().generic_string());
+    }
+  }
+
+  Scanner::Scanner(size_t threads, int64_t probesize,
+      int64_t analyzeduration) :
+    m_threads(threads),
+    m_probesize(probesize),
+    m_analyzeduration(analyzeduration)
+  {
+    if (!m_threads) m_threads = std::thread::hardware_concurrency();
+    if (!m_threads) m_threads = 1;
+  }
+
+  Scanner::~Scanner() {
+  }
+
+  std::vector<ScanEntry> Scanner::scan(const std::vector<std::string>& paths,
+      const std::vector<std::string>& extensions, bool recursive) {
+
+    std::set<std::string> exts;
+    for (size_t k=0; k<extensions.size(); ++k)
+      exts.insert(lowercase(extensions[k]));
+
+    // collects the files to scan
+    std::set<std::string> files;
+    for (size_t k=0; k<paths.size(); ++k) {
+      fs::path root = fs::absolute(paths[k]);
+      if (!fs::exists(root)) {
+        boost::format m("bob::io::video::Scanner::scan(`%s') failed: no such file or directory");
+        m % paths[k];
+        throw std::runtime_error(m.str());
+      }
+      if (!fs::is_directory(root)) {
+        files.insert(root.generic_string());
+        continue;
+      }
+      if (recursive) collect<fs::recursive_directory_iterator>(root, exts, files);
+      else collect<fs::directory_iterator>(root, exts, files);
+    }
+
+    // checks which ones need probing
+    std::vector<ScanEntry> retval(files.size());
+    std::vector<size_t> todo;
+    size_t k = 0;
+    for (std::set<std::string>::const_iterator it = files.begin();
+        it != files.end(); ++it, ++k) {
+      ScanEntry& e = retval[k];
+      e.path = *it;
+      e.size = 0;
+      e.mtime = 0;
+      e.cached = false;
+      e.ok = false;
+      if (!stat_entry(e)) continue;
+      std::map<std::string, ScanEntry>::const_iterator c = m_cache.find(e.path);
+      if (c != m_cache.end() && c->second.size == e.size &&
+          c->second.mtime == e.mtime) {
+        e = c->second;
+        e.cached = true;
+      }
+      else todo.push_back(k);
+    }
+
+    // probes them in parallel
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+      for (size_t i = next++; i < todo.size(); i = next++) {
+        ScanEntry& e = retval[todo[i]];
+        try {
+          e.info = probe(e.path, m_probesize, m_analyzeduration);
+          e.ok = true;
+        }
+        catch (std::exception& ex) {
+          e.error = ex.what();
+        }
+        catch (...) {
+          e.error = "unknown exception";
+        }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    size_t nthreads = std::min(m_threads, todo.size());
+    for (size_t t=1; t<nthreads; ++t) pool.push_back(std::thread(worker));
+    worker(); //this thread works too
+    for (size_t t=0; t<pool.size(); ++t) pool[t].join();
+
+    for (size_t i=0; i<todo.size(); ++i) {
+      ScanEntry& e = retval[todo[i]];
+      m_cache[e.path] = e;
+    }
+
+    return retval;
+  }
+
+  void Scanner::load_cache(const std::string& filename) {
+    struct stat st;
+    if (::stat(filename.c_str(), &st) != 0 && errno == ENOENT) return;
+
+    std::ifstream in(filename.c_str());
+    if (!in) {
+      boost::format m("bob::io::video::Scanner::load_cache(`%s') failed: cannot open file for reading");
+      m % filename;
+      throw std::runtime_error(m.str());
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != CACHE_MAGIC) {
+      boost::format m("bob::io::video::Scanner::load_cache(`%s') failed: not a scan cache file (or written by an incompatible version)");
+      m % filename;
+      throw std::runtime_error(m.str());
+    }
+
+    std::map<std::string, ScanEntry> cache;
+    for (size_t lineno = 2; std::getline(in, line); ++lineno) {
+      ScanEntry e;
+      if (!deserialize(line, e)) {
+        boost::format m("bob::io::video::Scanner::load_cache(`%s') failed: malformed entry at line %d");
+        m % filename % lineno;
+        throw std::runtime_error(m.str());
+      }
+      cache[e.path] = e;
+    }
+
+    for (std::map<std::string, ScanEntry>::const_iterator it = cache.begin();
+        it != cache.end(); ++it) m_cache[it->first] = it->second;
+  }
+
+  void Scanner::save_cache(const std::string& filename) const {
+    std::string tmpname = filename + ".tmp";
+
+    {
+      std::ofstream out(tmpname.c_str(), std::ios::out | std::ios::trunc);
+      out << CACHE_MAGIC << '\n';
+      for (std::map<std::string, ScanEntry>::const_iterator it = m_cache.begin();
+          it != m_cache.end(); ++it) out << serialize(it->second) << '\n';
+      out.close();
+      if (!out) {
+        std::remove(tmpname.c_str());
+        boost::format m("bob::io::video::Scanner::save_cache(`%s') failed: cannot write to `%s'");
+        m % filename % tmpname;
+        throw std::runtime_error(m.str());
+      }
+    }
+
+    if (std::rename(tmpname.c_str(), filename.c_str()) != 0) {
+      int error = errno;
+      std::remove(tmpname.c_str());
+      boost::format m("bob::io::video::Scanner::save_cache(`%s') failed: %s");
+      m % filename % std::strerror(error);
+      throw std::runtime_error(m.str());
+    }
+  }
+
+}}}
@@ -0,0 +1,98 @@
+#ifndef BOB_IO_VIDEO_SCANNER_H
+#define BOB_IO_VIDEO_SCANNER_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+#include "probe.h"
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * The result of scanning a single file
+   */
+  struct ScanEntry {
+    std::string path; ///< absolute path to the file
+    uint64_t size; ///< size of the file, in bytes
+    int64_t mtime; ///< modification time, in nanoseconds since the epoch
+    bool ok; ///< the file could be probed
+    bool cached; ///< the entry comes from the cache (file was not probed)
+    std::string error; ///< why probing failed, if !ok
+    Probe info; ///< the video metadata, if ok
+  };
+
+  /**
+   * Walks directories looking for video files and probes (see probe()) all
+   * of them using a pool of threads. Results are kept in a cache keyed by
+   * the path, size and modification time of each file, so scanning the same
+   * directories again only probes files that were added or changed. The
+   * cache can be saved to and loaded from a file.
+   *
+   * A scanner is not thread-safe: use one per thread.
+   */
+  class Scanner {
+
+    public:
+
+      /**
+       * Creates a new scanner using the given number of threads (0 means
+       * one per available core). 'probesize' and 'analyzeduration' are
+       * passed on to probe().
+       */
+      Scanner(size_t threads=0, int64_t probesize=0,
+          int64_t analyzeduration=0);
+
+      /**
+       * Destructor virtualization
+       */
+      virtual ~Scanner();
+
+      /**
+       * Scans the given paths. Directories are searched for files with one
+       * of the given extensions (case insensitive, including the leading
+       * dot - all regular files if empty), descending into sub-directories
+       * if 'recursive' is set. Files given explicitly are always scanned.
+       * Entries are returned sorted by path.
+       *
+       * Raises if one of the paths does not exist.
+       */
+      std::vector<ScanEntry> scan(const std::vector<std::string>& paths,
+          const std::vector<std::string>& extensions=std::vector<std::string>(),
+          bool recursive=true);
+
+      /**
+       * Loads cached results from a file written by save_cache(). A missing
+       * file is not an error (the cache is simply left untouched), but an
+       * unreadable or malformed one is.
+       */
+      void load_cache(const std::string& filename);
+
+      /**
+       * Saves the cached results to a file, replacing it atomically
+       */
+      void save_cache(const std::string& filename) const;
+
+      /**
+       * Number of entries in the cache
+       */
+      inline size_t cache_size() const { return m_cache.size(); }
+
+      /**
+       * Drops all cached results
+       */
+      inline void clear_cache() { m_cache.clear(); }
+
+    private: //representation
+
+      size_t m_threads; ///< number of threads used for probing
+      int64_t m_probesize; ///< see probe()
+      int64_t m_analyzeduration; ///< see probe()
+      std::map<std::string, ScanEntry> m_cache; ///< results, by path
+
+  };
+
+}}}
+
+#endif /* BOB_IO_VIDEO_SCANNER_H */
@@ -0,0 +1,245 @@
+#include "trim.h"
+#include "frame_index.h"
+#include "utils.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <boost/format.hpp>
+
+namespace bob { namespace io { namespace video {
+
+  static void no_deallocation(AVStream*) {
+    //streams are freed with their format context
+  }
+
+  /**
+   * Opens an encoder for the codec of the 'source' stream, with the same
+   * parameters, writing to 'stream'. Returns an empty pointer if there is no
+   * such encoder or if its packets cannot precede the source ones.
+   */
+  static boost::shared_ptr<AVCodecContext> make_smart_encoder(
+      const std::string& output, boost::shared_ptr<AVFormatContext> out,
+      AVStream* stream, const AVStream* source) {
+
+    const AVCodecParameters* params = source->codecpar;
+    AVRational rate = (source->avg_frame_rate.num > 0)?
+      source->avg_frame_rate : source->r_frame_rate;
+    if (rate.num <= 0 || rate.den <= 0) return boost::shared_ptr<AVCodecContext>();
+
+    boost::shared_ptr<AVCodecContext> retval;
+    try {
+      AVCodec* codec = find_encoder(output, out,
+          avcodec_get_name(params->codec_id));
+      retval = make_encoder_context(output, out.get(), stream, codec,
+          params->height, params->width, av_q2d(rate),
+          (params->bit_rate > 0)? params->bit_rate : 1500000., 12,
+          (params->color_space == AVCOL_SPC_BT709)? BT709 : BT601,
+          params->color_range == AVCOL_RANGE_JPEG);
+    }
+    catch (std::runtime_error&) {
+      return boost::shared_ptr<AVCodecContext>();
+    }
+
+    if (!can_concatenate(params, retval.get(), out->oformat))
+      return boost::shared_ptr<AVCodecContext>();
+    return retval;
+  }
+
+  /**
+   * Decodes frames [first, last) of the input, starting at the keyframe
+   * before 'first', and encodes them again. Their timestamps are shifted by
+   * 'origin', in the input time base. Returns the number of frames encoded.
+   */
+  static size_t encode_frames(const std::string& input,
+      boost::shared_ptr<AVFormatContext> in, int stream_index,
+      const FrameIndex& index, size_t first, size_t last, int64_t origin,
+      const std::string& output, boost::shared_ptr<AVFormatContext> out,
+      boost::shared_ptr<AVStream> stream,
+      boost::shared_ptr<AVCodecContext> encoder) {
+
+    AVStream* source = in->streams[stream_index];
+    boost::shared_ptr<AVCodecContext> decoder = make_decoder_context(input,
+        source, find_decoder(input, in, stream_index));
+    boost::shared_ptr<AVFrame> picture = make_empty_frame(input);
+
+    //if seeking fails, we decode from the start
+    size_t keyframe = index.keyframe_before(first);
+    if (keyframe) seek_video_stream(stream_index, in, decoder,
+        index.seek_timestamp(keyframe));
+
+    size_t encoded = 0;
+    int64_t previous = -1;
+    while (encoded < last - first) {
+      if (!skip_video_frame(input, previous + 1, stream_index, in, decoder,
+            picture, true)) break;
+
+      //pictures are identified by their timestamps, as after a seek
+      int64_t frame = index.frame_at(picture->best_effort_timestamp);
+      if (frame < 0) {
+        if (previous < 0) {
+          boost::format m("bob::io::video::trim(input=`%s', output=`%s') failed: cannot tell which frame the decoder output after seeking to frame %d");
+          m % input % output % keyframe;
+          throw std::runtime_error(m.str());
+        }
+        frame = previous + 1;
+      }
+      previous = frame;
+      if (frame < (int64_t)first) continue;
+      if (frame >= (int64_t)last) break;
+
+      //the encoder chooses the picture types
+      picture->pict_type = AV_PICTURE_TYPE_NONE;
+      picture->pts = av_rescale_q(index.pts(frame) - origin,
+          source->time_base, stream->time_base);
+      encode_context_frame(output, out, stream, encoder, picture);
+      ++encoded;
+    }
+
+    flush_encoder(output, out, stream, encoder);
+    return encoded;
+  }
+
+  /**
+   * Copies the packets of frames [first, stop) of the input, where 'first'
+   * is a keyframe. Their timestamps are shifted by 'origin', in the input
+   * time base. Returns the number of frames in [first, stop) copied: packets
+   * of later frames, copied because the earlier ones need them, are not
+   * counted.
+   */
+  static size_t copy_frames(const std::string& input,
+      boost::shared_ptr<AVFormatContext> in, int stream_index,
+      const FrameIndex& index, size_t first, size_t stop, int64_t origin,
+      const std::string& output, boost::shared_ptr<AVFormatContext> out,
+      AVStream* stream) {
+
+    AVStream* source = in->streams[stream_index];
+
+    //if seeking fails, we read from the start (the input is only read
+    //before if frames were encoded, which never starts at frame zero)
+    if (first) av_seek_frame(in.get(), stream_index,
+        index.seek_timestamp(first), AVSEEK_FLAG_BACKWARD);
+
+    boost::shared_ptr<AVPacket> pkt = make_empty_packet(input);
+    bool started = false;
+    size_t wanted = 0; ///< frames in [first, stop) copied so far
+    size_t packets = 0;
+
+    while (wanted < stop - first) {
+      int ok = av_read_frame(in.get(), pkt.get());
+      if (ok == AVERROR_EOF) break;
+      if (ok < 0) {
+        boost::format m("bob::io::video::trim(input=`%s', output=`%s') failed: av_read_frame() reports error %d after copying %d packets");
+        m % input % output % ok % packets;
+        throw std::runtime_error(m.str());
+      }
+
+      int64_t pts = (pkt->pts != (int64_t)AV_NOPTS_VALUE)? pkt->pts : pkt->dts;
+      int64_t frame = index.frame_at(pts);
+
+      //skips other streams, packets before the keyframe and, after it,
+      //packets of earlier frames (that refer to the previous keyframe)
+      if (pkt->stream_index != stream_index ||
+          (!started && frame != (int64_t)first) ||
+          (frame >= 0 && frame < (int64_t)first)) {
+        av_packet_unref(pkt.get());
+        continue;
+      }
+      started = true;
+      if (frame < (int64_t)stop) ++wanted;
+
+      if (pkt->pts != (int64_t)AV_NOPTS_VALUE) pkt->pts -= origin;
+      if (pkt->dts != (int64_t)AV_NOPTS_VALUE) pkt->dts -= origin;
+      av_packet_rescale_ts(pkt.get(), source->time_base, stream->time_base);
+      pkt->stream_index = stream->index;
+      pkt->pos = -1;
+
+      ok = av_interleaved_write_frame(out.get(), pkt.get()); ///< unrefs pkt
+      if (ok < 0) {
+        boost::format m("bob::io::video::trim(input=`%s', output=`%s') failed: av_interleaved_write_frame() reports error %d after copying %d packets");
+        m % input % output % ok % packets;
+        throw std::runtime_error(m.str());
+      }
+      ++packets;
+    }
+
+    return wanted;
+  }
+
+  TrimResult trim(const std::string& input, const std::string& output,
+      size_t start, size_t stop, bool smart, const std::string& format) {
+
+    FrameIndex index(input);
+    if (!index.usable()) {
+      boost::format m("bob::io::video::trim(input=`%s', output=`%s') failed: the timestamps of the video stream cannot be used to locate frames, so it cannot be cut without decoding it");
+      m % input % output;
+      throw std::runtime_error(m.str());
+    }
+
+    stop = std::min(stop, index.size());
+    if (start >= stop) {
+      boost::format m("bob::io::video::trim(input=`%s', output=`%s', start=%d, stop=%d) failed: the range of frames is empty (the video has %d frames)");
+      m % input % output % start % stop % index.size();
+      throw std::runtime_error(m.str());
+    }
+
+    boost::shared_ptr<AVFormatContext> in = make_input_format_context(input);
+    int stream_index = find_video_stream(input, in);
+    const AVStream* source = in->streams[stream_index];
+
+    boost::shared_ptr<AVFormatContext> out =
+      make_output_format_context(output, format);
+    AVStream* raw_stream = avformat_new_stream(out.get(), 0);
+    if (!raw_stream) {
+      boost::format m("bob::io::video::avformat_new_stream(format=`%s') failed: could not allocate the video stream of file `%s'");
+      m % out->oformat->name % output;
+      throw std::runtime_error(m.str());
+    }
+    boost::shared_ptr<AVStream> stream(raw_stream, no_deallocation);
+
+    TrimResult result;
+    result.start = index.keyframe_before(start);
+    result.frames = 0;
+    result.encoded = 0;
+    size_t copy_from = result.start;
+
+    //smart cutting: the frames before the next keyframe are encoded again
+    boost::shared_ptr<AVCodecContext> encoder;
+    if (smart && result.start != start) {
+      encoder = make_smart_encoder(output, out, stream.get(), source);
+      if (encoder) {
+        result.start = start;
+        copy_from = std::min(index.keyframe_after(start), stop);
+      }
+    }
+
+    if (!encoder) {
+      int ok = avcodec_parameters_copy(stream->codecpar, source->codecpar);
+      if (ok < 0) {
+        boost::format m("bob::io::video::avcodec_parameters_copy() failed: cannot copy the parameters of the video stream of `%s' to file `%s' - ffmpeg reports error %d");
+        m % input % output % ok;
+        throw std::runtime_error(m.str());
+      }
+      stream->codecpar->codec_tag = 0; ///< the output container chooses
+      stream->time_base = source->time_base;
+    }
+
+    open_output_file(output, out);
+
+    //timestamps are shifted so the first frame is presented at zero
+    int64_t origin = index.pts(result.start);
+
+    if (encoder) {
+      result.encoded = encode_frames(input, in, stream_index, index, start,
+          copy_from, origin, output, out, stream, encoder);
+      result.frames += result.encoded;
+    }
+
+    if (copy_from < stop) result.frames += copy_frames(input, in,
+        stream_index, index, copy_from, stop, origin, output, out,
+        stream.get());
+
+    close_output_file(output, out);
+    return result;
+  }
+
+}}}
@@ -0,0 +1,48 @@
+#ifndef BOB_IO_VIDEO_TRIM_H
+#define BOB_IO_VIDEO_TRIM_H
+
+#include <string>
+#include <limits>
+#include <stdint.h>
+
+namespace bob { namespace io { namespace video {
+
+  /**
+   * What trim() wrote
+   */
+  struct TrimResult {
+    size_t start; ///< number of the first frame written, in the input
+    size_t frames; ///< number of frames written, from start up to stop
+    size_t encoded; ///< number of frames that were decoded and encoded again
+  };
+
+  /**
+   * Copies frames start, start+1, ... (up to, but excluding, 'stop', which
+   * is clipped to the number of frames) of the video stream of file 'input'
+   * to a new file 'output', without decoding them: their compressed packets
+   * are copied as they are, with timestamps shifted so the first frame is
+   * presented at zero. Frames are located using a FrameIndex of the input.
+   *
+   * As a stream can only start at a keyframe, the copy starts at the
+   * keyframe before 'start'. With 'smart' cutting, the frames from 'start'
+   * up to the next keyframe are decoded and encoded again instead (with the
+   * same codec and parameters), and the following ones copied. This is only
+   * possible if the encoder produces packets that can precede the copied
+   * ones (see can_concatenate()): otherwise, the copy starts at the
+   * keyframe, as without smart cutting. As the encoder headers must then be
+   * byte-identical to the input ones in containers with global headers, it
+   * does not apply to H.264 in MP4, for instance. Codecs that reorder frames
+   * may have a few frames after 'stop' copied as well, as they are needed to
+   * decode the ones before: they are not counted in TrimResult::frames.
+   *
+   * The output format is guessed from the output filename extension if
+   * 'format' is empty. Raises if the input timestamps cannot be used to
+   * locate frames or if the range of frames is empty.
+   */
+  TrimResult trim(const std::string& input, const std::string& output,
+      size_t start, size_t stop=std::numeric_limits<size_t>::max(),
+      bool smart=false, const std::string& format="");
+
+}}}
+
+#endif /* BOB_IO_VIDEO_TRIM_H */
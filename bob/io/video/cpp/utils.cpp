@@ -1,4 +1,6 @@
 #include <set>
+#include <cstring>
+#include <algorithm>
 #include <boost/token_iterator.hpp>
 #include <boost/format.hpp>
 
@@ -337,29 +339,232 @@ static void deallocate_input_format_context(AVFormatContext* c) {
   avformat_close_input(&c);
 }
 
-boost::shared_ptr<AVFormatContext> bob::io::video::make_input_format_context(
-    const std::string& filename) {
+/**
+ * Size of the AVIOContext buffer used with memory mapped files. Large reads
+ * bypass this buffer altogether (the I/O context is set to direct mode).
+ */
+static const int MAPPED_INPUT_BUFFER_SIZE = 32768;
 
-  AVFormatContext* retval = 0;
+/**
+ * Distance we ask the kernel to prefetch after each seek on a memory mapped
+ * file.
+ */
+static const size_t MAPPED_INPUT_SEEK_PREFETCH = 1 << 20;
+
+/**
+ * Read cursor on a memory mapped file - one per AVFormatContext. The mapping
+ * itself is shared.
+ */
+struct mapped_input {
+  boost::shared_ptr<const bob::io::video::MappedFile> file;
+  int64_t pos;
+};
+
+static int mapped_input_read(void* opaque, uint8_t* buf, int buf_size) {
+  mapped_input* s = static_cast<mapped_input*>(opaque);
+  int64_t available = (int64_t)s->file->size() - s->pos;
+  if (available <= 0) return AVERROR_EOF;
+  int n = (available < buf_size)? (int)available : buf_size;
+  std::memcpy(buf, s->file->data() + s->pos, n);
+  s->pos += n;
+  return n;
+}
+
+static int64_t mapped_input_seek(void* opaque, int64_t offset, int whence) {
+  mapped_input* s = static_cast<mapped_input*>(opaque);
+  int64_t size = s->file->size();
+
+  if (whence & AVSEEK_SIZE) return size;
+
+  int64_t pos = 0;
+  switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET: pos = offset; break;
+    case SEEK_CUR: pos = s->pos + offset; break;
+    case SEEK_END: pos = size + offset; break;
+    default: return AVERROR(EINVAL);
+  }
+  if (pos < 0 || pos > size) return AVERROR(EINVAL);
+
+  if (pos != s->pos) s->file->will_need(pos, MAPPED_INPUT_SEEK_PREFETCH);
+  s->pos = pos;
+  return pos;
+}
+
+/**
+ * Size of the AVIOContext buffer used with forward-only input streams.
+ */
+static const int STREAM_INPUT_BUFFER_SIZE = 32768;
+
+static int stream_input_read(void* opaque, uint8_t* buf, int buf_size) {
+  bob::io::video::InputStream* s =
+    static_cast<bob::io::video::InputStream*>(opaque);
+  int n = s->read(buf, buf_size);
+  if (n == 0) return AVERROR_EOF;
+  return n;
+}
+
+/**
+ * Deletes a format context opened on a custom I/O context, together with
+ * the I/O context itself (which is not owned by the format context) and the
+ * state its callbacks use.
+ */
+struct custom_input_deleter {
+
+  AVIOContext* pb;
+  boost::shared_ptr<void> state;
+
+  void operator() (AVFormatContext* c) {
+    avformat_close_input(&c);
+    av_freep(&pb->buffer); ///< may have been re-allocated by FFmpeg
+    avio_context_free(&pb);
+    state.reset();
+  }
+
+};
+
+/**
+ * Opens a format context reading through the given callbacks. 'state' is
+ * kept alive for as long as the context exists and passed to the callbacks.
+ * If 'seek' is not set, the input is flagged as non-seekable.
+ */
+static boost::shared_ptr<AVFormatContext> custom_input_open(
+    const std::string& filename, const char* what, boost::shared_ptr<void> state,
+    int buffer_size, int (*read)(void*, uint8_t*, int),
+    int64_t (*seek)(void*, int64_t, int), bool direct) {
+
+  uint8_t* buffer = static_cast<uint8_t*>(av_malloc(buffer_size));
+  AVIOContext* pb = 0;
+  if (buffer) pb = avio_alloc_context(buffer, buffer_size, 0,
+      state.get(), read, 0, seek);
+  AVFormatContext* retval = pb? avformat_alloc_context() : 0;
+
+  if (!retval) {
+    if (pb) avio_context_free(&pb);
+    av_free(buffer);
+    boost::format m("bob::io::video::avio_alloc_context(filename=`%s') failed: cannot allocate I/O context to read from %s");
+    m % filename % what;
+    throw std::runtime_error(m.str());
+  }
+
+  pb->direct = direct;
+  retval->pb = pb;
 
   int ok = avformat_open_input(&retval, filename.c_str(), 0, 0);
   if (ok != 0) {
-    boost::format m("bob::io::video::avformat_open_input(filename=`%s') failed: ffmpeg reported %d == `%s'");
-    m % filename % ok % ffmpeg_error(ok);
+    // N.B.: retval is freed by avformat_open_input() on failures
+    av_freep(&pb->buffer);
+    avio_context_free(&pb);
+    boost::format m("bob::io::video::avformat_open_input(filename=`%s', %s) failed: ffmpeg reported %d == `%s'");
+    m % filename % what % ok % ffmpeg_error(ok);
     throw std::runtime_error(m.str());
   }
 
-  // creates and protects the return value
-  boost::shared_ptr<AVFormatContext> shared_retval(retval, std::ptr_fun(deallocate_input_format_context));
+  custom_input_deleter deleter;
+  deleter.pb = pb;
+  deleter.state = state;
+  return boost::shared_ptr<AVFormatContext>(retval, deleter);
+}
+
+static void check_stream_info(const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context) {
 
   // retrieve stream information, throws if cannot find it
-  ok = avformat_find_stream_info(retval, 0);
+  int ok = avformat_find_stream_info(format_context.get(), 0);
 
   if (ok < 0) {
     boost::format m("bob::io::video::avformat_find_stream_info(filename=`%s') failed: ffmpeg reported %d == `%s'");
     m % filename % ok % ffmpeg_error(ok);
     throw std::runtime_error(m.str());
   }
+}
+
+boost::shared_ptr<AVFormatContext> bob::io::video::make_input_format_context(
+    const std::string& filename,
+    boost::shared_ptr<const bob::io::video::MappedFile> mapping) {
+
+  boost::shared_ptr<AVFormatContext> shared_retval;
+
+  if (mapping) {
+    boost::shared_ptr<mapped_input> state(new mapped_input);
+    state->file = mapping;
+    state->pos = 0;
+    // reads are plain memory copies out of the mapping: let avio_read() call
+    // us directly with the destination buffer instead of copying through its
+    // own buffer first
+    shared_retval = custom_input_open(filename, "memory mapped file", state,
+        MAPPED_INPUT_BUFFER_SIZE, &mapped_input_read, &mapped_input_seek,
+        true);
+  }
+
+  else {
+    AVFormatContext* retval = 0;
+
+    int ok = avformat_open_input(&retval, filename.c_str(), 0, 0);
+    if (ok != 0) {
+      boost::format m("bob::io::video::avformat_open_input(filename=`%s') failed: ffmpeg reported %d == `%s'");
+      m % filename % ok % ffmpeg_error(ok);
+      throw std::runtime_error(m.str());
+    }
+
+    // creates and protects the return value
+    shared_retval.reset(retval, std::ptr_fun(deallocate_input_format_context));
+  }
+
+  check_stream_info(filename, shared_retval);
+
+  return shared_retval;
+}
+
+boost::shared_ptr<AVFormatContext> bob::io::video::make_input_format_context(
+    const std::string& filename,
+    boost::shared_ptr<bob::io::video::InputStream> stream) {
+
+  boost::shared_ptr<AVFormatContext> retval = custom_input_open(filename,
+      "stream", stream, STREAM_INPUT_BUFFER_SIZE, &stream_input_read, 0,
+      false);
+
+  check_stream_info(filename, retval);
+
+  return retval;
+}
+
+/**
+ * Tells if the header of the container already describes the video stream
+ * well enough, so there is no need to read and decode packets.
+ */
+static bool has_stream_info(AVFormatContext* format_context) {
+  int stream_index = av_find_best_stream(format_context, AVMEDIA_TYPE_VIDEO,
+      -1, -1, 0, 0);
+  if (stream_index < 0) return false;
+  AVStream* stream = format_context->streams[stream_index];
+  return stream->codecpar->codec_id != AV_CODEC_ID_NONE &&
+    stream->codecpar->width > 0 && stream->codecpar->height > 0 &&
+    (stream->avg_frame_rate.num > 0 || stream->r_frame_rate.num > 0);
+}
+
+boost::shared_ptr<AVFormatContext> bob::io::video::make_probe_format_context(
+    const std::string& filename, int64_t probesize, int64_t analyzeduration) {
+
+  AVDictionary* options = 0;
+  if (probesize > 0) av_dict_set_int(&options, "probesize", probesize, 0);
+  if (analyzeduration > 0)
+    av_dict_set_int(&options, "analyzeduration", analyzeduration, 0);
+
+  AVFormatContext* retval = 0;
+  int ok = avformat_open_input(&retval, filename.c_str(), 0, &options);
+  av_dict_free(&options);
+  if (ok != 0) {
+    boost::format m("bob::io::video::avformat_open_input(filename=`%s') failed: ffmpeg reported %d == `%s'");
+    m % filename % ok % ffmpeg_error(ok);
+    throw std::runtime_error(m.str());
+  }
+
+  // creates and protects the return value
+  boost::shared_ptr<AVFormatContext> shared_retval(retval,
+      std::ptr_fun(deallocate_input_format_context));
+
+  // only reads packets if the container header is not enough
+  if (!has_stream_info(retval)) check_stream_info(filename, shared_retval);
 
   return shared_retval;
 }
@@ -576,6 +781,17 @@ boost::shared_ptr<SwsContext> bob::io::video::make_scaler
   return boost::shared_ptr<SwsContext>(retval, std::ptr_fun(deallocate_swscaler));
 }
 
+void bob::io::video::set_scaler_colorspace(
+    boost::shared_ptr<SwsContext> scaler, YUVMatrix matrix,
+    bool full_range, bool source_full_range) {
+  const int* table = sws_getCoefficients((matrix == BT709)?
+      SWS_CS_ITU709 : SWS_CS_ITU601);
+  //the result is ignored on purpose, as older scalers refuse to change the
+  //coefficients of YUV outputs
+  sws_setColorspaceDetails(scaler.get(), table, source_full_range? 1 : 0,
+      table, full_range? 1 : 0, 0, 1 << 16, 1 << 16);
+}
+
 /**
  * Transforms from Bob's planar 8-bit RGB representation to whatever is
  * required by the FFmpeg encoder output context (peeked from the AVStream
@@ -586,18 +802,21 @@ static void image_to_context(const blitz::Array<uint8_t,3>& data,
     boost::shared_ptr<SwsContext> scaler,
     boost::shared_ptr<AVFrame> output_frame) {
 
-  /** The ffmpeg sws scaler requires contiguous planes of data **/
-  if (!bob::core::array::isCContiguous(data)) {
-    throw std::runtime_error("sws_scale() check failed: cannot encode blitz::Array<uint8_t,3> in video stream - ffmpeg/libav requires contiguous color planes");
-  }
-
   int width = stream->codecpar->width;
   int height = stream->codecpar->height;
 
+  /** The ffmpeg sws scaler takes any row stride, but contiguous pixels **/
+  if (data.stride(2) != 1 || data.stride(1) < width) {
+    boost::format m("sws_scale() check failed: cannot encode blitz::Array<uint8_t,3> in video stream - ffmpeg/libav requires contiguous pixels in each row of the color planes, but the strides of your frame are %dx%dx%d");
+    m % data.stride(0) % data.stride(1) % data.stride(2);
+    throw std::runtime_error(m.str());
+  }
+
+  //planes are passed in the order of AV_PIX_FMT_GBRP, where they are
   const uint8_t* datap = data.data();
-  int plane_size = width * height;
-  const uint8_t* planes[] = {datap+plane_size, datap+2*plane_size, datap, 0};
-  int linesize[] = {width, width, width, 0};
+  const uint8_t* planes[] = {datap + data.stride(0), datap + 2*data.stride(0),
+    datap, 0};
+  int linesize[] = {data.stride(1), data.stride(1), data.stride(1), 0};
 
   int ok = sws_scale(scaler.get(), planes, linesize, 0, height, output_frame->data, output_frame->linesize);
   if (ok < 0) {
@@ -647,7 +866,8 @@ static void deallocate_codec_context(AVCodecContext* c) {
 }
 
 boost::shared_ptr<AVCodecContext> bob::io::video::make_decoder_context(
-    const std::string& filename, AVStream* stream, AVCodec* codec) {
+    const std::string& filename, AVStream* stream, AVCodec* codec,
+    bool export_motion_vectors) {
 
   AVCodecContext* retval = avcodec_alloc_context3(codec);
 
@@ -661,6 +881,8 @@ boost::shared_ptr<AVCodecContext> bob::io::video::make_decoder_context(
     throw std::runtime_error(m.str());
   }
 
+  if (export_motion_vectors) retval->flags2 |= AV_CODEC_FLAG2_EXPORT_MVS;
+
   // In the case we opened for writing, this should initialize the context
   ok = avcodec_open2(retval, codec, 0);
   if (ok < 0) {
@@ -674,10 +896,47 @@ boost::shared_ptr<AVCodecContext> bob::io::video::make_decoder_context(
       std::ptr_fun(deallocate_codec_context));
 }
 
+/**
+ * Copies options into a new dictionary, which the caller must free, or
+ * returns an empty one (0) if there are none
+ */
+static AVDictionary* make_dictionary(const bob::io::video::Options* options) {
+  AVDictionary* retval = 0;
+  if (!options) return retval;
+  for (auto it = options->begin(); it != options->end(); ++it)
+    av_dict_set(&retval, it->first.c_str(), it->second.c_str(), 0);
+  return retval;
+}
+
+/**
+ * Replaces the options by the ones left in the dictionary by the function
+ * that took it (the ones it did not use), then frees the dictionary
+ */
+static void update_options(AVDictionary*& dictionary,
+    bob::io::video::Options* options) {
+  if (options) {
+    options->clear();
+    AVDictionaryEntry* entry = 0;
+    while ((entry = av_dict_get(dictionary, "", entry, AV_DICT_IGNORE_SUFFIX)))
+      (*options)[entry->key] = entry->value;
+  }
+  av_dict_free(&dictionary);
+}
+
+std::string bob::io::video::option_names(const Options& options) {
+  std::string retval;
+  for (auto it = options.begin(); it != options.end(); ++it) {
+    if (!retval.empty()) retval += ", ";
+    retval += "`" + it->first + "'";
+  }
+  return retval;
+}
+
 boost::shared_ptr<AVCodecContext> bob::io::video::make_encoder_context(
     const std::string& filename, AVFormatContext* fmtctxt, AVStream* stream,
     AVCodec* codec, size_t height, size_t width, double framerate, double
-    bitrate, size_t gop) {
+    bitrate, size_t gop, YUVMatrix matrix, bool full_range, size_t threads,
+    ThreadType thread_type, size_t slices, Options* options) {
 
   AVCodecContext* retval = avcodec_alloc_context3(codec);
 
@@ -729,16 +988,42 @@ boost::shared_ptr<AVCodecContext> bob::io::video::make_encoder_context(
     retval->color_range = AVCOL_RANGE_JPEG;
   }
 
+  /* tags the colour matrix and range of YUV pictures */
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(retval->pix_fmt);
+  if (desc && !(desc->flags & AV_PIX_FMT_FLAG_RGB) && desc->nb_components >= 3) {
+    retval->colorspace = (matrix == BT709)? AVCOL_SPC_BT709 : AVCOL_SPC_SMPTE170M;
+    if (full_range) retval->color_range = AVCOL_RANGE_JPEG;
+  }
+
   /* Some formats want stream headers to be separate. */
   if (fmtctxt->oformat->flags & AVFMT_GLOBALHEADER) {
     retval->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
   }
 
+  /* threading: the encoder falls back to a single thread if it does not
+   * support the method requested */
+  retval->thread_count = threads;
+  switch (thread_type) {
+    case FRAME_THREADS:
+      retval->thread_type = FF_THREAD_FRAME;
+      break;
+    case SLICE_THREADS:
+      retval->thread_type = FF_THREAD_SLICE;
+      break;
+    default:
+      retval->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+  }
+  if (slices) retval->slices = slices;
+
   // In the case we opened for writing, this should initialize the context
-  int ok = avcodec_open2(retval, codec, 0);
+  AVDictionary* dictionary = make_dictionary(options);
+  int ok = avcodec_open2(retval, codec, &dictionary);
+  update_options(dictionary, options);
   if (ok < 0) {
-    boost::format m("bob::io::video::avcodec_open2(codec=`%s'(0x%x) == `%s') failed: cannot open codec context to start reading or writing video file `%s' - ffmpeg reports error %d == `%s'");
+    deallocate_codec_context(retval);
+    boost::format m("bob::io::video::avcodec_open2(codec=`%s'(0x%x) == `%s') failed: cannot open codec context to start reading or writing video file `%s'%s - ffmpeg reports error %d == `%s'");
     m % codec->name % codec->id % codec->long_name % filename
+      % (options && options->size()? " (check the values of the options given)" : "")
       % ok % ffmpeg_error(ok);
     throw std::runtime_error(m.str());
   }
@@ -757,11 +1042,74 @@ boost::shared_ptr<AVCodecContext> bob::io::video::make_encoder_context(
       std::ptr_fun(deallocate_codec_context));
 }
 
+/**
+ * Size of the AVIOContext buffer used with output streams.
+ */
+static const int STREAM_OUTPUT_BUFFER_SIZE = 32768;
+
+static int stream_output_write(void* opaque, uint8_t* buf, int buf_size) {
+  bob::io::video::OutputStream* s =
+    static_cast<bob::io::video::OutputStream*>(opaque);
+  return s->write(buf, buf_size);
+}
+
+static int64_t stream_output_seek(void* opaque, int64_t offset, int whence) {
+  bob::io::video::OutputStream* s =
+    static_cast<bob::io::video::OutputStream*>(opaque);
+  return s->seek(offset, whence);
+}
+
+/**
+ * Deletes an I/O context writing to a stream, together with its buffer, and
+ * releases the stream
+ */
+struct custom_output_deleter {
+
+  boost::shared_ptr<bob::io::video::OutputStream> stream;
+
+  void operator() (AVIOContext* pb) {
+    av_freep(&pb->buffer); ///< may have been re-allocated by FFmpeg
+    avio_context_free(&pb);
+    stream.reset();
+  }
+
+};
+
+boost::shared_ptr<AVIOContext> bob::io::video::make_output_io_context(
+    const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<OutputStream> stream) {
+
+  bool seekable = stream->seekable();
+  uint8_t* buffer =
+    static_cast<uint8_t*>(av_malloc(STREAM_OUTPUT_BUFFER_SIZE));
+  AVIOContext* pb = 0;
+  if (buffer) pb = avio_alloc_context(buffer, STREAM_OUTPUT_BUFFER_SIZE, 1,
+      stream.get(), 0, &stream_output_write,
+      seekable? &stream_output_seek : 0);
+
+  if (!pb) {
+    av_free(buffer);
+    boost::format m("bob::io::video::avio_alloc_context(filename=`%s') failed: cannot allocate I/O context to write to %s");
+    m % filename % stream->name();
+    throw std::runtime_error(m.str());
+  }
+
+  pb->seekable = seekable? AVIO_SEEKABLE_NORMAL : 0;
+  format_context->pb = pb;
+  format_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+  custom_output_deleter deleter;
+  deleter.stream = stream;
+  return boost::shared_ptr<AVIOContext>(pb, deleter);
+}
+
 void bob::io::video::open_output_file(const std::string& filename,
-    boost::shared_ptr<AVFormatContext> format_context) {
+    boost::shared_ptr<AVFormatContext> format_context, Options* options) {
 
   /* open the output file, if needed */
-  if (!(format_context->oformat->flags & AVFMT_NOFILE)) {
+  if (!(format_context->oformat->flags & AVFMT_NOFILE) &&
+      !(format_context->flags & AVFMT_FLAG_CUSTOM_IO)) {
     if (avio_open(&format_context->pb, filename.c_str(), AVIO_FLAG_WRITE) < 0) {
       boost::format m("bob::io::video::avio_open(filename=`%s', AVIO_FLAG_WRITE) failed: cannot open output file for writing");
       m % filename.c_str();
@@ -770,7 +1118,9 @@ void bob::io::video::open_output_file(const std::string& filename,
   }
 
   /* Write the stream header, if any. */
-  int error = avformat_write_header(format_context.get(), 0);
+  AVDictionary* dictionary = make_dictionary(options);
+  int error = avformat_write_header(format_context.get(), &dictionary);
+  update_options(dictionary, options);
   if (error < 0) {
     boost::format m("bob::io::video::avformat_write_header(filename=`%s') failed: cannot write header to output file for some reason - ffmpeg reports error %d == `%s'");
     m % filename.c_str() % error % ffmpeg_error(error);
@@ -792,15 +1142,18 @@ void bob::io::video::close_output_file(const std::string& filename,
     throw std::runtime_error(m.str());
   }
 
-  /* Closes the output file */
-  avio_closep(&format_context->pb);
+  /* Closes the output file; streams are flushed, and closed by their owner */
+  if (format_context->flags & AVFMT_FLAG_CUSTOM_IO) {
+    if (format_context->pb) avio_flush(format_context->pb);
+  }
+  else avio_closep(&format_context->pb);
 
 }
 
 static AVPacket* allocate_packet() {
   AVPacket* retval = av_packet_alloc();
   if (!retval) {
-    boost::format m("bob::io::video::av_packet_alloc() failed to allocate a new packet");
+    throw std::runtime_error("bob::io::video::av_packet_alloc() failed to allocate a new packet");
   }
   av_init_packet(retval);
   retval->data = 0;
@@ -817,6 +1170,16 @@ static boost::shared_ptr<AVPacket> make_packet() {
       std::ptr_fun(deallocate_packet));
 }
 
+boost::shared_ptr<AVPacket> bob::io::video::make_empty_packet(const std::string& filename) {
+  AVPacket* retval = av_packet_alloc();
+  if (!retval) {
+    boost::format m("bob::io::video::av_packet_alloc() failed: cannot allocate packet to read file `%s'");
+    m % filename;
+    throw std::runtime_error(m.str());
+  }
+  return boost::shared_ptr<AVPacket>(retval, std::ptr_fun(deallocate_packet));
+}
+
 static void write_packet_to_stream(const std::string& filename,
     boost::shared_ptr<AVFormatContext> format_context,
     boost::shared_ptr<AVStream> stream,
@@ -867,19 +1230,11 @@ void bob::io::video::flush_encoder (const std::string& filename,
 
 }
 
-void bob::io::video::write_video_frame (const blitz::Array<uint8_t,3>& data,
-    const std::string& filename,
+void bob::io::video::encode_context_frame(const std::string& filename,
     boost::shared_ptr<AVFormatContext> format_context,
     boost::shared_ptr<AVStream> stream,
     boost::shared_ptr<AVCodecContext> codec_context,
-    boost::shared_ptr<AVFrame> context_frame,
-    boost::shared_ptr<AVFrame> tmp_frame,
-    boost::shared_ptr<SwsContext> swscaler) {
-
-  if (tmp_frame)
-    image_to_context(data, stream, swscaler, context_frame, tmp_frame);
-  else
-    image_to_context(data, stream, swscaler, context_frame);
+    boost::shared_ptr<AVFrame> context_frame) {
 
   boost::shared_ptr<AVPacket> pkt = make_packet();
 
@@ -921,6 +1276,130 @@ void bob::io::video::write_video_frame (const blitz::Array<uint8_t,3>& data,
 
 }
 
+void bob::io::video::write_video_frame (const blitz::Array<uint8_t,3>& data,
+    const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVStream> stream,
+    boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<AVFrame> context_frame,
+    boost::shared_ptr<AVFrame> tmp_frame,
+    boost::shared_ptr<SwsContext> swscaler) {
+
+  if (tmp_frame)
+    image_to_context(data, stream, swscaler, context_frame, tmp_frame);
+  else
+    image_to_context(data, stream, swscaler, context_frame);
+
+  encode_context_frame(filename, format_context, stream, codec_context,
+      context_frame);
+}
+
+void bob::io::video::write_packed_video_frame (const uint8_t* data,
+    int linesize, const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVStream> stream,
+    boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<AVFrame> context_frame,
+    boost::shared_ptr<SwsContext> swscaler) {
+
+  const uint8_t* planes[] = {data, 0};
+  int linesizes[] = {linesize, 0};
+
+  write_video_planes(planes, linesizes, filename, format_context, stream,
+      codec_context, context_frame, swscaler);
+}
+
+void bob::io::video::write_video_planes (const uint8_t* const* planes,
+    const int* linesizes, const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVStream> stream,
+    boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<AVFrame> context_frame,
+    boost::shared_ptr<SwsContext> swscaler) {
+
+  int ok = sws_scale(swscaler.get(), planes, linesizes, 0,
+      stream->codecpar->height, context_frame->data, context_frame->linesize);
+  if (ok < 0) {
+    boost::format m("bob::io::video::sws_scale() failed: could not scale frame while encoding - ffmpeg reports error %d = `%s'");
+    m % ok % ffmpeg_error(ok);
+    throw std::runtime_error(m.str());
+  }
+
+  encode_context_frame(filename, format_context, stream, codec_context,
+      context_frame);
+}
+
+bool bob::io::video::can_concatenate(const AVCodecParameters* params,
+    const AVCodecContext* encoder, const AVOutputFormat* oformat) {
+
+  bool same_headers = (params->extradata_size == encoder->extradata_size) &&
+    (!params->extradata_size || !std::memcmp(params->extradata,
+      encoder->extradata, params->extradata_size));
+
+  return params->codec_id == encoder->codec_id &&
+    params->width == encoder->width && params->height == encoder->height &&
+    params->format == encoder->pix_fmt &&
+    params->video_delay == 0 && encoder->max_b_frames == 0 &&
+    encoder->has_b_frames == 0 &&
+    (!(oformat->flags & AVFMT_GLOBALHEADER) || same_headers);
+}
+
+size_t bob::io::video::copy_video_packets(const std::string& filename,
+    boost::shared_ptr<AVFormatContext> input, int stream_index,
+    boost::shared_ptr<AVFormatContext> output,
+    boost::shared_ptr<AVStream> stream, int64_t& next_pts) {
+
+  AVStream* source = input->streams[stream_index];
+  int64_t start = (source->start_time != (int64_t)AV_NOPTS_VALUE)?
+    source->start_time : 0;
+
+  //packets without a duration last for one frame
+  int64_t frame_duration = 1;
+  if (source->avg_frame_rate.num > 0 && source->avg_frame_rate.den > 0)
+    frame_duration = std::max<int64_t>(1, av_rescale_q(1,
+          av_inv_q(source->avg_frame_rate), stream->time_base));
+
+  boost::shared_ptr<AVPacket> pkt = make_packet();
+  size_t packets = 0;
+  next_pts = 0;
+
+  while (true) {
+    int ok = av_read_frame(input.get(), pkt.get());
+    if (ok == AVERROR_EOF) break;
+    if (ok < 0) {
+      boost::format m("bob::io::video::av_read_frame() failed: cannot read packet %d of `%s' to copy it - ffmpeg reports error %d == `%s'");
+      m % packets % filename % ok % ffmpeg_error(ok);
+      throw std::runtime_error(m.str());
+    }
+
+    if (pkt->stream_index != stream_index) {
+      av_packet_unref(pkt.get());
+      continue;
+    }
+
+    if (pkt->pts != (int64_t)AV_NOPTS_VALUE) pkt->pts -= start;
+    if (pkt->dts != (int64_t)AV_NOPTS_VALUE) pkt->dts -= start;
+    av_packet_rescale_ts(pkt.get(), source->time_base, stream->time_base);
+    if (pkt->duration <= 0) pkt->duration = frame_duration;
+    pkt->stream_index = stream->index;
+    pkt->pos = -1;
+
+    int64_t pts = (pkt->pts != (int64_t)AV_NOPTS_VALUE)? pkt->pts : pkt->dts;
+    if (pts == (int64_t)AV_NOPTS_VALUE) pts = packets * frame_duration;
+    next_pts = std::max(next_pts, pts + pkt->duration);
+
+    ok = av_interleaved_write_frame(output.get(), pkt.get()); ///< unrefs pkt
+    if (ok < 0) {
+      boost::format m("bob::io::video::av_interleaved_write_frame() failed: failed to copy packet %d of `%s' to the output - ffmpeg reports error %d == `%s'");
+      m % packets % filename % ok % ffmpeg_error(ok);
+      throw std::runtime_error(m.str());
+    }
+    ++packets;
+  }
+
+  return packets;
+}
+
 // The flush packet is a non-NULL packet with size 0 and data NULL
 static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame,
     AVPacket *pkt)
@@ -938,7 +1417,8 @@ static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame,
   }
 
   ret = avcodec_receive_frame(avctx, frame);
-  if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+  if (ret == AVERROR_EOF) return ret; //decoder is fully drained
+  if (ret < 0 && ret != AVERROR(EAGAIN))
     return ret;
   if (ret >= 0)
     *got_frame = 1;
@@ -954,10 +1434,11 @@ static int decode_frame (const std::string& filename, int current_frame,
     boost::shared_ptr<AVPacket> pkt,
     int& got_frame, bool throw_on_error) {
 
-  // In this call, 3 things can happen:
+  // In this call, 4 things can happen:
   //
-  // 1. if ok < 0, an error has been detected
-  // 2. if ok >=0, something was read from the file, correctly. In this
+  // 1. if ok == AVERROR_EOF, the decoder has been fully drained
+  // 2. if ok < 0, an error has been detected
+  // 3. if ok >=0, something was read from the file, correctly. In this
   // condition, **only* if "got_frame" == 1, a frame is ready to be decoded.
   //
   // It is **not** an error that ok is >= 0 and got_frame == 0. This, in fact,
@@ -965,7 +1446,7 @@ static int decode_frame (const std::string& filename, int current_frame,
 
   int ok = decode(codec_context.get(), context_frame.get(), &got_frame,
       pkt.get());
-  if (ok < 0 && throw_on_error) {
+  if (ok < 0 && ok != AVERROR_EOF && throw_on_error) {
     boost::format m("bob::io::video::avcodec_decode_video/2() failed: could not decode frame %d of file `%s' - ffmpeg reports error %d == `%s'");
     m % current_frame % filename % ok % ffmpeg_error(ok);
     throw std::runtime_error(m.str());
@@ -976,26 +1457,52 @@ static int decode_frame (const std::string& filename, int current_frame,
     // In this case, we call the software scaler to decode the frame data.
     // Normally, this means converting from planar YUV420 into packed RGB.
 
-    uint8_t* planes[] = {data, 0};
-    int linesize[] = {3*codec_context->width, 0};
+    if (!bob::io::video::scale_video_frame(filename, current_frame,
+          codec_context, scaler, context_frame, data, throw_on_error))
+      return -1;
 
-    int conv_height = sws_scale(scaler.get(), context_frame->data,
-        context_frame->linesize, 0, codec_context->height, planes, linesize);
+  }
 
-    if (conv_height < 0) {
+  return ok;
+}
 
-      if (throw_on_error) {
-        boost::format m("bob::io::video::sws_scale() failed: could not scale frame %d of file `%s' - ffmpeg reports error %d");
-        m % current_frame % filename % conv_height;
-        throw std::runtime_error(m.str());
-      }
+bool bob::io::video::scale_video_frame (const std::string& filename,
+    int current_frame, boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<SwsContext> scaler,
+    boost::shared_ptr<AVFrame> context_frame, uint8_t* data,
+    bool throw_on_error) {
 
-      return -1;
+  uint8_t* planes[] = {data, 0};
+  int linesize[] = {3*codec_context->width, 0};
+
+  int conv_height = sws_scale(scaler.get(), context_frame->data,
+      context_frame->linesize, 0, codec_context->height, planes, linesize);
+
+  if (conv_height < 0) {
+
+    if (throw_on_error) {
+      boost::format m("bob::io::video::sws_scale() failed: could not scale frame %d of file `%s' - ffmpeg reports error %d");
+      m % current_frame % filename % conv_height;
+      throw std::runtime_error(m.str());
     }
 
+    return false;
   }
 
-  return ok;
+  return true;
+}
+
+bool bob::io::video::seek_video_stream (int stream_index,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVCodecContext> codec_context, int64_t timestamp) {
+
+  int ok = av_seek_frame(format_context.get(), stream_index, timestamp,
+      AVSEEK_FLAG_BACKWARD);
+  if (ok < 0) return false;
+
+  // drops frames buffered in the decoder, from before the seek
+  avcodec_flush_buffers(codec_context.get());
+  return true;
 }
 
 bool bob::io::video::read_video_frame (const std::string& filename,
@@ -1030,31 +1537,30 @@ bool bob::io::video::read_video_frame (const std::string& filename,
     else return false;
   }
 
-  // it is the end of the file
+  // it is the end of the file: drains the frames still buffered in the
+  // decoder, if any. N.B.: av_packet_unref() resets the stream index.
   pkt->data = NULL;
   pkt->size = 0;
+  pkt->stream_index = stream_index;
   //N.B.: got_frame == 0
   const unsigned int MAX_FLUSH_ITERATIONS = 128;
   unsigned int iteration_counter = MAX_FLUSH_ITERATIONS;
   do {
-    if (pkt->stream_index == stream_index) {
-      decode_frame(filename, current_frame, codec_context,
-          swscaler, context_frame, data, pkt, got_frame,
-          throw_on_error);
-      --iteration_counter;
-      if (iteration_counter == 0) {
-        if (throw_on_error) {
-          boost::format m("bob::io::video::decode_frame() failed: on file `%s' - I've been iterating for over %d times and I cannot find a new frame: this codec (%s) must be buggy!");
-          m % filename % MAX_FLUSH_ITERATIONS % codec_context->codec->name;
-          throw std::runtime_error(m.str());
-        }
-        break;
+    ok = decode_frame(filename, current_frame, codec_context,
+        swscaler, context_frame, data, pkt, got_frame, throw_on_error);
+    if (ok == AVERROR_EOF) break; //no more frames
+    --iteration_counter;
+    if (iteration_counter == 0) {
+      if (throw_on_error) {
+        boost::format m("bob::io::video::decode_frame() failed: on file `%s' - I've been iterating for over %d times and I cannot find a new frame: this codec (%s) must be buggy!");
+        m % filename % MAX_FLUSH_ITERATIONS % codec_context->codec->name;
+        throw std::runtime_error(m.str());
       }
+      break;
     }
-    else break;
   } while (got_frame == 0);
 
-  return true;
+  return got_frame != 0;
 }
 
 static int dummy_decode_frame (const std::string& filename, int current_frame,
@@ -1063,10 +1569,11 @@ static int dummy_decode_frame (const std::string& filename, int current_frame,
     boost::shared_ptr<AVPacket> pkt,
     int& got_frame, bool throw_on_error) {
 
-  // In this call, 3 things can happen:
+  // In this call, 4 things can happen:
   //
-  // 1. if ok < 0, an error has been detected
-  // 2. if ok >=0, something was read from the file, correctly. In this
+  // 1. if ok == AVERROR_EOF, the decoder has been fully drained
+  // 2. if ok < 0, an error has been detected
+  // 3. if ok >=0, something was read from the file, correctly. In this
   // condition, **only* if "got_frame" == 1, a frame is ready to be decoded.
   //
   // It is **not** an error that ok is >= 0 and got_frame == 0. This, in fact,
@@ -1074,7 +1581,7 @@ static int dummy_decode_frame (const std::string& filename, int current_frame,
 
   int ok = decode(codec_context.get(), context_frame.get(), &got_frame,
       pkt.get());
-  if (ok < 0 && throw_on_error) {
+  if (ok < 0 && ok != AVERROR_EOF && throw_on_error) {
     boost::format m("bob::io::video::avcodec_decode_video/2() failed: could not skip frame %d of file `%s' - ffmpeg reports error %d == `%s'");
     m % current_frame % filename % ok % ffmpeg_error(ok);
     throw std::runtime_error(m.str());
@@ -1113,28 +1620,28 @@ bool bob::io::video::skip_video_frame (const std::string& filename,
     else return false;
   }
 
-  // it is the end of the file
+  // it is the end of the file: drains the frames still buffered in the
+  // decoder, if any. N.B.: av_packet_unref() resets the stream index.
   pkt->data = NULL;
   pkt->size = 0;
+  pkt->stream_index = stream_index;
   //N.B.: got_frame == 0
   const unsigned int MAX_FLUSH_ITERATIONS = 128;
   unsigned int iteration_counter = MAX_FLUSH_ITERATIONS;
   do {
-    if (pkt->stream_index == stream_index) {
-      dummy_decode_frame(filename, current_frame, codec_context,
-          context_frame, pkt, got_frame, throw_on_error);
-      --iteration_counter;
-      if (iteration_counter == 0) {
-        if (throw_on_error) {
-          boost::format m("bob::io::video::decode_frame() failed: on file `%s' - I've been iterating for over %d times and I cannot find a new frame: this codec (%s) must be buggy!");
-          m % filename % MAX_FLUSH_ITERATIONS % codec_context->codec->name;
-          throw std::runtime_error(m.str());
-        }
-        break;
+    ok = dummy_decode_frame(filename, current_frame, codec_context,
+        context_frame, pkt, got_frame, throw_on_error);
+    if (ok == AVERROR_EOF) break; //no more frames
+    --iteration_counter;
+    if (iteration_counter == 0) {
+      if (throw_on_error) {
+        boost::format m("bob::io::video::decode_frame() failed: on file `%s' - I've been iterating for over %d times and I cannot find a new frame: this codec (%s) must be buggy!");
+        m % filename % MAX_FLUSH_ITERATIONS % codec_context->codec->name;
+        throw std::runtime_error(m.str());
       }
+      break;
     }
-    else break;
   } while (got_frame == 0);
 
-  return true;
+  return got_frame != 0;
 }
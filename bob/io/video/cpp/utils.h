@@ -10,6 +10,11 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
 
+#include "mapped_file.h"
+#include "input_stream.h"
+#include "output_stream.h"
+#include "convert.h"
+
 extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
@@ -19,6 +24,46 @@ extern "C" {
 
 namespace bob { namespace io { namespace video {
 
+  /**
+   * Memory layouts of color frames: bob's planar (color-bands, height,
+   * width) one, or packed (height, width, color-bands), as used by OpenCV,
+   * PIL or TensorFlow
+   */
+  enum Layout {
+    PLANAR, ///< (color-bands, height, width), the default
+    PACKED ///< (height, width, color-bands)
+  };
+
+  /**
+   * How encoders spread their work over threads: by encoding several frames
+   * at once, by splitting each frame in slices encoded at once, or with the
+   * best method the encoder supports (frame threading, if it can)
+   */
+  enum ThreadType {
+    AUTO_THREADS, ///< the best method the encoder supports, the default
+    FRAME_THREADS, ///< several frames at once (adds a delay of one frame per thread)
+    SLICE_THREADS ///< several slices of each frame at once
+  };
+
+  /**
+   * How MP4 and QuickTime files are laid out: with the index (moov atom) at
+   * the end, as FFmpeg writes them by default, in fragments indexed as they
+   * are written, so readers can decode the file while it is written, or with
+   * the index moved to the front once the file is finished, so readers can
+   * decode it without seeking to the end ("faststart")
+   */
+  enum OutputMode {
+    DEFAULT_OUTPUT, ///< the index at the end, the default
+    FRAGMENTED_OUTPUT, ///< fragments, with "frag_keyframe+empty_moov"
+    FASTSTART_OUTPUT ///< the index at the front, moved when closing
+  };
+
+  /**
+   * Options passed to FFmpeg encoders and muxers, by name, with their values
+   * as strings (e.g. "preset" -> "ultrafast", "crf" -> "23")
+   */
+  typedef std::map<std::string, std::string> Options;
+
   /************************************************************************
    * General Utilities
    ************************************************************************/
@@ -98,12 +143,30 @@ namespace bob { namespace io { namespace video {
    * all acquired resources. Nonetheless, when this object is used in
    * conjunction with other objects required for file decoding, order must be
    * respected.
+   *
+   * If 'export_motion_vectors' is set, decoders that support it (e.g.
+   * H.264 and MPEG-4) attach the motion vectors of each frame to it, as
+   * AV_FRAME_DATA_MOTION_VECTORS side data.
    */
   boost::shared_ptr<AVCodecContext> make_decoder_context(
-      const std::string& filename, AVStream* stream, AVCodec* codec);
+      const std::string& filename, AVStream* stream, AVCodec* codec,
+      bool export_motion_vectors=false);
 
   /**
-   * Creates a new codec encoding context and verify all is good.
+   * Creates a new codec encoding context and verify all is good. YUV
+   * pictures are tagged with the given colour matrix and, if 'full_range'
+   * is set (or implied by the encoder, as for MJPEG), as full range.
+   *
+   * The encoder uses 'threads' threads (0 lets it pick one per core), with
+   * the given threading method: encoders that do not support it run on a
+   * single thread. 'slices' sets the number of slices per frame (0 keeps
+   * the encoder default): FFV1, for one, only encodes slices in parallel,
+   * and uses a single one by default.
+   *
+   * If 'options' is given, they are set on the encoder (codec options, like
+   * "g", or private ones, like "preset" for libx264) when it is opened: on
+   * return, it only keeps the ones the encoder did not use. Values the
+   * encoder rejects make opening it fail.
    *
    * @note The returned object knows how to correctly delete itself, freeing
    * all acquired resources. Nonetheless, when this object is used in
@@ -113,7 +176,9 @@ namespace bob { namespace io { namespace video {
   boost::shared_ptr<AVCodecContext> make_encoder_context(
       const std::string& filename, AVFormatContext* fmtctxt, AVStream* stream,
       AVCodec* codec, size_t height, size_t width, double framerate,
-      double bitrate, size_t gop);
+      double bitrate, size_t gop, YUVMatrix matrix, bool full_range,
+      size_t threads=0, ThreadType thread_type=AUTO_THREADS, size_t slices=0,
+      Options* options=0);
 
   /**
    * Allocates the software scaler that handles size and pixel format
@@ -132,6 +197,16 @@ namespace bob { namespace io { namespace video {
       boost::shared_ptr<AVCodecContext> stream,
       AVPixelFormat source_pixel_format, AVPixelFormat dest_pixel_format);
 
+  /**
+   * Sets the colour matrix and range of the YUV pictures an encoding scaler
+   * outputs, so they match the ones the encoder was tagged with (see
+   * make_encoder_context()). Scalers that cannot honour this keep their
+   * defaults. 'source_full_range' tells the range of the input, which is
+   * only meaningful for YUV or grayscale inputs: RGB is always full range.
+   */
+  void set_scaler_colorspace(boost::shared_ptr<SwsContext> scaler,
+      YUVMatrix matrix, bool full_range, bool source_full_range=true);
+
   /**
    * Allocates a frame for a particular context. The frame space will be
    * allocated to accomodate the type of encoding you defined, upon the
@@ -153,13 +228,46 @@ namespace bob { namespace io { namespace video {
    * Opens a video file for input, makes sure it finds the stream information
    * on that file. Otherwise, raises.
    *
+   * If a memory mapping of the file is given, the demuxer reads and seeks
+   * are served directly from it through a custom AVIOContext, instead of
+   * opening a new file handle. The mapping is kept alive for as long as the
+   * returned context exists.
+   *
    * @note The returned object knows how to correctly delete itself, freeing
    * all acquired resources. Nonetheless, when this object is used in
    * conjunction with other objects required for file encoding, order must be
    * respected.
    */
   boost::shared_ptr<AVFormatContext> make_input_format_context
-    (const std::string& filename);
+    (const std::string& filename,
+     boost::shared_ptr<const MappedFile> mapping=boost::shared_ptr<const MappedFile>());
+
+  /**
+   * Opens a forward-only input stream for reading, makes sure it finds the
+   * stream information on it. Otherwise, raises. The demuxer is told the
+   * input is not seekable. The stream is kept alive for as long as the
+   * returned context exists. The filename is only used for reporting.
+   *
+   * @note The returned object knows how to correctly delete itself, freeing
+   * all acquired resources.
+   */
+  boost::shared_ptr<AVFormatContext> make_input_format_context
+    (const std::string& filename, boost::shared_ptr<InputStream> stream);
+
+  /**
+   * Opens a video file to read its metadata only. The amount of data read to
+   * detect the format and the stream parameters is limited by 'probesize'
+   * (in bytes) and 'analyzeduration' (in microseconds) - zero means FFmpeg's
+   * defaults. Packets are only read (avformat_find_stream_info()) if the
+   * container header does not describe the video stream dimensions, codec
+   * and frame rate. Raises if the file cannot be opened.
+   *
+   * @note The returned object knows how to correctly delete itself, freeing
+   * all acquired resources.
+   */
+  boost::shared_ptr<AVFormatContext> make_probe_format_context
+    (const std::string& filename, int64_t probesize=0,
+     int64_t analyzeduration=0);
 
   /**
    * Finds the location of the video stream in the file or raises, if no video
@@ -184,12 +292,21 @@ namespace bob { namespace io { namespace video {
    */
   boost::shared_ptr<AVFrame> make_empty_frame(const std::string& filename);
 
+  /**
+   * Allocates an empty packet, to be filled by av_read_frame().
+   *
+   * @note The returned object knows how to correctly delete itself, freeing
+   * all acquired resources.
+   */
+  boost::shared_ptr<AVPacket> make_empty_packet(const std::string& filename);
+
   /**
    * Reads a single video frame from the stream. Input data must be previously
    * allocated and be of the right type and size for holding the frame
    * contents. It is an error to try to read past the end of the file.
    *
-   * @return true if it manages to load a video frame or false otherwise.
+   * @return true if it manages to load a video frame or false otherwise
+   * (e.g. the decoder has been fully drained at the end of the stream).
    */
   bool read_video_frame (const std::string& filename, int current_frame,
       int stream_index, boost::shared_ptr<AVFormatContext> format_context,
@@ -210,6 +327,33 @@ namespace bob { namespace io { namespace video {
       boost::shared_ptr<AVCodecContext> codec_context,
       boost::shared_ptr<AVFrame> context_frame, bool throw_on_error);
 
+  /**
+   * Converts the frame last decoded into 'context_frame' to packed RGB24,
+   * using the given scaler. Input data must be previously allocated and be of
+   * the right size for holding the frame contents.
+   *
+   * @return true if it manages to convert the frame or false otherwise.
+   */
+  bool scale_video_frame (const std::string& filename, int current_frame,
+      boost::shared_ptr<AVCodecContext> codec_context,
+      boost::shared_ptr<SwsContext> swscaler,
+      boost::shared_ptr<AVFrame> context_frame, uint8_t* data,
+      bool throw_on_error);
+
+  /**
+   * Seeks the video stream to the last keyframe at or before the given
+   * timestamp (in the stream time base) and drops any frames buffered in the
+   * decoder. Frames decoded after this call may still come before the
+   * requested timestamp: the caller should check the timestamps of decoded
+   * frames.
+   *
+   * @return true if the seek succeeded or false otherwise, in which case the
+   * position in the stream is undefined.
+   */
+  bool seek_video_stream (int stream_index,
+      boost::shared_ptr<AVFormatContext> format_context,
+      boost::shared_ptr<AVCodecContext> codec_context, int64_t timestamp);
+
   /************************************************************************
    * Video writing specific utilities
    ************************************************************************/
@@ -246,11 +390,34 @@ namespace bob { namespace io { namespace video {
       boost::shared_ptr<AVFormatContext> fmtctxt, AVCodec* codec);
 
   /**
-   * Opens the output file using the given context, writes a header, if the
-   * format requires.
+   * Makes the format context write to the given stream, through a custom
+   * AVIOContext, instead of opening the output file. Streams that cannot
+   * seek are flagged as such to the muxer. Returns the I/O context, which
+   * keeps the stream alive and must outlive the format context.
+   *
+   * @note The returned object knows how to correctly delete itself, freeing
+   * all acquired resources.
+   */
+  boost::shared_ptr<AVIOContext> make_output_io_context(
+      const std::string& filename,
+      boost::shared_ptr<AVFormatContext> format_context,
+      boost::shared_ptr<OutputStream> stream);
+
+  /**
+   * Opens the output file using the given context (unless it writes to a
+   * stream, see make_output_io_context()), writes a header, if the format
+   * requires. If 'options' is given, they are set on the muxer (e.g.
+   * "movflags" for MP4): on return, it only keeps the ones the muxer did not
+   * use.
    */
   void open_output_file(const std::string& filename,
-      boost::shared_ptr<AVFormatContext> format_context);
+      boost::shared_ptr<AVFormatContext> format_context, Options* options=0);
+
+  /**
+   * Returns the names of the given options, quoted and separated by commas,
+   * for error messages
+   */
+  std::string option_names(const Options& options);
 
   /**
    * Closes the output file using the given context, writes a trailer, if the
@@ -284,6 +451,65 @@ namespace bob { namespace io { namespace video {
     boost::shared_ptr<AVFrame> tmp_frame,
     boost::shared_ptr<SwsContext> swscaler);
 
+  /**
+   * Encodes the picture already filled in 'context_frame' into the encoder
+   * stream. The same notes as for write_video_frame() apply.
+   */
+  void encode_context_frame(const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVStream> stream,
+    boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<AVFrame> context_frame);
+
+  /**
+   * Writes a frame of packed 8-bit RGB data (height, width, color-bands),
+   * whose rows are 'linesize' bytes apart, into the encoder stream. The data
+   * is fed as is to the scaler, which must convert from AV_PIX_FMT_RGB24.
+   * The same notes as for write_video_frame() apply.
+   */
+  void write_packed_video_frame (const uint8_t* data, int linesize,
+    const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVStream> stream,
+    boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<AVFrame> context_frame,
+    boost::shared_ptr<SwsContext> swscaler);
+
+  /**
+   * Writes a picture given as planes (e.g. the Y, U and V planes of a
+   * yuv420p picture, or a single grayscale plane), whose rows are
+   * 'linesizes' bytes apart, into the encoder stream, converted by the
+   * scaler. The same notes as for write_video_frame() apply.
+   */
+  void write_video_planes (const uint8_t* const* planes, const int* linesizes,
+    const std::string& filename,
+    boost::shared_ptr<AVFormatContext> format_context,
+    boost::shared_ptr<AVStream> stream,
+    boost::shared_ptr<AVCodecContext> codec_context,
+    boost::shared_ptr<AVFrame> context_frame,
+    boost::shared_ptr<SwsContext> swscaler);
+
+  /**
+   * Tells if packets of a stream with the given parameters and packets
+   * produced by the given (opened) encoder can follow each other in a file
+   * of the given format: the codec, frame size and pixel format must be the
+   * same, the encoder may not need other global codec headers (for formats
+   * that store them) and neither side may reorder frames.
+   */
+  bool can_concatenate(const AVCodecParameters* params,
+    const AVCodecContext* encoder, const AVOutputFormat* oformat);
+
+  /**
+   * Copies the packets of the video stream 'stream_index' of the input to
+   * the output 'stream' without decoding them, shifting their timestamps so
+   * the first frame is presented at zero and rescaling them to the output
+   * stream time base. Returns the number of packets copied and sets
+   * 'next_pts' to the end of the last one, in the output stream time base.
+   */
+  size_t copy_video_packets(const std::string& filename,
+    boost::shared_ptr<AVFormatContext> input, int stream_index,
+    boost::shared_ptr<AVFormatContext> output,
+    boost::shared_ptr<AVStream> stream, int64_t& next_pts);
 
 }}}
 
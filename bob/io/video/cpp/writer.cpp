@@ -1,12 +1,95 @@
 #include "writer.h"
 
+#include <cstring>
+#include <algorithm>
 #include <boost/format.hpp>
 #include <boost/preprocessor.hpp>
 
+extern "C" {
+#include <libavutil/opt.h>
+}
+
 namespace bob { namespace io { namespace video {
 
+  /**
+   * Adds flags to the "movflags" muxer option, keeping those already set
+   */
+  static void add_movflags(Options& options, const std::string& flags) {
+    Options::iterator it = options.find("movflags");
+    if (it == options.end()) options["movflags"] = flags;
+    else if (!it->second.empty() && (it->second[0] == '+' ||
+          it->second[0] == '-')) it->second = flags + it->second;
+    else it->second = flags + "+" + it->second;
+  }
+
+  /**
+   * Size of the buffer for the names of segments, as the segment muxer uses
+   */
+  static const size_t SEGMENT_NAME_SIZE = 1024;
+
+  /**
+   * Returns the format of the segments of a video, as the segment muxer
+   * guesses it: the one given or the one of the extension of 'pattern'
+   */
+  static const AVOutputFormat* segment_format(const std::string& pattern,
+      const std::string& format) {
+    const AVOutputFormat* retval = av_guess_format(
+        format.empty()? 0 : format.c_str(), pattern.c_str(), 0);
+    if (!retval) {
+      boost::format m("bob::io::video::av_guess_format(format=`%s', filename=`%s') failed: cannot find the format of the segments of the video");
+      m % format % pattern;
+      throw std::runtime_error(m.str());
+    }
+    return retval;
+  }
+
+  /**
+   * Returns the codec to encode the segments of a video with: the one given,
+   * or the default codec of their format (the segment muxer has none)
+   */
+  static std::string segment_codec(const std::string& pattern,
+      const std::string& format, const std::string& codec) {
+    if (!codec.empty()) return codec;
+    const AVOutputFormat* oformat = segment_format(pattern, format);
+    if (oformat->video_codec == AV_CODEC_ID_NONE) return codec;
+    return avcodec_get_name(oformat->video_codec);
+  }
+
+  Writer::Writer(
+      const std::string& filename,
+      size_t height,
+      size_t width,
+      double framerate,
+      double bitrate,
+      size_t gop,
+      const std::string& codec,
+      const std::string& format,
+      bool check,
+      const WriterSettings& settings) :
+    Writer(filename, boost::shared_ptr<OutputStream>(), height, width,
+      framerate, bitrate, gop, codec, format, check, settings)
+  {
+  }
+
+  Writer::Writer(
+      boost::shared_ptr<OutputStream> stream,
+      size_t height,
+      size_t width,
+      double framerate,
+      double bitrate,
+      size_t gop,
+      const std::string& codec,
+      const std::string& format,
+      bool check,
+      const WriterSettings& settings) :
+    Writer(stream->name(), stream, height, width, framerate, bitrate, gop,
+      codec, format, check, settings)
+  {
+  }
+
   Writer::Writer(
       const std::string& filename,
+      boost::shared_ptr<OutputStream> output,
       size_t height,
       size_t width,
       double framerate,
@@ -14,31 +97,87 @@ namespace bob { namespace io { namespace video {
       size_t gop,
       const std::string& codec,
       const std::string& format,
-      bool check) :
+      bool check,
+      const WriterSettings& settings) :
     m_filename(filename),
     m_opened(false),
-    m_format_context(make_output_format_context(filename, format)),
-    m_codec(find_encoder(filename, m_format_context, codec)),
+    m_output(output),
+    m_unused_options(settings.options),
+    m_format_context(make_output_format_context(filename,
+          (settings.segment_frames || settings.segment_seconds > 0.)?
+          "segment" : format)),
+    m_codec(find_encoder(filename, m_format_context,
+          (settings.segment_frames || settings.segment_seconds > 0.)?
+          segment_codec(filename, format, codec) : codec)),
     m_stream(make_stream(filename, m_format_context, m_codec)),
     m_codec_context(make_encoder_context(filename, m_format_context.get(),
-          m_stream.get(), m_codec, height, width, framerate, bitrate, gop)),
+          m_stream.get(), m_codec, height, width, framerate, bitrate, gop,
+          settings.matrix, settings.full_range, settings.threads,
+          settings.thread_type, settings.slices, &m_unused_options)),
     m_context_frame(make_frame(filename, m_codec_context)),
-    m_swscaler(make_scaler(filename, m_codec_context, AV_PIX_FMT_GBRP,
+    m_swscaler(make_scaler(filename, m_codec_context,
+          (settings.layout == PACKED)? AV_PIX_FMT_RGB24 : AV_PIX_FMT_GBRP,
           m_codec_context->pix_fmt)),
+    m_plane_scaler_format(RGB_FRAME),
     m_height(height),
     m_width(width),
     m_framerate(framerate),
     m_bitrate(bitrate),
     m_gop(gop),
+    m_layout(settings.layout),
+    m_matrix(settings.matrix),
+    m_full_range(m_codec_context->color_range == AVCOL_RANGE_JPEG ||
+        m_codec_context->pix_fmt == AV_PIX_FMT_YUVJ420P),
+    m_thread_type(settings.thread_type),
+    m_output_mode(settings.output_mode),
+    m_segment_length(settings.segment_frames? settings.segment_frames :
+        std::max(settings.segment_seconds*framerate, 0.)),
+    m_encoded(0),
+    m_native_yuv(false),
     m_codecname(codec),
     m_formatname(format),
-    m_current_frame(0)
+    m_current_frame(0),
+    m_queue_size(0),
+    m_stopping(false),
+    m_default_io_open(0)
     {
+      //segments are written by FFmpeg's segment muxer, with a format of their own
+      const AVOutputFormat* oformat = m_format_context->oformat;
+      if (segmented()) {
+        if (m_output) {
+          boost::format m("bob::io::video::Writer(stream=`%s') failed: videos written to streams cannot be split in segments");
+          m % filename;
+          throw std::runtime_error(m.str());
+        }
+        if (settings.segment_frames && settings.segment_seconds > 0.) {
+          boost::format m("bob::io::video::Writer(filename=`%s') failed: segments may be given in frames (%d) or in seconds (%g), but not both");
+          m % filename % settings.segment_frames % settings.segment_seconds;
+          throw std::runtime_error(m.str());
+        }
+        if (m_segment_length < 1.) {
+          boost::format m("bob::io::video::Writer(filename=`%s') failed: segments of %g seconds are shorter than a frame at %g frames per second");
+          m % filename % settings.segment_seconds % framerate;
+          throw std::runtime_error(m.str());
+        }
+        if (m_output_mode != DEFAULT_OUTPUT) {
+          boost::format m("bob::io::video::Writer(filename=`%s') failed: segmented videos can only be written with the default output mode");
+          m % filename;
+          throw std::runtime_error(m.str());
+        }
+        char name[SEGMENT_NAME_SIZE];
+        if (av_get_frame_filename(name, sizeof(name), filename.c_str(), 0) < 0) {
+          boost::format m("bob::io::video::Writer(filename=`%s') failed: segmented videos need a filename pattern with the number of each segment, as in printf() (e.g. `video-%%03d.mp4')");
+          m % filename;
+          throw std::runtime_error(m.str());
+        }
+        oformat = segment_format(filename, format);
+      }
+
       //runs a codec/format check if the user asked so
       if (check) {
-        if (!oformat_is_supported(formatName())) {
+        if (!oformat_is_supported(oformat->name)) {
           boost::format s("The detected format (`%s' = `%s') of the output video file `%s' is not currently supported by this version of Bob. Choose one of the supported formats or disable the `check' flag on the video::Writer object (if you are sure of what you are doing).");
-          s % formatName() % formatLongName() % filename;
+          s % oformat->name % oformat->long_name % filename;
           throw std::runtime_error(s.str());
         }
         if (!codec_is_supported(codecName())) {
@@ -46,23 +185,92 @@ namespace bob { namespace io { namespace video {
           s % codecName() % codecLongName() % filename;
           throw std::runtime_error(s.str());
         }
-        if (!oformat_supports_codec(formatName(), codecName())) {
+        if (!oformat_supports_codec(oformat->name, codecName())) {
           boost::format s("The detected pair of format (%s) and codec (%s) chosen for video file `%s' is not currently supported by this version of Bob. Choose a supported combination of formats and codecs or disable the `check' flag on the video::Writer object (if you are sure of what you are doing).");
-          s % formatName() % codecName() % filename;
+          s % oformat->name % codecName() % filename;
           throw std::runtime_error(s.str());
         }
       }
 
-      open_output_file(m_filename, m_format_context);
+      //the scaler converts as our own kernels would
+      set_scaler_colorspace(m_swscaler, m_matrix, m_full_range);
+
+      //MP4 and QuickTime muxers are the ones taking "movflags"
+      bool has_movflags = m_format_context->priv_data &&
+        av_opt_find(m_format_context->priv_data, "movflags", 0, 0, 0);
+
+      if (m_output) {
+        m_io_context = make_output_io_context(m_filename, m_format_context,
+            m_output);
+        //MP4 files can only be written in one go as fragments
+        if (m_output_mode == DEFAULT_OUTPUT && !m_output->seekable() &&
+            has_movflags && !m_unused_options.count("movflags"))
+          m_output_mode = FRAGMENTED_OUTPUT;
+      }
+
+      if (m_output_mode != DEFAULT_OUTPUT) {
+        if (!has_movflags) {
+          boost::format s("Fragmented and faststart output is only available for MP4 and QuickTime files, but video file `%s' is written with the `%s' format");
+          s % filename % formatName();
+          throw std::runtime_error(s.str());
+        }
+        if (m_output_mode == FRAGMENTED_OUTPUT) {
+          add_movflags(m_unused_options, "frag_keyframe+empty_moov");
+          //each fragment reaches the output as soon as it is complete
+          m_format_context->flush_packets = 1;
+        }
+        else {
+          if (m_output) {
+            boost::format s("Faststart output needs FFmpeg to read the file back when closing it, so video `%s' can only be written to a file, not to a stream");
+            s % filename;
+            throw std::runtime_error(s.str());
+          }
+          add_movflags(m_unused_options, "faststart");
+        }
+      }
+
+      if (segmented()) {
+        //the muxer starts a file with the first keyframe at most half a
+        //frame before the end of the previous one: keyframes are forced
+        //there (see next_picture())
+        m_unused_options["segment_format"] = oformat->name;
+        m_unused_options["segment_time"] =
+          (boost::format("%.6f") % (m_segment_length/framerate)).str();
+        m_unused_options["segment_time_delta"] =
+          (boost::format("%.6f") % (0.5/framerate)).str();
+        m_unused_options["reset_timestamps"] = "1";
+
+        //the muxer opens the file of a segment, through the callback of its
+        //context, after closing the previous one
+        m_format_context->opaque = this;
+        m_default_io_open = m_format_context->io_open;
+        m_format_context->io_open = &Writer::open_segment;
+      }
+
+      open_output_file(m_filename, m_format_context, &m_unused_options);
+      if (!m_unused_options.empty()) {
+        if (!m_output) avio_closep(&m_format_context->pb);
+        boost::format s("The options %s given for video file `%s' are not known to the encoder (`%s') or the muxer (`%s')");
+        s % option_names(m_unused_options) % filename % codecName()
+          % formatName();
+        throw std::runtime_error(s.str());
+      }
 
       //sets up the io layer typeinfo
       m_typeinfo_video.dtype = m_typeinfo_frame.dtype = bob::io::base::array::t_uint8;
       m_typeinfo_video.nd = 4;
       m_typeinfo_frame.nd = 4;
       m_typeinfo_video.shape[0] = 0;
-      m_typeinfo_video.shape[1] = m_typeinfo_frame.shape[0] = 3;
-      m_typeinfo_video.shape[2] = m_typeinfo_frame.shape[1] = height;
-      m_typeinfo_video.shape[3] = m_typeinfo_frame.shape[2] = width;
+      if (m_layout == PACKED) {
+        m_typeinfo_video.shape[1] = m_typeinfo_frame.shape[0] = height;
+        m_typeinfo_video.shape[2] = m_typeinfo_frame.shape[1] = width;
+        m_typeinfo_video.shape[3] = m_typeinfo_frame.shape[2] = 3;
+      }
+      else {
+        m_typeinfo_video.shape[1] = m_typeinfo_frame.shape[0] = 3;
+        m_typeinfo_video.shape[2] = m_typeinfo_frame.shape[1] = height;
+        m_typeinfo_video.shape[3] = m_typeinfo_frame.shape[2] = width;
+      }
       m_typeinfo_frame.update_strides();
       m_typeinfo_video.update_strides();
 
@@ -75,25 +283,43 @@ namespace bob { namespace io { namespace video {
     }
 
   Writer::~Writer() {
-    close();
+    try {
+      close();
+    }
+    catch (std::exception&) {
+      //only close() can report errors
+    }
   }
 
   void Writer::close() {
 
     if (!m_opened) return;
 
-    flush_encoder(m_filename, m_format_context, m_stream, m_codec_context);
-    close_output_file(m_filename, m_format_context);
+    stop_worker();
+    std::exception_ptr error = m_error;
+    m_error = std::exception_ptr();
+
+    try {
+      flush_encoder(m_filename, m_format_context, m_stream, m_codec_context);
+      close_output_file(m_filename, m_format_context);
+    }
+    catch (std::exception&) {
+      if (!error) throw; ///< otherwise, the first error is reported
+    }
 
     /* Destroyes resources in an orderly fashion */
     m_codec_context.reset();
     m_context_frame.reset();
     m_rgb24_frame.reset();
     m_swscaler.reset();
+    m_plane_scaler.reset();
     m_stream.reset();
     m_format_context.reset();
+    m_io_context.reset();
 
     m_opened = false; ///< file is now considered closed
+
+    if (error) std::rethrow_exception(error);
   }
 
   std::string Writer::info() const {
@@ -119,60 +345,193 @@ namespace bob { namespace io { namespace video {
     return info.str();
   }
 
-  void Writer::append(const blitz::Array<uint8_t,4>& data) {
+  bool Writer::native_yuv() const {
+    return m_native_yuv && m_layout == PLANAR &&
+      (m_codec_context->pix_fmt == AV_PIX_FMT_YUV420P ||
+       m_codec_context->pix_fmt == AV_PIX_FMT_YUVJ420P);
+  }
+
+  std::vector<std::string> Writer::segments() const {
+    std::vector<std::string> retval;
+    if (!segmented()) {
+      retval.push_back(m_filename);
+      return retval;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_segments;
+  }
+
+  int Writer::open_segment(AVFormatContext* s, AVIOContext** pb,
+      const char* url, int flags, AVDictionary** options) {
+    Writer* self = static_cast<Writer*>(s->opaque);
+    int ok = self->m_default_io_open(s, pb, url, flags, options);
+    if (ok < 0) return ok;
+
+    //other files (e.g. a segment list) may be opened, if asked for
+    char name[SEGMENT_NAME_SIZE];
+    std::lock_guard<std::mutex> lock(self->m_mutex);
+    av_get_frame_filename(name, sizeof(name), self->m_filename.c_str(),
+        self->m_segments.size());
+    if (!std::strcmp(name, url)) self->m_segments.push_back(url);
+    return ok;
+  }
+
+  size_t Writer::segment_of(size_t frame) const {
+    //as the segment muxer, which starts segments half a frame early
+    return static_cast<size_t>((frame + 0.5) / m_segment_length);
+  }
+
+  void Writer::next_picture() {
+    if (segmented()) {
+      bool first = m_encoded && segment_of(m_encoded) != segment_of(m_encoded-1);
+      m_context_frame->pict_type = first? AV_PICTURE_TYPE_I :
+        AV_PICTURE_TYPE_NONE;
+    }
+    ++m_encoded;
+  }
+
+  void Writer::set_queue_size(size_t frames) {
+    if (frames == m_queue_size) return;
+
+    stop_worker();
+    m_queue_size = frames;
+    m_spare.clear();
+    if (m_error) std::rethrow_exception(m_error);
+
+    if (m_queue_size && m_opened) m_worker = std::thread(&Writer::work, this);
+  }
+
+  void Writer::stop_worker() {
+    if (!m_worker.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stopping = true;
+    }
+    m_queued.notify_all();
+    m_worker.join();
+    m_stopping = false;
+  }
+
+  void Writer::work() {
+    const size_t* shape = m_typeinfo_frame.shape;
+    blitz::TinyVector<int,3> extent;
+    extent = shape[0], shape[1], shape[2];
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+      m_queued.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+      if (m_queue.empty()) return; ///< stopping, and all frames written
+
+      FrameFormat format = m_queue.front().format;
+      std::vector<uint8_t> buffer;
+      buffer.swap(m_queue.front().data);
+      m_queue.pop_front();
+      lock.unlock();
+      m_dequeued.notify_all();
+
+      std::exception_ptr error;
+      try {
+        if (format == RGB_FRAME) {
+          encode(blitz::Array<uint8_t,3>(buffer.data(), extent,
+                blitz::neverDeleteData));
+        }
+        else { //contiguous planes, see write_planes()
+          const uint8_t* planes[] = {buffer.data(),
+            buffer.data() + m_height*m_width,
+            buffer.data() + m_height*m_width + (m_height/2)*(m_width/2)};
+          int linesizes[] = {(int)m_width, (int)m_width/2, (int)m_width/2};
+          encode_planes(format, planes, linesizes);
+        }
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+
+      lock.lock();
+      m_spare.push_back(std::vector<uint8_t>());
+      m_spare.back().swap(buffer);
+      if (error) {
+        //the frames still queued are dropped
+        m_error = error;
+        m_queue.clear();
+        m_dequeued.notify_all();
+        return;
+      }
+    }
+  }
+
+  void Writer::check_opened() const {
     if (!m_opened) {
       boost::format m("video writer for file `%s' is closed and cannot be written to");
       m % m_filename;
       throw std::runtime_error(m.str());
     }
+  }
+
+  std::vector<uint8_t> Writer::take_buffer() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_dequeued.wait(lock, [this]() {
+        return m_error || m_queue.size() < m_queue_size;
+        });
+    if (m_error) std::rethrow_exception(m_error);
+
+    std::vector<uint8_t> retval;
+    if (!m_spare.empty()) {
+      retval.swap(m_spare.back());
+      m_spare.pop_back();
+    }
+    return retval;
+  }
+
+  void Writer::queue(FrameFormat format, std::vector<uint8_t>& data) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue.push_back(QueuedFrame());
+      m_queue.back().format = format;
+      m_queue.back().data.swap(data);
+    }
+    m_queued.notify_one();
+  }
+
+  void Writer::append(const blitz::Array<uint8_t,4>& data) {
+    check_opened();
 
     //checks data specifications
-    if (data.extent(1) != 3 || (size_t)data.extent(2) != m_height ||
-        (size_t)data.extent(3) != m_width) {
-      boost::format m("input data extents for each frame (the last 3 dimensions of your 4D input array = %dx%dx%d) do not conform to expected format (3x%dx%d), while writing data to file `%s'");
+    const size_t* shape = m_typeinfo_frame.shape;
+    if ((size_t)data.extent(1) != shape[0] ||
+        (size_t)data.extent(2) != shape[1] ||
+        (size_t)data.extent(3) != shape[2]) {
+      boost::format m("input data extents for each frame (the last 3 dimensions of your 4D input array = %dx%dx%d) do not conform to expected format (%dx%dx%d), while writing data to file `%s'");
       m % data.extent(1) % data.extent(2) % data.extent(3)
-        % m_height % m_width % m_filename;
+        % shape[0] % shape[1] % shape[2] % m_filename;
       throw std::runtime_error(m.str());
     }
 
     blitz::Range a = blitz::Range::all();
     for(int i=data.lbound(0); i<(data.extent(0)+data.lbound(0)); ++i) {
-      write_video_frame(data(i, a, a, a), m_filename, m_format_context,
-          m_stream, m_codec_context, m_context_frame, m_rgb24_frame,
-          m_swscaler);
-      ++m_current_frame;
-      m_typeinfo_video.shape[0] += 1;
+      write(data(i, a, a, a));
     }
   }
 
   void Writer::append(const blitz::Array<uint8_t,3>& data) {
-    if (!m_opened) {
-      boost::format m("video writer for file `%s' is closed and cannot be written to");
-      m % m_filename;
-      throw std::runtime_error(m.str());
-    }
+    check_opened();
 
     //checks data specifications
-    if (data.extent(0) != 3 || (size_t)data.extent(1) != m_height ||
-        (size_t)data.extent(2) != m_width) {
-      boost::format m("input data extents (%dx%dx%d) do not conform to expected format (3x%dx%d), while writing data to file `%s'");
+    const size_t* shape = m_typeinfo_frame.shape;
+    if ((size_t)data.extent(0) != shape[0] ||
+        (size_t)data.extent(1) != shape[1] ||
+        (size_t)data.extent(2) != shape[2]) {
+      boost::format m("input data extents (%dx%dx%d) do not conform to expected format (%dx%dx%d), while writing data to file `%s'");
       m % data.extent(0) % data.extent(1) % data.extent(2)
-        % m_height % m_width % m_filename;
+        % shape[0] % shape[1] % shape[2] % m_filename;
       throw std::runtime_error(m.str());
     }
 
-    write_video_frame(data, m_filename, m_format_context,
-        m_stream, m_codec_context, m_context_frame, m_rgb24_frame, m_swscaler);
-    ++m_current_frame;
-    m_typeinfo_video.shape[0] += 1;
+    write(data);
   }
 
   void Writer::append(const bob::io::base::array::interface& data) {
-    if (!m_opened) {
-      boost::format m("video writer for file `%s' is closed and cannot be written to");
-      m % m_filename;
-      throw std::runtime_error(m.str());
-    }
+    check_opened();
 
     const bob::io::base::array::typeinfo& type = data.type();
 
@@ -183,49 +542,41 @@ namespace bob { namespace io { namespace video {
       throw std::runtime_error(m.str());
     }
 
+    const size_t* expected = m_typeinfo_frame.shape;
+    blitz::TinyVector<int,3> shape;
+    shape = expected[0], expected[1], expected[2];
+
     if ( type.nd == 3 ) { //appends single frame
-      if ( (type.shape[0] != 3) ||
-          (type.shape[1] != m_height) ||
-          (type.shape[2] != m_width) ) {
-        boost::format m("input data extents (%dx%dx%d) do not conform to expected format (3x%dx%d), while writing data to file `%s'");
+      if ( (type.shape[0] != expected[0]) ||
+          (type.shape[1] != expected[1]) ||
+          (type.shape[2] != expected[2]) ) {
+        boost::format m("input data extents (%dx%dx%d) do not conform to expected format (%dx%dx%d), while writing data to file `%s'");
         m % type.shape[0] % type.shape[1] % type.shape[2]
-          % m_height % m_width % m_filename;
+          % expected[0] % expected[1] % expected[2] % m_filename;
         throw std::runtime_error(m.str());
       }
 
-      blitz::TinyVector<int,3> shape;
-      shape = 3, m_height, m_width;
       blitz::Array<uint8_t,3> tmp(const_cast<uint8_t*>(static_cast<const uint8_t*>(data.ptr())), shape,
           blitz::neverDeleteData);
-      write_video_frame(tmp, m_filename, m_format_context,
-          m_stream, m_codec_context, m_context_frame, m_rgb24_frame,
-          m_swscaler);
-      ++m_current_frame;
-      m_typeinfo_video.shape[0] += 1;
+      write(tmp);
     }
 
     else if ( type.nd == 4 ) { //appends a sequence of frames
-      if ( (type.shape[1] != 3) ||
-          (type.shape[2] != m_height) ||
-          (type.shape[3] != m_width) ) {
-        boost::format m("input data extents for each frame (the last 3 dimensions of your 4D input array = %dx%dx%d) do not conform to expected format (3x%dx%d), while writing data to file `%s'");
+      if ( (type.shape[1] != expected[0]) ||
+          (type.shape[2] != expected[1]) ||
+          (type.shape[3] != expected[2]) ) {
+        boost::format m("input data extents for each frame (the last 3 dimensions of your 4D input array = %dx%dx%d) do not conform to expected format (%dx%dx%d), while writing data to file `%s'");
         m % type.shape[1] % type.shape[2] % type.shape[3]
-          % m_height % m_width % m_filename;
+          % expected[0] % expected[1] % expected[2] % m_filename;
         throw std::runtime_error(m.str());
       }
 
-      blitz::TinyVector<int,3> shape;
-      shape = 3, m_height, m_width;
       unsigned long int frame_size = 3 * m_height * m_width;
       uint8_t* ptr = const_cast<uint8_t*>(static_cast<const uint8_t*>(data.ptr()));
 
       for(size_t i=0; i<type.shape[0]; ++i) {
         blitz::Array<uint8_t,3> tmp(ptr, shape, blitz::neverDeleteData);
-        write_video_frame(tmp, m_filename, m_format_context,
-            m_stream, m_codec_context, m_context_frame, m_rgb24_frame,
-            m_swscaler);
-        ++m_current_frame;
-        m_typeinfo_video.shape[0] += 1;
+        write(tmp);
         ptr += frame_size;
       }
     }
@@ -239,4 +590,206 @@ namespace bob { namespace io { namespace video {
 
   }
 
+  /**
+   * Raises if a plane given to append() does not have the expected extents.
+   * Returns the plane itself if the pixels of its rows are contiguous, or a
+   * copy of it otherwise.
+   */
+  static blitz::Array<uint8_t,2> check_plane(const std::string& filename,
+      const char* name, const blitz::Array<uint8_t,2>& plane, size_t height,
+      size_t width) {
+    if ((size_t)plane.extent(0) != height || (size_t)plane.extent(1) != width) {
+      boost::format m("bob::io::video::Writer::append(filename=`%s') failed: the %s plane should have %dx%d pixels, but yours has %dx%d");
+      m % filename % name % height % width % plane.extent(0) % plane.extent(1);
+      throw std::runtime_error(m.str());
+    }
+    if (plane.stride(1) == 1 && plane.stride(0) >= (int)width) return plane;
+    blitz::Array<uint8_t,2> retval(plane.shape());
+    retval = plane;
+    return retval;
+  }
+
+  void Writer::append(const blitz::Array<uint8_t,2>& luma) {
+    check_opened();
+    blitz::Array<uint8_t,2> l = check_plane(m_filename, "luma", luma,
+        m_height, m_width);
+
+    const uint8_t* planes[] = {l.data()};
+    int linesizes[] = {l.stride(0)};
+    write_planes(GRAY_FRAME, planes, linesizes);
+  }
+
+  void Writer::append(const blitz::Array<uint8_t,2>& y,
+      const blitz::Array<uint8_t,2>& u, const blitz::Array<uint8_t,2>& v) {
+    check_opened();
+    blitz::Array<uint8_t,2> y_ = check_plane(m_filename, "Y", y, m_height,
+        m_width);
+    blitz::Array<uint8_t,2> u_ = check_plane(m_filename, "U", u, m_height/2,
+        m_width/2);
+    blitz::Array<uint8_t,2> v_ = check_plane(m_filename, "V", v, m_height/2,
+        m_width/2);
+
+    const uint8_t* planes[] = {y_.data(), u_.data(), v_.data()};
+    int linesizes[] = {y_.stride(0), u_.stride(0), v_.stride(0)};
+    write_planes(YUV420P_FRAME, planes, linesizes);
+  }
+
+  bool Writer::remux(const std::string& source) {
+    check_opened();
+
+    if (m_current_frame) {
+      boost::format m("bob::io::video::Writer::remux(filename=`%s', source=`%s') failed: packets can only be copied before frames are appended, but %d frames were already written");
+      m % m_filename % source % m_current_frame;
+      throw std::runtime_error(m.str());
+    }
+
+    boost::shared_ptr<AVFormatContext> input =
+      make_input_format_context(source);
+    int stream_index = find_video_stream(source, input);
+    const AVCodecParameters* params = input->streams[stream_index]->codecpar;
+
+    //the frames we encode must be decodable by the same decoder, without
+    //new global headers, and follow the copied ones in decoding order
+    if (!can_concatenate(params, m_codec_context.get(),
+          m_format_context->oformat)) return false;
+
+    int64_t next_pts = 0;
+    size_t frames = copy_video_packets(source, input, stream_index,
+        m_format_context, m_stream, next_pts);
+
+    m_context_frame->pts = next_pts;
+    m_encoded += frames;
+    m_current_frame += frames;
+    m_typeinfo_video.shape[0] += frames;
+    return true;
+  }
+
+  void Writer::write(const blitz::Array<uint8_t,3>& frame) {
+
+    if (m_queue_size) {
+      //copies the frame as a contiguous array, whatever its strides
+      std::vector<uint8_t> buffer = take_buffer();
+      buffer.resize(frame.size());
+      blitz::Array<uint8_t,3> copy(buffer.data(), frame.shape(),
+          blitz::neverDeleteData);
+      copy = frame;
+      queue(RGB_FRAME, buffer);
+    }
+    else encode(frame);
+
+    ++m_current_frame;
+    m_typeinfo_video.shape[0] += 1;
+  }
+
+  void Writer::encode(const blitz::Array<uint8_t,3>& frame) {
+
+    //rows are passed as they are: only the pixels of each row must be
+    //contiguous, otherwise the frame is copied first
+    bool rows = (m_layout == PACKED)?
+      frame.stride(2) == 1 && frame.stride(1) == 3 &&
+      frame.stride(0) >= 3*(int)m_width :
+      frame.stride(2) == 1 && frame.stride(1) >= (int)m_width;
+    if (!rows) {
+      m_frame_copy.resize(frame.shape());
+      m_frame_copy = frame;
+      encode(m_frame_copy);
+      return;
+    }
+
+    next_picture();
+
+    if (m_layout == PACKED) {
+      write_packed_video_frame(frame.data(), frame.stride(0), m_filename,
+          m_format_context, m_stream, m_codec_context, m_context_frame,
+          m_swscaler);
+    }
+    else if (native_yuv()) {
+      rgb_to_yuv420p(frame.data(), frame.stride(0), frame.stride(1),
+          m_height, m_width, m_matrix, m_full_range, m_context_frame->data,
+          m_context_frame->linesize);
+      encode_context_frame(m_filename, m_format_context, m_stream,
+          m_codec_context, m_context_frame);
+    }
+    else {
+      write_video_frame(frame, m_filename, m_format_context,
+          m_stream, m_codec_context, m_context_frame, m_rgb24_frame,
+          m_swscaler);
+    }
+  }
+
+  /**
+   * Copies 'rows' rows of 'width' bytes between planes
+   */
+  static void copy_plane(const uint8_t* src, int src_linesize, uint8_t* dst,
+      int dst_linesize, size_t rows, size_t width) {
+    for (size_t r=0; r<rows; ++r)
+      std::memcpy(dst + r*dst_linesize, src + r*src_linesize, width);
+  }
+
+  void Writer::write_planes(FrameFormat format, const uint8_t* const* planes,
+      const int* linesizes) {
+
+    if (m_queue_size) {
+      //copies the planes one after the other, without gaps between rows
+      size_t chroma = (m_height/2)*(m_width/2);
+      std::vector<uint8_t> buffer = take_buffer();
+      buffer.resize(m_height*m_width + ((format == YUV420P_FRAME)? 2*chroma : 0));
+      copy_plane(planes[0], linesizes[0], buffer.data(), m_width, m_height,
+          m_width);
+      if (format == YUV420P_FRAME) {
+        uint8_t* u = buffer.data() + m_height*m_width;
+        copy_plane(planes[1], linesizes[1], u, m_width/2, m_height/2,
+            m_width/2);
+        copy_plane(planes[2], linesizes[2], u + chroma, m_width/2,
+            m_height/2, m_width/2);
+      }
+      queue(format, buffer);
+    }
+    else encode_planes(format, planes, linesizes);
+
+    ++m_current_frame;
+    m_typeinfo_video.shape[0] += 1;
+  }
+
+  void Writer::encode_planes(FrameFormat format,
+      const uint8_t* const* planes, const int* linesizes) {
+
+    next_picture();
+
+    AVPixelFormat target = m_codec_context->pix_fmt;
+
+    //the picture the encoder takes: planes are copied as they are
+    if (target == AV_PIX_FMT_YUV420P || target == AV_PIX_FMT_YUVJ420P) {
+      uint8_t* const* data = m_context_frame->data;
+      const int* linesize = m_context_frame->linesize;
+      copy_plane(planes[0], linesizes[0], data[0], linesize[0], m_height,
+          m_width);
+      if (format == YUV420P_FRAME) {
+        copy_plane(planes[1], linesizes[1], data[1], linesize[1], m_height/2,
+            m_width/2);
+        copy_plane(planes[2], linesizes[2], data[2], linesize[2], m_height/2,
+            m_width/2);
+      }
+      else { //neutral chroma
+        std::memset(data[1], 128, linesize[1]*(m_height/2));
+        std::memset(data[2], 128, linesize[2]*(m_height/2));
+      }
+      encode_context_frame(m_filename, m_format_context, m_stream,
+          m_codec_context, m_context_frame);
+      return;
+    }
+
+    //otherwise, the scaler converts them, in the range of the writer
+    if (!m_plane_scaler || m_plane_scaler_format != format) {
+      m_plane_scaler = make_scaler(m_filename, m_codec_context,
+          (format == GRAY_FRAME)? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_YUV420P,
+          target);
+      set_scaler_colorspace(m_plane_scaler, m_matrix, m_full_range,
+          m_full_range);
+      m_plane_scaler_format = format;
+    }
+    write_video_planes(planes, linesizes, m_filename, m_format_context,
+        m_stream, m_codec_context, m_context_frame, m_plane_scaler);
+  }
+
 }}}
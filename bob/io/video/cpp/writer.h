@@ -1,11 +1,113 @@
 #ifndef BOB_IO_VIDEO_WRITER_H
 #define BOB_IO_VIDEO_WRITER_H
 
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <condition_variable>
+
 #include <bob.io.base/array.h>
 #include "utils.h"
 
 namespace bob { namespace io { namespace video {
 
+  /**
+   * How a Writer converts and encodes frames and lays out its output,
+   * besides the size, rate and codec of the video. The defaults are the
+   * ones of the Writer constructors.
+   */
+  struct WriterSettings {
+
+    WriterSettings() :
+      layout(PLANAR),
+      matrix(BT601),
+      full_range(false),
+      threads(0),
+      thread_type(AUTO_THREADS),
+      slices(0),
+      output_mode(DEFAULT_OUTPUT),
+      segment_frames(0),
+      segment_seconds(0.)
+    {
+    }
+
+    /**
+     * The layout of the frames to append: PLANAR, as in (color-bands,
+     * height, width), or PACKED, as in (height, width, color-bands). Packed
+     * frames are fed to the scaler as they are, without reordering.
+     */
+    Layout layout;
+
+    /**
+     * The colour matrix used to convert frames into YUV pictures for the
+     * encoder, BT601 or BT709, also recorded in the stream
+     */
+    YUVMatrix matrix;
+
+    /**
+     * If set, YUV pictures are in full (JPEG) range, instead of the limited
+     * 16-235 range for luma. Encoders that only take full range pictures
+     * (e.g. MJPEG) always use it.
+     */
+    bool full_range;
+
+    /**
+     * The number of threads the encoder uses, or 0 to let it pick one per
+     * core
+     */
+    size_t threads;
+
+    /**
+     * How the encoder spreads its work over threads: several frames at
+     * once, several slices of each frame at once or the best method it
+     * supports. Encoders that do not support the method requested run on a
+     * single thread.
+     */
+    ThreadType thread_type;
+
+    /**
+     * The number of slices each frame is split in, or 0 to keep the encoder
+     * default. FFV1 only encodes slices in parallel and takes 4, 6, 9, 12,
+     * 16, 20, 24, 30... of them.
+     */
+    size_t slices;
+
+    /**
+     * Options for the encoder (e.g. "preset" and "crf" for libx264) and the
+     * muxer (e.g. "movflags" for MP4), by name. Options that neither uses,
+     * or values they reject, raise an exception.
+     */
+    Options options;
+
+    /**
+     * How MP4 and QuickTime files are laid out: with the index at the end,
+     * in fragments or with the index at the front. Other formats only take
+     * DEFAULT_OUTPUT.
+     */
+    OutputMode output_mode;
+
+    /**
+     * If set, the video is split in files of this many frames, as it is
+     * written: the filename is then a pattern with the number of each file,
+     * as in printf() (e.g. "video-%03d.mp4"). The same encoder is used for
+     * all files, and each file starts with a keyframe, forced at the
+     * boundary, and timestamps restarting at 0. Files are closed as soon as
+     * the next one starts, so they can be processed while the video is
+     * written.
+     */
+    size_t segment_frames;
+
+    /**
+     * The same as 'segment_frames', but with files of this many seconds
+     * (starting with the first frame at or after their start time). Only
+     * one of them may be set.
+     */
+    double segment_seconds;
+
+  };
+
   /**
    * Use objects of this class to create and write video files.
    */
@@ -19,7 +121,8 @@ namespace bob { namespace io { namespace video {
        * extension.
        *
        * @param filename The name of the file that will contain the video
-       * output. If it exists, it will be truncated.
+       * output. If it exists, it will be truncated. For segmented videos
+       * (see WriterSettings), a pattern with the number of each file.
        * @param height The height of the video
        * @param width The width of the video
        * @param framerate The number of frames per second
@@ -35,11 +138,30 @@ namespace bob { namespace io { namespace video {
        * and codec are known to work and have been tested, otherwise an
        * exception is raised. If you set 'check' to 'false', though, we will
        * ignore this check.
+       * @param settings How frames are converted and encoded, and how the
+       * output is laid out
        */
       Writer(const std::string& filename, size_t height, size_t width,
           double framerate=25., double bitrate=1500000., size_t gop=12,
           const std::string& codec="", const std::string& format="",
-          bool check=true);
+          bool check=true, const WriterSettings& settings=WriterSettings());
+
+      /**
+       * Creates a new video written to the given stream (e.g. a
+       * MemoryOutputStream) instead of a file. The output format should be
+       * given, unless the name of the stream is a filename with a known
+       * extension. For streams that cannot seek, MP4 and QuickTime files
+       * are written as with FRAGMENTED_OUTPUT, unless the output mode or the
+       * "movflags" option says otherwise. FASTSTART_OUTPUT is not available
+       * for streams, as FFmpeg reads the file back to move its index. The
+       * other parameters are the same as for files, but videos written to
+       * streams cannot be split in segments.
+       */
+      Writer(boost::shared_ptr<OutputStream> stream, size_t height,
+          size_t width,
+          double framerate=25., double bitrate=1500000., size_t gop=12,
+          const std::string& codec="", const std::string& format="",
+          bool check=true, const WriterSettings& settings=WriterSettings());
 
       /**
        * Destructor virtualization
@@ -53,7 +175,7 @@ namespace bob { namespace io { namespace video {
       void close();
 
       /**
-       * Access to the filename
+       * Access to the filename (or the name of the output stream)
        */
       inline const std::string& filename() const { return m_filename; }
 
@@ -82,6 +204,95 @@ namespace bob { namespace io { namespace video {
        */
       inline size_t gop() const { return m_gop; }
 
+      /**
+       * Returns the layout of the frames to append
+       */
+      inline Layout layout() const { return m_layout; }
+
+      /**
+       * Returns the colour matrix of the encoded YUV pictures
+       */
+      inline YUVMatrix matrix() const { return m_matrix; }
+
+      /**
+       * Tells if the encoded YUV pictures are in full range
+       */
+      inline bool full_range() const { return m_full_range; }
+
+      /**
+       * Returns the number of threads the encoder runs on, as set up by
+       * FFmpeg: 1 if it does not support the threading method requested, 0
+       * for encoders that manage their threads themselves (e.g. libx264)
+       * and were left to pick their number.
+       */
+      inline size_t threads() const { return m_codec_context->thread_count; }
+
+      /**
+       * Returns the threading method requested for the encoder
+       */
+      inline ThreadType thread_type() const { return m_thread_type; }
+
+      /**
+       * Returns the number of slices each frame is split in, or 0 for the
+       * encoder default
+       */
+      inline size_t slices() const { return m_codec_context->slices; }
+
+      /**
+       * Returns how MP4 and QuickTime files are laid out (always
+       * DEFAULT_OUTPUT for other formats)
+       */
+      inline OutputMode output_mode() const { return m_output_mode; }
+
+      /**
+       * Tells if the video is split in several files
+       */
+      inline bool segmented() const { return m_segment_length > 0.; }
+
+      /**
+       * Returns the names of the files the muxer has opened so far for a
+       * segmented video: all but the last one are closed and complete, and
+       * the last one is being written. Frames still queued for the
+       * background thread (see set_queue_size()) or delayed by the encoder
+       * may go to files not listed yet. For videos that are not segmented,
+       * returns the name of the file (or stream).
+       */
+      std::vector<std::string> segments() const;
+
+      /**
+       * Sets if frames may be converted by our own SIMD kernels (see
+       * rgb_to_yuv420p()) instead of the software scaler. They are used for
+       * PLANAR frames when the encoder takes yuv420p or yuvj420p pictures:
+       * other formats always go through the scaler. This is off by default,
+       * so existing outputs do not change (the kernels average chroma over
+       * 2x2 pixels, where the scaler filters it bicubically).
+       */
+      void set_native_yuv(bool native) { m_native_yuv = native; }
+
+      /**
+       * Tells if frames are converted by our own SIMD kernels
+       */
+      bool native_yuv() const;
+
+      /**
+       * Sets the number of frames append() may queue for a background
+       * thread, which converts, encodes and writes them, so append() returns
+       * without waiting for the encoder. Frames are copied into the queue:
+       * when it is full, append() waits for the oldest one to be taken.
+       * Errors of the background thread are raised by the following calls
+       * to append() and by close(). 0, the default, encodes frames on the
+       * calling thread. Changing the size first waits for the queued frames
+       * to be written. Other settings (e.g. set_native_yuv()) must not be
+       * changed while frames are queued.
+       */
+      void set_queue_size(size_t frames);
+
+      /**
+       * Returns the number of frames append() may queue for the background
+       * thread, or 0 if frames are encoded on the calling thread
+       */
+      inline size_t queue_size() const { return m_queue_size; }
+
       /**
        * Duration of the video stream, in seconds
        */
@@ -90,7 +301,8 @@ namespace bob { namespace io { namespace video {
       }
 
       /**
-       * Returns the current number of frames written
+       * Returns the current number of frames written (including the ones
+       * still queued for the background thread, see set_queue_size())
        */
       inline size_t numberOfFrames() const { return m_current_frame; }
 
@@ -135,32 +347,165 @@ namespace bob { namespace io { namespace video {
       /**
        * Writes a set of frames to the file. The frame set should be setup as a
        * blitz::Array<> with 4 dimensions organized in this way:
-       * (frame-number, RGB color-bands, height, width).
-       *
-       * \warning At present time we only support arrays that have C-style
-       * storages (if you pass reversed arrays or arrays with Fortran-style
-       * storage, the result is undefined).
+       * (frame-number, RGB color-bands, height, width), or (frame-number,
+       * height, width, RGB color-bands) for PACKED writers. Frames may have
+       * any strides, as for the single frame version.
        */
       void append(const blitz::Array<uint8_t,4>& data);
 
       /**
        * Writes a new frame to the file. The frame should be setup as a
        * blitz::Array<> with 3 dimensions organized in this way (RGB
-       * color-bands, height, width).
-       *
-       * \warning At present time we only support arrays that have C-style
-       * storages (if you pass reversed arrays or arrays with Fortran-style
-       * storage, the result is undefined).
+       * color-bands, height, width), or (height, width, RGB color-bands) for
+       * PACKED writers. Frames whose rows hold contiguous pixels (e.g. crops
+       * of larger arrays) are converted in place, whatever the distance
+       * between their rows and color-bands: other frames are copied first.
        */
       void append(const blitz::Array<uint8_t,3>& data);
 
       /**
        * Writes a set of frames to the file. The frame set should be setup as a
        * bob::io::base::array::interface organized this way: (frame-number,
-       * RGB color-bands, height, width) or (RGB color-bands, height, width).
+       * RGB color-bands, height, width) or (RGB color-bands, height, width),
+       * or with the bands last for PACKED writers.
        */
       void append(const bob::io::base::array::interface& data);
 
+      /**
+       * Writes a new grayscale frame (height, width) to the file: its values
+       * are used as the luma of the encoded picture, with neutral chroma, so
+       * they should be in the range of the writer (see full_range()). For
+       * encoders that take yuv420p or yuvj420p pictures, the frame is copied
+       * into the picture as it is, without conversion. Frames whose rows
+       * hold contiguous pixels are read in place, others are copied first.
+       */
+      void append(const blitz::Array<uint8_t,2>& luma);
+
+      /**
+       * Writes a new yuv420p picture to the file, given as its Y (height,
+       * width), U and V (height/2, width/2) planes, in the colour matrix and
+       * range of the writer (see matrix() and full_range()). For encoders
+       * that take yuv420p or yuvj420p pictures, the planes are copied into
+       * the picture as they are, without conversion. Planes whose rows hold
+       * contiguous pixels are read in place, others are copied first.
+       */
+      void append(const blitz::Array<uint8_t,2>& y,
+          const blitz::Array<uint8_t,2>& u, const blitz::Array<uint8_t,2>& v);
+
+      /**
+       * Copies the compressed frames of the video stream of file 'source' to
+       * the output, without decoding and re-encoding them, so frames
+       * appended afterwards follow them. This is only possible if our
+       * encoder produces the same kind of stream (same codec, size, pixel
+       * format and, for containers with global headers, the same codec
+       * headers) and neither reorders frames: otherwise, nothing is copied
+       * and 'false' is returned, so the caller can decode and append the
+       * frames instead. Must be called before any frame is appended.
+       */
+      bool remux(const std::string& source);
+
+    private: //methods
+
+      /**
+       * Creates a new video, written to 'output' if it is set, or to file
+       * 'filename' otherwise
+       */
+      Writer(const std::string& filename,
+          boost::shared_ptr<OutputStream> output, size_t height, size_t width,
+          double framerate, double bitrate, size_t gop,
+          const std::string& codec, const std::string& format, bool check,
+          const WriterSettings& settings);
+
+      /**
+       * Formats of the frames append() takes
+       */
+      enum FrameFormat {
+        RGB_FRAME, ///< planar or packed RGB, following layout()
+        GRAY_FRAME, ///< a single luma plane
+        YUV420P_FRAME ///< Y, U and V planes, chroma halved in both directions
+      };
+
+      /**
+       * A frame queued for the background thread, as a contiguous array,
+       * or contiguous planes
+       */
+      struct QueuedFrame {
+        FrameFormat format;
+        std::vector<uint8_t> data;
+      };
+
+      /**
+       * Raises if the writer is closed
+       */
+      void check_opened() const;
+
+      /**
+       * Encodes a frame, after its extents were checked, or queues a copy
+       * of it for the background thread
+       */
+      void write(const blitz::Array<uint8_t,3>& frame);
+
+      /**
+       * Converts and encodes a frame, on the calling thread. Frames whose
+       * rows hold contiguous pixels are read in place, others are copied
+       * first.
+       */
+      void encode(const blitz::Array<uint8_t,3>& frame);
+
+      /**
+       * Encodes a grayscale or yuv420p picture given as planes (one or
+       * three), or queues a copy of it for the background thread
+       */
+      void write_planes(FrameFormat format, const uint8_t* const* planes,
+          const int* linesizes);
+
+      /**
+       * Converts and encodes a grayscale or yuv420p picture, on the calling
+       * thread
+       */
+      void encode_planes(FrameFormat format, const uint8_t* const* planes,
+          const int* linesizes);
+
+      /**
+       * Returns the segment (file) a frame is written to
+       */
+      size_t segment_of(size_t frame) const;
+
+      /**
+       * Opens files for the segment muxer, through the default callback,
+       * recording the names of the segments opened
+       */
+      static int open_segment(AVFormatContext* s, AVIOContext** pb,
+          const char* url, int flags, AVDictionary** options);
+
+      /**
+       * Prepares the picture of the next frame sent to the encoder, forcing
+       * a keyframe if it starts a new segment
+       */
+      void next_picture();
+
+      /**
+       * Takes a buffer for a queued frame, waiting for room in the queue
+       */
+      std::vector<uint8_t> take_buffer();
+
+      /**
+       * Queues a frame for the background thread
+       */
+      void queue(FrameFormat format, std::vector<uint8_t>& data);
+
+      /**
+       * Body of the background thread: encodes queued frames until it is
+       * stopped and the queue is empty, or until encoding fails
+       */
+      void work();
+
+      /**
+       * Waits for the background thread, if any, to write the queued frames
+       * and stops it
+       */
+      void stop_worker();
+
     private: //not implemented
 
       Writer(const Writer& other);
@@ -171,23 +516,48 @@ namespace bob { namespace io { namespace video {
 
       std::string m_filename; ///< file being written
       bool m_opened; ///< is the file currently opened?
+      boost::shared_ptr<OutputStream> m_output; ///< written instead of a file
+      boost::shared_ptr<AVIOContext> m_io_context; ///< writes to m_output
+      Options m_unused_options; ///< options not used yet, while opening
       boost::shared_ptr<AVFormatContext> m_format_context; ///< format context
       AVCodec* m_codec; ///< the codec we will be using
       boost::shared_ptr<AVStream> m_stream; ///< the video stream
       boost::shared_ptr<AVCodecContext> m_codec_context; ///< codec context
       boost::shared_ptr<AVFrame> m_context_frame; ///< output frame data
       boost::shared_ptr<AVFrame> m_rgb24_frame; ///< temporary frame data
+      blitz::Array<uint8_t,3> m_frame_copy; ///< for frames with scattered pixels
       boost::shared_ptr<SwsContext> m_swscaler; ///< software scaler
+      boost::shared_ptr<SwsContext> m_plane_scaler; ///< for planes, on demand
+      FrameFormat m_plane_scaler_format; ///< what m_plane_scaler converts
       size_t m_height;
       size_t m_width;
       double m_framerate;
       double m_bitrate;
       size_t m_gop;
+      Layout m_layout;
+      YUVMatrix m_matrix;
+      bool m_full_range;
+      ThreadType m_thread_type;
+      OutputMode m_output_mode;
+      double m_segment_length; ///< in frames, 0 if not segmented
+      size_t m_encoded; ///< frames sent to the encoder
+      bool m_native_yuv;
       std::string m_codecname;
       std::string m_formatname;
       bob::io::base::array::typeinfo m_typeinfo_video;
       bob::io::base::array::typeinfo m_typeinfo_frame;
       size_t m_current_frame;
+      size_t m_queue_size; ///< 0 if frames are encoded by the caller
+      std::thread m_worker; ///< encodes queued frames
+      mutable std::mutex m_mutex; ///< protects the members below
+      std::condition_variable m_queued; ///< a frame was queued, or stopping
+      std::condition_variable m_dequeued; ///< a frame was taken, or failed
+      std::deque<QueuedFrame> m_queue; ///< frames to be encoded
+      std::vector<std::vector<uint8_t> > m_spare; ///< buffers to be reused
+      bool m_stopping; ///< tells the background thread to stop
+      std::exception_ptr m_error; ///< background thread failure, if any
+      std::vector<std::string> m_segments; ///< opened by the segment muxer
+      decltype(AVFormatContext::io_open) m_default_io_open; ///< chained to
 
   };
 
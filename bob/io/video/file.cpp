@@ -10,6 +10,7 @@
  */
 
 #include <set>
+#include <algorithm>
 
 #include <boost/filesystem.hpp>
 #include <boost/make_shared.hpp>
@@ -36,16 +37,7 @@ class VideoFile: public bob::io::base::File {
           m_newfile = false;
         }
         else if (mode == 'a' && boost::filesystem::exists(path)) {
-          // to be able to append must load all data and save in video::Writer
-          m_reader = boost::make_shared<bob::io::video::Reader>(m_filename);
-          bob::io::base::array::blitz_array data(m_reader->video_type());
-          m_reader->load(data);
-          size_t height = m_reader->height();
-          size_t width = m_reader->width();
-          m_reader.reset(); ///< cleanup before truncating the file
-          m_writer =
-            boost::make_shared<bob::io::video::Writer>(m_filename, height, width);
-          m_writer->append(data); ///< we are now ready to append
+          open_for_appending();
           m_newfile = false;
         }
         else { //mode is 'w'
@@ -120,6 +112,76 @@ class VideoFile: public bob::io::base::File {
 
     }
 
+  private: //methods
+
+    /**
+     * The longest distance between consecutive keyframes of a video, which
+     * is the group of pictures it was encoded with, or 0 if it has less
+     * than two keyframes (or they cannot be located)
+     */
+    static size_t source_gop(const bob::io::video::Reader& reader) {
+      boost::shared_ptr<const bob::io::video::FrameIndex> index =
+        reader.frame_index();
+      size_t retval = 0;
+      size_t keyframe = index->keyframe_after(0);
+      while (keyframe < index->size()) {
+        size_t next = index->keyframe_after(keyframe + 1);
+        if (next >= index->size()) break;
+        retval = std::max(retval, next - keyframe);
+        keyframe = next;
+      }
+      return retval;
+    }
+
+    /**
+     * Moves the existing file aside and re-creates it with a writer that
+     * encodes frames the same way, then copies the existing frames over:
+     * their compressed packets are copied as they are if our encoder
+     * produces a compatible stream, otherwise they are decoded and encoded
+     * again, one at a time.
+     */
+    void open_for_appending() {
+      boost::filesystem::path original(m_filename);
+      boost::filesystem::path moved = original.parent_path() /
+        boost::filesystem::unique_path(original.stem().string() +
+            "-%%%%-%%%%" + original.extension().string());
+      boost::filesystem::rename(original, moved);
+
+      try {
+        bob::io::video::Reader reader(moved.string());
+        //the writer defaults, for what the file does not tell
+        double bitrate = reader.bitRate()? reader.bitRate() : 1500000.;
+        size_t gop = source_gop(reader);
+        if (!gop) gop = 12;
+        try {
+          m_writer = boost::make_shared<bob::io::video::Writer>(m_filename,
+              reader.height(), reader.width(), reader.frameRate(), bitrate,
+              gop, reader.codecName());
+        }
+        catch (std::runtime_error&) {
+          //cannot encode with the same codec: uses the default one
+          m_writer = boost::make_shared<bob::io::video::Writer>(m_filename,
+              reader.height(), reader.width(), reader.frameRate(), bitrate,
+              gop);
+        }
+        if (!m_writer->remux(moved.string())) {
+          blitz::Array<uint8_t,3> frame(3, reader.height(), reader.width());
+          for (auto it=reader.begin(); it!=reader.end();) {
+            if (it.read(frame)) m_writer->append(frame);
+          }
+        }
+      }
+      catch (...) {
+        //restores the original file
+        m_writer.reset();
+        boost::filesystem::remove(original);
+        boost::filesystem::rename(moved, original);
+        throw;
+      }
+
+      boost::filesystem::remove(moved);
+    }
+
   private: //representation
     std::string m_filename;
     bool m_newfile;
@@ -17,6 +17,8 @@
 
 #include "main.h"
 
+#include <cstring>
+
 
 extern "C" {
 
@@ -95,6 +97,89 @@ int check_string(PyObject* o) {
 #     endif
 }
 
+/**
+ * Converts a layout name (``'planar'`` or ``'packed'``) into a frame
+ * layout, for use with the ``O&`` argument parser. ``None`` keeps the
+ * default. Returns 1 in case of success, 0 in case of failure.
+ */
+int PyBobIoVideo_LayoutConverter(PyObject* o, bob::io::video::Layout* layout) {
+  if (o == Py_None) return 1;
+  const char* name = 0;
+  if (!PyArg_Parse(o, "s", &name)) return 0;
+  if (!std::strcmp(name, "planar")) *layout = bob::io::video::PLANAR;
+  else if (!std::strcmp(name, "packed")) *layout = bob::io::video::PACKED;
+  else {
+    PyErr_Format(PyExc_ValueError, "frame layouts can only be `planar' (color-bands, height, width) or `packed' (height, width, color-bands), not `%s'", name);
+    return 0;
+  }
+  return 1;
+}
+
+const char* PyBobIoVideo_LayoutAsString(bob::io::video::Layout layout) {
+  return (layout == bob::io::video::PACKED)? "packed" : "planar";
+}
+
+int PyBobIoVideo_MatrixConverter(PyObject* o, bob::io::video::YUVMatrix* matrix) {
+  if (o == Py_None) return 1;
+  const char* name = 0;
+  if (!PyArg_Parse(o, "s", &name)) return 0;
+  if (!std::strcmp(name, "bt601")) *matrix = bob::io::video::BT601;
+  else if (!std::strcmp(name, "bt709")) *matrix = bob::io::video::BT709;
+  else {
+    PyErr_Format(PyExc_ValueError, "colour matrices can only be `bt601' or `bt709', not `%s'", name);
+    return 0;
+  }
+  return 1;
+}
+
+const char* PyBobIoVideo_MatrixAsString(bob::io::video::YUVMatrix matrix) {
+  return (matrix == bob::io::video::BT709)? "bt709" : "bt601";
+}
+
+int PyBobIoVideo_ThreadTypeConverter(PyObject* o, bob::io::video::ThreadType* type) {
+  if (o == Py_None) return 1;
+  const char* name = 0;
+  if (!PyArg_Parse(o, "s", &name)) return 0;
+  if (!std::strcmp(name, "auto")) *type = bob::io::video::AUTO_THREADS;
+  else if (!std::strcmp(name, "frame")) *type = bob::io::video::FRAME_THREADS;
+  else if (!std::strcmp(name, "slice")) *type = bob::io::video::SLICE_THREADS;
+  else {
+    PyErr_Format(PyExc_ValueError, "encoder threading methods can only be `auto', `frame' or `slice', not `%s'", name);
+    return 0;
+  }
+  return 1;
+}
+
+const char* PyBobIoVideo_ThreadTypeAsString(bob::io::video::ThreadType type) {
+  switch (type) {
+    case bob::io::video::FRAME_THREADS: return "frame";
+    case bob::io::video::SLICE_THREADS: return "slice";
+    default: return "auto";
+  }
+}
+
+int PyBobIoVideo_OutputModeConverter(PyObject* o, bob::io::video::OutputMode* mode) {
+  if (o == Py_None) return 1;
+  const char* name = 0;
+  if (!PyArg_Parse(o, "s", &name)) return 0;
+  if (!std::strcmp(name, "default")) *mode = bob::io::video::DEFAULT_OUTPUT;
+  else if (!std::strcmp(name, "fragmented")) *mode = bob::io::video::FRAGMENTED_OUTPUT;
+  else if (!std::strcmp(name, "faststart")) *mode = bob::io::video::FASTSTART_OUTPUT;
+  else {
+    PyErr_Format(PyExc_ValueError, "output modes can only be `default', `fragmented' or `faststart', not `%s'", name);
+    return 0;
+  }
+  return 1;
+}
+
+const char* PyBobIoVideo_OutputModeAsString(bob::io::video::OutputMode mode) {
+  switch (mode) {
+    case bob::io::video::FRAGMENTED_OUTPUT: return "fragmented";
+    case bob::io::video::FASTSTART_OUTPUT: return "faststart";
+    default: return "default";
+  }
+}
+
 /**
  * Describes a given codec. We return a **new reference** to a dictionary
  * containing the codec properties.
@@ -532,6 +617,422 @@ static void list_formats(std::map<std::string, std::string>& formats) {
   }
 }
 
+auto s_set_frame_cache_budget = bob::extension::FunctionDoc(
+  "set_frame_cache_budget",
+  "Sets the maximum amount of memory used by the decoded frame cache",
+  "Decoded frames are kept in a process-wide least-recently-used cache, shared by all :py:class:`reader` objects and their iterators. "
+  "Frames are keyed by the identity of the file they come from (device, inode, size and modification time), their index and output format, so that repeated accesses to the same frames (e.g. ``reader[i]``) cost a memory copy instead of a new decoding. "
+  "The cache is disabled by default (budget of 0 bytes). "
+  "Reducing the budget evicts the least recently used frames; setting it to 0 disables the cache and drops all of its contents. "
+  "Iterators consult the cache if it was enabled when they were created."
+)
+.add_prototype("bytes", "None")
+.add_parameter("bytes", "int", "The maximum number of bytes of frame data to keep in the cache")
+;
+static PyObject* PyBobIoVideo_SetFrameCacheBudget(PyObject*, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_set_frame_cache_budget.kwlist();
+
+  Py_ssize_t bytes = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "n", kwlist, &bytes)) return 0;
+
+  if (bytes < 0) {
+    PyErr_Format(PyExc_ValueError, "frame cache budget should be a positive number of bytes, not %" PY_FORMAT_SIZE_T "d", bytes);
+    return 0;
+  }
+
+  bob::io::video::FrameCache::instance().set_budget(bytes);
+  Py_RETURN_NONE;
+BOB_CATCH_FUNCTION("set_frame_cache_budget", 0)
+}
+
+auto s_frame_cache_stats = bob::extension::FunctionDoc(
+  "frame_cache_stats",
+  "Returns a dictionary describing the state of the decoded frame cache",
+  "The dictionary contains the keys ``budget`` (maximum number of bytes), ``size`` (number of bytes in use), ``frames`` (number of frames held), ``hits`` and ``misses`` (number of successful and failed lookups since the last call to :py:func:`clear_frame_cache`)."
+)
+.add_prototype("", "stats")
+.add_return("stats", "dict", "The cache statistics")
+;
+static PyObject* PyBobIoVideo_FrameCacheStats(PyObject*) {
+BOB_TRY
+  bob::io::video::FrameCache& cache = bob::io::video::FrameCache::instance();
+  return Py_BuildValue("{s:n,s:n,s:n,s:K,s:K}",
+      "budget", cache.budget(),
+      "size", cache.size(),
+      "frames", cache.frames(),
+      "hits", (unsigned long long)cache.hits(),
+      "misses", (unsigned long long)cache.misses());
+BOB_CATCH_FUNCTION("frame_cache_stats", 0)
+}
+
+auto s_clear_frame_cache = bob::extension::FunctionDoc(
+  "clear_frame_cache",
+  "Drops all frames of the decoded frame cache and resets its hit and miss counters",
+  "The cache budget is not changed."
+)
+.add_prototype("", "None")
+;
+static PyObject* PyBobIoVideo_ClearFrameCache(PyObject*) {
+BOB_TRY
+  bob::io::video::FrameCache::instance().clear();
+  Py_RETURN_NONE;
+BOB_CATCH_FUNCTION("clear_frame_cache", 0)
+}
+
+auto s_probe = bob::extension::FunctionDoc(
+  "probe",
+  "Reads the metadata of the video stream in a file, without decoding it",
+  "This is a fast alternative to creating a :py:class:`reader` when only the metadata of a video file is needed (e.g. to index a large collection of files). "
+  "No decoder is opened: the values are read from the stream parameters set by the demuxer. "
+  "Packets are only read if the container header does not describe the video stream and, in that case, at most ``probesize`` bytes and ``analyzeduration`` microseconds are analyzed (``0`` uses FFmpeg's defaults). "
+  "A :py:class:`reader` always reads packets to complete the stream information, so on files with incomplete headers the ``frame_rate`` and ``number_of_frames`` it reports may differ from the probed ones. "
+  "The returned dictionary contains the keys ``filename``, ``format_name``, ``format_long_name``, ``codec_name``, ``codec_long_name``, ``height``, ``width``, ``number_of_frames``, ``frame_rate`` and ``duration`` (in microseconds)."
+)
+.add_prototype("filename, [probesize], [analyzeduration]", "info")
+.add_parameter("filename", "str", "The name of the video file to probe")
+.add_parameter("probesize", "int", "[Default: ``0``] The maximum number of bytes to analyze, if the header is not enough")
+.add_parameter("analyzeduration", "int", "[Default: ``0``] The maximum number of microseconds of the stream to analyze, if the header is not enough")
+.add_return("info", "dict", "The metadata of the video stream")
+;
+static PyObject* PyBobIoVideo_Probe(PyObject*, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_probe.kwlist();
+
+  const char* filename = 0;
+  Py_ssize_t probesize = 0;
+  Py_ssize_t analyzeduration = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|nn", kwlist, &filename,
+        &probesize, &analyzeduration)) return 0;
+
+  if (probesize < 0 || analyzeduration < 0) {
+    PyErr_SetString(PyExc_ValueError, "probesize and analyzeduration should be positive numbers (or zero, for the defaults)");
+    return 0;
+  }
+
+  bob::io::video::Probe info =
+    bob::io::video::probe(filename, probesize, analyzeduration);
+
+  return Py_BuildValue("{s:s,s:s,s:s,s:s,s:s,s:n,s:n,s:n,s:d,s:K}",
+      "filename", info.filename.c_str(),
+      "format_name", info.format_name.c_str(),
+      "format_long_name", info.format_long_name.c_str(),
+      "codec_name", info.codec_name.c_str(),
+      "codec_long_name", info.codec_long_name.c_str(),
+      "height", (Py_ssize_t)info.height,
+      "width", (Py_ssize_t)info.width,
+      "number_of_frames", (Py_ssize_t)info.number_of_frames,
+      "frame_rate", info.frame_rate,
+      "duration", (unsigned long long)info.duration);
+BOB_CATCH_FUNCTION("probe", 0)
+}
+
+/**
+ * Converts a string or a sequence of strings into a vector. Returns 'false'
+ * and sets a Python exception in case of failure.
+ */
+static bool string_list(PyObject* o, const char* what,
+    std::vector<std::string>& retval) {
+  retval.clear();
+  const char* c = 0;
+  if (check_string(o)) {
+    if (!PyArg_Parse(o, "s", &c)) return false;
+    retval.push_back(c);
+    return true;
+  }
+  PyObject* seq = PySequence_Fast(o, "");
+  if (!seq) {
+    PyErr_Format(PyExc_TypeError, "`%s' should be a string or a sequence of strings, not `%s'", what, Py_TYPE(o)->tp_name);
+    return false;
+  }
+  auto seq_ = make_safe(seq);
+  for (Py_ssize_t i=0; i<PySequence_Fast_GET_SIZE(seq); ++i) {
+    PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+    if (!check_string(item)) {
+      PyErr_Format(PyExc_TypeError, "`%s' should only contain strings, but item %" PY_FORMAT_SIZE_T "d is a `%s'", what, i, Py_TYPE(item)->tp_name);
+      return false;
+    }
+    if (!PyArg_Parse(item, "s", &c)) return false;
+    retval.push_back(c);
+  }
+  return true;
+}
+
+/**
+ * Adds a column to a manifest, as a numpy array of the given type, with a
+ * value extracted from each entry. Returns 'false' in case of failure.
+ */
+template <typename T, typename F>
+static bool set_column(PyObject* d, const char* key, int type_num,
+    const std::vector<bob::io::video::ScanEntry>& entries, F value) {
+  npy_intp shape[1] = {(npy_intp)entries.size()};
+  PyObject* column = PyArray_SimpleNew(1, shape, type_num);
+  if (!column) return false;
+  auto column_ = make_safe(column);
+  T* data = reinterpret_cast<T*>(PyArray_DATA((PyArrayObject*)column));
+  for (size_t i=0; i<entries.size(); ++i) data[i] = value(entries[i]);
+  return !PyDict_SetItemString(d, key, column);
+}
+
+/**
+ * Adds a column to a manifest, as a list of strings extracted from each
+ * entry. Returns 'false' in case of failure.
+ */
+template <typename F>
+static bool set_string_column(PyObject* d, const char* key,
+    const std::vector<bob::io::video::ScanEntry>& entries, F value) {
+  PyObject* column = PyList_New(entries.size());
+  if (!column) return false;
+  auto column_ = make_safe(column);
+  for (size_t i=0; i<entries.size(); ++i) {
+    PyObject* item = Py_BuildValue("s", value(entries[i]).c_str());
+    if (!item) return false;
+    PyList_SET_ITEM(column, i, item); ///< steals the reference
+  }
+  return !PyDict_SetItemString(d, key, column);
+}
+
+auto s_scan = bob::extension::FunctionDoc(
+  "scan",
+  "Walks directories and reads the metadata of all video files found, in parallel",
+  "Files are probed with :py:func:`probe` (no frame is decoded) by a pool of ``threads`` native threads. "
+  "The result is a columnar manifest: a dictionary mapping column names to a list (for strings) or a 1D :py:class:`numpy.ndarray` (for numbers) with one entry per file, sorted by path. "
+  "The columns are ``path`` (absolute), ``size`` (in bytes), ``mtime`` (modification time, in seconds since the epoch), ``ok`` (the file could be probed), ``cached`` (the entry comes from the cache), ``error`` (why probing failed, or an empty string), plus the keys returned by :py:func:`probe`: ``format_name``, ``format_long_name``, ``codec_name``, ``codec_long_name``, ``height``, ``width``, ``number_of_frames``, ``frame_rate`` and ``duration`` (set to zero or empty strings for files that could not be probed).\n\n"
+  "If a ``cache`` file is given, results are loaded from it before scanning and saved back to it afterwards. "
+  "Entries are keyed by path, size and modification time, so scanning the same directories again only probes files that were added or changed."
+)
+.add_prototype("paths, [extensions], [recursive], [threads], [cache], [probesize], [analyzeduration]", "manifest")
+.add_parameter("paths", "str or [str]", "The directories (or files) to scan")
+.add_parameter("extensions", "[str] or None", "[Default: ``None``] The extensions of files to consider inside directories, including the leading dot (case insensitive). ``None`` selects common video file extensions; an empty list selects all files. Files passed explicitly in ``paths`` are always scanned")
+.add_parameter("recursive", "bool", "[Default: ``True``] Descend into sub-directories")
+.add_parameter("threads", "int", "[Default: ``0``] The number of threads to probe files with; ``0`` uses one per available core")
+.add_parameter("cache", "str or None", "[Default: ``None``] A file to load cached results from (if it exists) and to save them to")
+.add_parameter("probesize", "int", "[Default: ``0``] See :py:func:`probe`")
+.add_parameter("analyzeduration", "int", "[Default: ``0``] See :py:func:`probe`")
+.add_return("manifest", "dict", "The metadata of all files found, by column")
+;
+static PyObject* PyBobIoVideo_Scan(PyObject*, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_scan.kwlist();
+
+  PyObject* pypaths = 0;
+  PyObject* pyextensions = Py_None;
+  PyObject* pyrecursive = Py_True;
+  Py_ssize_t threads = 0;
+  const char* cache = 0;
+  Py_ssize_t probesize = 0;
+  Py_ssize_t analyzeduration = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OOnznn", kwlist, &pypaths,
+        &pyextensions, &pyrecursive, &threads, &cache, &probesize,
+        &analyzeduration)) return 0;
+
+  if (threads < 0 || probesize < 0 || analyzeduration < 0) {
+    PyErr_SetString(PyExc_ValueError, "threads, probesize and analyzeduration should be positive numbers (or zero, for the defaults)");
+    return 0;
+  }
+
+  std::vector<std::string> paths;
+  if (!string_list(pypaths, "paths", paths)) return 0;
+
+  static const char* VIDEO_EXTENSIONS[] = {".avi", ".mov", ".mp4", ".m4v",
+    ".mkv", ".webm", ".mpg", ".mpeg", ".wmv", ".flv", ".ogv", ".3gp",
+    ".mts", ".ts", 0};
+  std::vector<std::string> extensions;
+  if (pyextensions == Py_None) {
+    for (const char** e = VIDEO_EXTENSIONS; *e; ++e) extensions.push_back(*e);
+  }
+  else if (!string_list(pyextensions, "extensions", extensions)) return 0;
+
+  bool recursive = PyObject_IsTrue(pyrecursive);
+
+  bob::io::video::Scanner scanner(threads, probesize, analyzeduration);
+  std::vector<bob::io::video::ScanEntry> entries;
+
+  // scanning may take long and does not touch Python objects
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    if (cache) scanner.load_cache(cache);
+    entries = scanner.scan(paths, extensions, recursive);
+    if (cache) scanner.save_cache(cache);
+  }
+  catch (...) {
+    Py_BLOCK_THREADS
+    throw;
+  }
+  Py_END_ALLOW_THREADS
+
+  typedef bob::io::video::ScanEntry E;
+
+  PyObject* retval = PyDict_New();
+  if (!retval) return 0;
+  auto retval_ = make_safe(retval);
+
+  if (!set_string_column(retval, "path", entries, [](const E& e) { return e.path; })) return 0;
+  if (!set_column<uint64_t>(retval, "size", NPY_UINT64, entries, [](const E& e) { return e.size; })) return 0;
+  if (!set_column<double>(retval, "mtime", NPY_FLOAT64, entries, [](const E& e) { return e.mtime / 1e9; })) return 0;
+  if (!set_column<npy_bool>(retval, "ok", NPY_BOOL, entries, [](const E& e) { return npy_bool(e.ok); })) return 0;
+  if (!set_column<npy_bool>(retval, "cached", NPY_BOOL, entries, [](const E& e) { return npy_bool(e.cached); })) return 0;
+  if (!set_string_column(retval, "error", entries, [](const E& e) { return e.error; })) return 0;
+  if (!set_string_column(retval, "format_name", entries, [](const E& e) { return e.info.format_name; })) return 0;
+  if (!set_string_column(retval, "format_long_name", entries, [](const E& e) { return e.info.format_long_name; })) return 0;
+  if (!set_string_column(retval, "codec_name", entries, [](const E& e) { return e.info.codec_name; })) return 0;
+  if (!set_string_column(retval, "codec_long_name", entries, [](const E& e) { return e.info.codec_long_name; })) return 0;
+  if (!set_column<int64_t>(retval, "height", NPY_INT64, entries, [](const E& e) { return e.info.height; })) return 0;
+  if (!set_column<int64_t>(retval, "width", NPY_INT64, entries, [](const E& e) { return e.info.width; })) return 0;
+  if (!set_column<int64_t>(retval, "number_of_frames", NPY_INT64, entries, [](const E& e) { return e.info.number_of_frames; })) return 0;
+  if (!set_column<double>(retval, "frame_rate", NPY_FLOAT64, entries, [](const E& e) { return e.info.frame_rate; })) return 0;
+  if (!set_column<uint64_t>(retval, "duration", NPY_UINT64, entries, [](const E& e) { return e.info.duration; })) return 0;
+
+  return Py_BuildValue("O", retval);
+BOB_CATCH_FUNCTION("scan", 0)
+}
+
+auto s_conversion_isa = bob::extension::FunctionDoc(
+  "conversion_isa",
+  "Returns the name of the instruction set used to convert decoded pictures",
+  "This is the one used by our own conversion kernels (floating-point outputs and :py:class:`reader` objects with ``native_yuv`` set): ``'avx512'``, ``'avx2'``, ``'sse4.1'``, ``'sse2'`` or ``'scalar'``. "
+  "By default, the best one supported by the running CPU is used. "
+  "All instruction sets produce exactly the same output."
+)
+.add_prototype("", "isa")
+.add_return("isa", "str", "The instruction set in use")
+;
+static PyObject* PyBobIoVideo_ConversionISA(PyObject*) {
+BOB_TRY
+  return Py_BuildValue("s", bob::io::video::conversion_isa());
+BOB_CATCH_FUNCTION("conversion_isa", 0)
+}
+
+auto s_set_conversion_isa = bob::extension::FunctionDoc(
+  "set_conversion_isa",
+  "Restricts the instruction set used to convert decoded pictures",
+  "Kernels are restricted to the given instruction set and the ones below it (see :py:func:`conversion_isa`), which is useful for testing and benchmarking. "
+  "An empty string selects the best instruction set supported by the running CPU again. "
+  "Raises a :py:class:`RuntimeError` if the instruction set is unknown or not supported by the running CPU. "
+  "Do not call this while frames are being decoded by other threads."
+)
+.add_prototype("isa", "None")
+.add_parameter("isa", "str", "The name of the instruction set to use, or ``''`` for the best one")
+;
+static PyObject* PyBobIoVideo_SetConversionISA(PyObject*, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_set_conversion_isa.kwlist();
+
+  const char* isa = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s", kwlist, &isa)) return 0;
+
+  bob::io::video::set_conversion_isa(isa);
+  Py_RETURN_NONE;
+BOB_CATCH_FUNCTION("set_conversion_isa", 0)
+}
+
+/**
+ * Converts an optional frame number, returning 'false' and setting a Python
+ * exception in case of failure. None leaves 'frame' untouched.
+ */
+static bool frame_number(PyObject* o, const char* what, size_t& frame) {
+  if (o == Py_None) return true;
+  Py_ssize_t value = PyNumber_AsSsize_t(o, PyExc_OverflowError);
+  if (value == -1 && PyErr_Occurred()) return false;
+  if (value < 0) {
+    PyErr_Format(PyExc_ValueError, "`%s' should be a frame number (zero or positive), not %" PY_FORMAT_SIZE_T "d", what, value);
+    return false;
+  }
+  frame = value;
+  return true;
+}
+
+auto s_trim = bob::extension::FunctionDoc(
+  "trim",
+  "Cuts a range of frames out of a video file into a new file, without decoding them",
+  "The compressed packets of the frames are copied as they are, which is fast and lossless, with their timestamps shifted so the first frame is presented at zero. "
+  "Frames are selected by number (``start`` and ``stop``) or by time (``start_s`` and ``end_s``, in seconds since the first frame, see :py:meth:`reader.at_time`), with the same semantics as for :py:meth:`reader.load`.\n\n"
+  "As a video can only start at a keyframe, the copy starts at the keyframe before the first frame requested. "
+  "If ``smart`` is ``True``, the frames from the first one requested up to the next keyframe are decoded and encoded again instead (with the same codec), so the output starts exactly at the requested frame. "
+  "This is only possible if the encoder produces a stream compatible with the copied one (e.g., codecs without frame reordering in containers without global headers, such as MPEG-4 in AVI); otherwise, the copy starts at the keyframe. "
+  "In containers with global headers, the headers of the encoder must be byte-identical to the ones of the input, which is in practice never the case for H.264 in MP4 (the default codec of :py:class:`writer` for ``.mp4`` files): smart cutting then has no effect. "
+  "Codecs that reorder frames may have a few frames after ``stop`` copied as well, as they are needed to decode the ones before.\n\n"
+  "The returned dictionary contains the keys ``start`` (the number of the first frame written, in the input), ``frames`` (the number of frames written, from ``start`` up to ``stop``, excluding the extra frames codecs that reorder frames may need) and ``encoded`` (how many of them were encoded again)."
+)
+.add_prototype("input, output, [start], [stop], [start_s], [end_s], [smart], [format]", "result")
+.add_parameter("input", "str", "The name of the video file to cut frames from")
+.add_parameter("output", "str", "The name of the video file to create")
+.add_parameter("start", "int or None", "[Default: ``None``] The number of the first frame to copy")
+.add_parameter("stop", "int or None", "[Default: ``None``] The number of the frame to stop at (it is not copied)")
+.add_parameter("start_s", "float or None", "[Default: ``None``] Time of the first frame to copy, in seconds since the first frame of the video")
+.add_parameter("end_s", "float or None", "[Default: ``None``] Frames presented at or after this time, in seconds since the first frame of the video, are not copied")
+.add_parameter("smart", "bool", "[Default: ``False``] Encode the frames before the first keyframe again, so the output starts at the requested frame")
+.add_parameter("format", "str or None", "[Default: ``None``] The name of the output format; ``None`` guesses it from the extension of ``output``")
+.add_return("result", "dict", "What was written")
+;
+static PyObject* PyBobIoVideo_Trim(PyObject*, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_trim.kwlist();
+
+  const char* input = 0;
+  const char* output = 0;
+  PyObject* pystart = Py_None;
+  PyObject* pystop = Py_None;
+  PyObject* pystart_s = Py_None;
+  PyObject* pyend_s = Py_None;
+  PyObject* pysmart = 0;
+  const char* format = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "ss|OOOOOz", kwlist, &input,
+        &output, &pystart, &pystop, &pystart_s, &pyend_s, &pysmart, &format))
+    return 0;
+
+  bool by_time = (pystart_s != Py_None || pyend_s != Py_None);
+  if (by_time && (pystart != Py_None || pystop != Py_None)) {
+    PyErr_SetString(PyExc_ValueError, "`trim()' accepts either a time interval (start_s, end_s) or a range of frames (start, stop), not both");
+    return 0;
+  }
+
+  size_t start = 0;
+  size_t stop = std::numeric_limits<size_t>::max();
+  if (!frame_number(pystart, "start", start)) return 0;
+  if (!frame_number(pystop, "stop", stop)) return 0;
+
+  if (by_time) {
+    bob::io::video::Reader reader(input);
+    if (pystart_s != Py_None) {
+      double start_s = PyFloat_AsDouble(pystart_s);
+      if (start_s == -1. && PyErr_Occurred()) return 0;
+      start = reader.frame_at_time(start_s);
+    }
+    if (pyend_s != Py_None) {
+      double end_s = PyFloat_AsDouble(pyend_s);
+      if (end_s == -1. && PyErr_Occurred()) return 0;
+      stop = reader.frame_at_time(end_s);
+    }
+  }
+
+  bool smart = (pysmart && PyObject_IsTrue(pysmart));
+
+  // copying may take long and does not touch Python objects
+  bob::io::video::TrimResult result;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    result = bob::io::video::trim(input, output, start, stop, smart,
+        format? format : "");
+  }
+  catch (...) {
+    Py_BLOCK_THREADS
+    throw;
+  }
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue("{s:n,s:n,s:n}",
+      "start", (Py_ssize_t)result.start,
+      "frames", (Py_ssize_t)result.frames,
+      "encoded", (Py_ssize_t)result.encoded);
+BOB_CATCH_FUNCTION("trim", 0)
+}
+
 static PyMethodDef module_methods[] = {
     {
       s_describe_encoder.name(),
@@ -581,6 +1082,54 @@ static PyMethodDef module_methods[] = {
       METH_NOARGS,
       s_available_oformats.doc(),
     },
+    {
+      s_set_frame_cache_budget.name(),
+      (PyCFunction)PyBobIoVideo_SetFrameCacheBudget,
+      METH_VARARGS|METH_KEYWORDS,
+      s_set_frame_cache_budget.doc(),
+    },
+    {
+      s_frame_cache_stats.name(),
+      (PyCFunction)PyBobIoVideo_FrameCacheStats,
+      METH_NOARGS,
+      s_frame_cache_stats.doc(),
+    },
+    {
+      s_clear_frame_cache.name(),
+      (PyCFunction)PyBobIoVideo_ClearFrameCache,
+      METH_NOARGS,
+      s_clear_frame_cache.doc(),
+    },
+    {
+      s_probe.name(),
+      (PyCFunction)PyBobIoVideo_Probe,
+      METH_VARARGS|METH_KEYWORDS,
+      s_probe.doc(),
+    },
+    {
+      s_scan.name(),
+      (PyCFunction)PyBobIoVideo_Scan,
+      METH_VARARGS|METH_KEYWORDS,
+      s_scan.doc(),
+    },
+    {
+      s_conversion_isa.name(),
+      (PyCFunction)PyBobIoVideo_ConversionISA,
+      METH_NOARGS,
+      s_conversion_isa.doc(),
+    },
+    {
+      s_set_conversion_isa.name(),
+      (PyCFunction)PyBobIoVideo_SetConversionISA,
+      METH_VARARGS|METH_KEYWORDS,
+      s_set_conversion_isa.doc(),
+    },
+    {
+      s_trim.name(),
+      (PyCFunction)PyBobIoVideo_Trim,
+      METH_VARARGS|METH_KEYWORDS,
+      s_trim.doc(),
+    },
     {0}  /* Sentinel */
 };
 
@@ -17,10 +17,30 @@
 
 #include "cpp/utils.h"
 #include "cpp/reader.h"
+#include "cpp/probe.h"
+#include "cpp/scanner.h"
+#include "cpp/trim.h"
+#include "cpp/convert.h"
 #include "cpp/writer.h"
 #include "bobskin.h"
 #include "file.h"
 
+// Layouts
+int PyBobIoVideo_LayoutConverter(PyObject* o, bob::io::video::Layout* layout);
+const char* PyBobIoVideo_LayoutAsString(bob::io::video::Layout layout);
+
+// Colour matrices
+int PyBobIoVideo_MatrixConverter(PyObject* o, bob::io::video::YUVMatrix* matrix);
+const char* PyBobIoVideo_MatrixAsString(bob::io::video::YUVMatrix matrix);
+
+// Encoder threading methods
+int PyBobIoVideo_ThreadTypeConverter(PyObject* o, bob::io::video::ThreadType* type);
+const char* PyBobIoVideo_ThreadTypeAsString(bob::io::video::ThreadType type);
+
+// MP4 output modes
+int PyBobIoVideo_OutputModeConverter(PyObject* o, bob::io::video::OutputMode* mode);
+const char* PyBobIoVideo_OutputModeAsString(bob::io::video::OutputMode mode);
+
 // Reader
 typedef struct {
   PyObject_HEAD
@@ -36,6 +56,8 @@ typedef struct {
   PyObject_HEAD
   PyBobIoVideoReaderObject* pyreader;
   boost::shared_ptr<bob::io::video::Reader::const_iterator> iter;
+  boost::shared_ptr<bob::io::video::Reader::const_reverse_iterator> riter;
+  bool with_meta; ///< yield (frame, metadata) tuples
 } PyBobIoVideoReaderIteratorObject;
 extern PyTypeObject PyBobIoVideoReaderIterator_Type;
 
@@ -43,6 +65,7 @@ extern PyTypeObject PyBobIoVideoReaderIterator_Type;
 typedef struct {
   PyObject_HEAD
   boost::shared_ptr<bob::io::video::Writer> v;
+  boost::shared_ptr<bob::io::video::MemoryOutputStream> memory; ///< if any
 } PyBobIoVideoWriterObject;
 
 extern PyTypeObject PyBobIoVideoWriter_Type;
@@ -7,6 +7,9 @@
 
 #include "main.h"
 
+#include <cstring>
+#include <algorithm>
+
 static auto s_reader = bob::extension::ClassDoc(
   "reader",
   "Use this object to read frames from video files."
@@ -14,22 +17,150 @@ static auto s_reader = bob::extension::ClassDoc(
   "The current implementation uses `FFmpeg <http://ffmpeg.org>`_ (or `libav <http://libav.org>`_ if FFmpeg is not available) which is a stable freely available video encoding and decoding library, designed specifically for these tasks. "
   "You can read an entire video in memory by using the :py:meth:`bob.io.video.reader.load` method or use iterators to read it frame by frame and avoid overloading your machine\'s memory. "
   "The maximum precision data `FFmpeg`_ will yield is a 24-bit (8-bit per band) representation of each pixel (32-bit depths are also supported by `FFmpeg`_, but not by this extension presently). "
-  "So, the output of data is done with ``uint8`` as data type. "
+  "So, the output of data is done with ``uint8`` as data type, unless a floating-point ``dtype`` (with an optional per-band ``scale`` and ``offset``) is set in the constructor. "
   "Output will be colored using the RGB standard, with each band varying between 0 and 255, with zero meaning pure black and 255, pure white (color).\n\n"
 ).add_constructor(
   bob::extension::FunctionDoc(
     "reader",
     "Opens a video file for reading",
     "By default, if the format and/or the codec are not supported by this version of Bob, an exception will be raised. "
-    "You can (at your own risk) set the ``check`` flag to ``False`` to  avoid this check.",
+    "You can (at your own risk) set the ``check`` flag to ``False`` to  avoid this check.\n\n"
+    "Instead of a file path, you may also pass an open file descriptor (e.g. the reading end of a pipe) or a file-like object with a ``read(size)`` method, such as :py:class:`io.BytesIO` or ``sys.stdin.buffer``. "
+    "Such inputs are treated as forward-only streams: the video can be traversed only once, in order, by iterating over the reader or calling :py:meth:`load`. "
+    "Indexing, slicing or iterating a second time raise a :py:class:`RuntimeError`. "
+    "The number of frames reported for streams is the one announced by the container, if any, and may be inaccurate.",
     true
   )
-  .add_prototype("filename, [check]", "")
-  .add_parameter("filename", "str", "The file path to the file you want to read data from")
+  .add_prototype("filename, [check], [mmap], [dtype], [scale], [offset], [layout], [native_yuv]", "")
+  .add_parameter("filename", "str, int or file-like", "The file path to the file you want to read data from, an open file descriptor or a file-like object to stream data from")
   .add_parameter("check", "bool", "Format and codec will be extracted from the video metadata.")
+  .add_parameter("mmap", "bool", "[Default: ``False``] If set, the file is memory mapped once and all reading (including iterators) is served from that shared, read-only mapping instead of opening the file again each time. Use it for local files on fast storage.")
+  .add_parameter("dtype", ":py:class:`numpy.dtype` or str", "[Default: ``uint8``] The data type of the output frames: ``uint8``, ``float32`` or ``float16``. Floating-point frames are computed directly from the decoded pictures, as ``value * scale + offset`` per color band, with no intermediate ``uint8`` copy")
+  .add_parameter("scale", "float or (float, float, float)", "[Default: ``1``] The scale of each color band (R, G, B), for floating-point outputs, e.g. ``1./255`` to map values to [0, 1]")
+  .add_parameter("offset", "float or (float, float, float)", "[Default: ``0``] The offset of each color band (R, G, B), added after scaling, for floating-point outputs")
+  .add_parameter("layout", "str", "[Default: ``'planar'``] The layout of the output frames: ``'planar'``, as in (color-bands, height, width), or ``'packed'``, as in (height, width, color-bands), the one used by OpenCV, PIL or TensorFlow. Packed ``uint8`` frames are decoded straight into the output arrays, with no intermediate copy")
+  .add_parameter("native_yuv", "bool", "[Default: ``False``] If set, decoded YUV pictures (``yuv420p``, ``yuvj420p``, ``yuv422p``, ``yuvj422p`` or ``nv12``) are converted to RGB by our own SIMD kernels instead of FFmpeg's software scaler, for ``'planar'`` outputs. Results may differ from the scaler's by a few levels. See :py:func:`conversion_isa`")
 );
 static auto s_fullname = BOB_EXT_MODULE_PREFIX ".reader";
 
+/**
+ * Streams data from a Python file-like object, using its read() method. If
+ * that raises, the Python error is kept set and FFmpeg sees an I/O error.
+ */
+class PythonInputStream: public bob::io::video::InputStream {
+
+  public:
+
+    PythonInputStream(PyObject* o) :
+      bob::io::video::InputStream(std::string("<") + Py_TYPE(o)->tp_name + ">"),
+      m_object(o)
+    {
+      Py_INCREF(m_object);
+    }
+
+    virtual ~PythonInputStream() {
+      Py_DECREF(m_object);
+    }
+
+    virtual int read(uint8_t* buffer, int size) {
+      PyObject* data = PyObject_CallMethod(m_object, const_cast<char*>("read"),
+          const_cast<char*>("i"), size);
+      if (!data) return AVERROR(EIO);
+      auto data_ = make_safe(data);
+
+      char* ptr = 0;
+      Py_ssize_t length = 0;
+      if (PyBytes_AsStringAndSize(data, &ptr, &length) < 0) return AVERROR(EIO);
+      if (length > size) {
+        PyErr_Format(PyExc_ValueError, "%s.read(%d) returned %" PY_FORMAT_SIZE_T "d bytes", Py_TYPE(m_object)->tp_name, size, length);
+        return AVERROR(EIO);
+      }
+
+      std::memcpy(buffer, ptr, length);
+      return length;
+    }
+
+  private:
+
+    PyObject* m_object; ///< the file-like object we read from
+
+};
+
+/**
+ * Returns the numpy type number of the frames output by a reader. Half
+ * precision floats are described as uint16 in C++, as bob.io.base has no
+ * such type.
+ */
+static int output_typenum(const bob::io::video::Reader& reader) {
+  if (reader.output_type() == bob::io::video::Reader::FLOAT16)
+    return NPY_FLOAT16;
+  return PyBobIo_AsTypenum(reader.frame_type().dtype);
+}
+
+/**
+ * Parses per-band values for the output stage: either a single number (for
+ * all bands) or a sequence of 3 numbers. Returns 0 and sets a Python error
+ * on failure.
+ */
+static int parse_bands(PyObject* o, const char* name, float* values) {
+  if (PyNumber_Check(o)) {
+    double value = PyFloat_AsDouble(o);
+    if (value == -1. && PyErr_Occurred()) return 0;
+    values[0] = values[1] = values[2] = value;
+    return 1;
+  }
+  PyObject* seq = PySequence_Fast(o, "");
+  if (!seq || PySequence_Fast_GET_SIZE(seq) != 3) {
+    Py_XDECREF(seq);
+    PyErr_Clear();
+    PyErr_Format(PyExc_TypeError, "`%s' must be a number or a sequence of 3 numbers, one per color band", name);
+    return 0;
+  }
+  auto seq_ = make_safe(seq);
+  for (Py_ssize_t k=0; k<3; ++k) {
+    double value = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(seq, k));
+    if (value == -1. && PyErr_Occurred()) return 0;
+    values[k] = value;
+  }
+  return 1;
+}
+
+/**
+ * Sets up the output stage of a reader from the constructor arguments
+ */
+static int set_output(bob::io::video::Reader& reader, PyObject* pydtype,
+    PyObject* pyscale, PyObject* pyoffset) {
+
+  bob::io::video::Reader::OutputType type = bob::io::video::Reader::UINT8;
+  if (pydtype && pydtype != Py_None) {
+    PyArray_Descr* descr = 0;
+    if (!PyArray_DescrConverter(pydtype, &descr)) return 0;
+    int type_num = descr->type_num;
+    Py_DECREF(descr);
+    switch (type_num) {
+      case NPY_UINT8: type = bob::io::video::Reader::UINT8; break;
+      case NPY_FLOAT32: type = bob::io::video::Reader::FLOAT32; break;
+      case NPY_FLOAT16: type = bob::io::video::Reader::FLOAT16; break;
+      default:
+        PyErr_Format(PyExc_ValueError, "video readers can only output frames as uint8, float32 or float16, not `%s'", PyBlitzArray_TypenumAsString(type_num));
+        return 0;
+    }
+  }
+
+  float scale[3], offset[3];
+  bool has_scale = pyscale && pyscale != Py_None;
+  bool has_offset = pyoffset && pyoffset != Py_None;
+  if (has_scale && !parse_bands(pyscale, "scale", scale)) return 0;
+  if (has_offset && !parse_bands(pyoffset, "offset", offset)) return 0;
+  if ((has_scale || has_offset) && type == bob::io::video::Reader::UINT8) {
+    PyErr_SetString(PyExc_ValueError, "`scale' and `offset' can only be set for floating-point outputs (set `dtype' to float32 or float16)");
+    return 0;
+  }
+
+  reader.set_output(type, has_scale? scale : 0, has_offset? offset : 0);
+  return 1;
+}
+
 static void PyBobIoVideoReader_Delete (PyBobIoVideoReaderObject* o) {
   o->v.reset();
   Py_TYPE(o)->tp_free((PyObject*)o);
@@ -42,15 +173,53 @@ BOB_TRY
   /* Parses input arguments in a single shot */
   char** kwlist = s_reader.kwlist();
 
-  char* filename = 0;
+  PyObject* pyfilename = 0;
 
   PyObject* pycheck = 0;
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|O", kwlist,
-        &filename, &pycheck)) return -1;
+  PyObject* pymmap = 0;
+  PyObject* pydtype = 0;
+  PyObject* pyscale = 0;
+  PyObject* pyoffset = 0;
+  bob::io::video::Layout layout = bob::io::video::PLANAR;
+  PyObject* pynative = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|OOOOOO&O", kwlist,
+        &pyfilename, &pycheck, &pymmap, &pydtype, &pyscale, &pyoffset,
+        &PyBobIoVideo_LayoutConverter, &layout, &pynative)) return -1;
 
   bool check = (pycheck && PyObject_IsTrue(pycheck));
+  bool mmap = (pymmap && PyObject_IsTrue(pymmap));
+  bool native = (pynative && PyObject_IsTrue(pynative));
+
+  boost::shared_ptr<bob::io::video::InputStream> stream;
+  if (PyObject_HasAttrString(pyfilename, "read")) {
+    stream.reset(new PythonInputStream(pyfilename));
+  }
+  else if (PyIndex_Check(pyfilename)) {
+    Py_ssize_t fd = PyNumber_AsSsize_t(pyfilename, PyExc_OverflowError);
+    if (fd == -1 && PyErr_Occurred()) return -1;
+    stream.reset(new bob::io::video::FileDescriptorInputStream(fd));
+  }
+
+  if (stream) {
+    if (mmap) {
+      PyErr_Format(PyExc_ValueError, "`%s' cannot memory map a stream (%s)", Py_TYPE(self)->tp_name, stream->name().c_str());
+      return -1;
+    }
+    self->v.reset(new bob::io::video::Reader(stream, check));
+    if (PyErr_Occurred()) return -1; ///< raised while reading the stream
+    self->v->set_layout(layout);
+    self->v->set_native_yuv(native);
+    if (!set_output(*self->v, pydtype, pyscale, pyoffset)) return -1;
+    return 0; ///< SUCCESS
+  }
 
-  self->v.reset(new bob::io::video::Reader(filename, check));
+  const char* filename = 0;
+  if (!PyArg_Parse(pyfilename, "s", &filename)) return -1;
+
+  self->v.reset(new bob::io::video::Reader(filename, check, mmap));
+  self->v->set_layout(layout);
+  self->v->set_native_yuv(native);
+  if (!set_output(*self->v, pydtype, pyscale, pyoffset)) return -1;
   return 0; ///< SUCCESS
 BOB_CATCH_MEMBER("constructor", -1)
 }
@@ -64,6 +233,46 @@ PyObject* PyBobIoVideoReader_Filename(PyBobIoVideoReaderObject* self) {
   return Py_BuildValue("s", self->v->filename().c_str());
 }
 
+static auto s_streaming = bob::extension::VariableDoc(
+  "streaming",
+  "bool",
+  "``True`` if this reader decodes a forward-only stream (a file descriptor or a file-like object), which can only be traversed once"
+);
+PyObject* PyBobIoVideoReader_Streaming(PyBobIoVideoReaderObject* self) {
+  if (self->v->streaming()) Py_RETURN_TRUE;
+  Py_RETURN_FALSE;
+}
+
+static auto s_indexed = bob::extension::VariableDoc(
+  "indexed",
+  "bool",
+  "``True`` if the index of the timestamps and keyframes of the file was built, by reading (but not decoding) the whole file. "
+  "Only seeking in videos with a variable frame rate builds it: others are sought from timestamps estimated from the :py:attr:`frame_rate`"
+);
+PyObject* PyBobIoVideoReader_Indexed(PyBobIoVideoReaderObject* self) {
+  if (self->v->has_frame_index()) Py_RETURN_TRUE;
+  Py_RETURN_FALSE;
+}
+
+static auto s_layout = bob::extension::VariableDoc(
+  "layout",
+  "str",
+  "The layout of the output frames: ``'planar'`` (color-bands, height, width) or ``'packed'`` (height, width, color-bands)"
+);
+PyObject* PyBobIoVideoReader_Layout(PyBobIoVideoReaderObject* self) {
+  return Py_BuildValue("s", PyBobIoVideo_LayoutAsString(self->v->layout()));
+}
+
+static auto s_native_yuv = bob::extension::VariableDoc(
+  "native_yuv",
+  "bool",
+  "``True`` if decoded YUV pictures are converted to RGB by our own SIMD kernels instead of FFmpeg's software scaler"
+);
+PyObject* PyBobIoVideoReader_NativeYUV(PyBobIoVideoReaderObject* self) {
+  if (self->v->native_yuv()) Py_RETURN_TRUE;
+  Py_RETURN_FALSE;
+}
+
 static auto s_height = bob::extension::VariableDoc(
   "height",
   "int",
@@ -152,8 +361,29 @@ static auto s_video_type = bob::extension::VariableDoc(
   "Typing information to load all of the file at once",
   ".. todo:: Explain, what exactly is contained in this tuple"
 );
+/**
+ * Describes the output type of a reader as a tuple, reporting half precision
+ * floats (uint16 in C++) as such
+ */
+static PyObject* output_type_tuple(const bob::io::video::Reader& reader,
+    const bob::io::base::array::typeinfo& info) {
+  PyObject* retval = PyBobIo_TypeInfoAsTuple(info);
+  if (!retval || reader.output_type() != bob::io::video::Reader::FLOAT16)
+    return retval;
+  PyObject* dtype = (PyObject*)PyArray_DescrFromType(NPY_FLOAT16);
+  if (!dtype) {
+    Py_DECREF(retval);
+    return 0;
+  }
+  if (PyTuple_SetItem(retval, 0, dtype) < 0) { ///< steals dtype
+    Py_DECREF(retval);
+    return 0;
+  }
+  return retval;
+}
+
 PyObject* PyBobIoVideoReader_VideoType(PyBobIoVideoReaderObject* self) {
-  return PyBobIo_TypeInfoAsTuple(self->v->video_type());
+  return output_type_tuple(*self->v, self->v->video_type());
 }
 
 static auto s_frame_type = bob::extension::VariableDoc(
@@ -163,7 +393,7 @@ static auto s_frame_type = bob::extension::VariableDoc(
   ".. todo:: Explain, what exactly is contained in this tuple"
 );
 PyObject* PyBobIoVideoReader_FrameType(PyBobIoVideoReaderObject* self) {
-  return PyBobIo_TypeInfoAsTuple(self->v->frame_type());
+  return output_type_tuple(*self->v, self->v->frame_type());
 }
 
 static auto s_info = bob::extension::VariableDoc(
@@ -183,6 +413,34 @@ static PyGetSetDef PyBobIoVideoReader_getseters[] = {
       s_filename.doc(),
       0,
     },
+    {
+      s_streaming.name(),
+      (getter)PyBobIoVideoReader_Streaming,
+      0,
+      s_streaming.doc(),
+      0,
+    },
+    {
+      s_indexed.name(),
+      (getter)PyBobIoVideoReader_Indexed,
+      0,
+      s_indexed.doc(),
+      0,
+    },
+    {
+      s_layout.name(),
+      (getter)PyBobIoVideoReader_Layout,
+      0,
+      s_layout.doc(),
+      0,
+    },
+    {
+      s_native_yuv.name(),
+      (getter)PyBobIoVideoReader_NativeYUV,
+      0,
+      s_native_yuv.doc(),
+      0,
+    },
     {
       s_height.name(),
       (getter)PyBobIoVideoReader_Height,
@@ -291,6 +549,188 @@ static void Check_Interrupt() {
   }
 }
 
+/**
+ * Random access requires rewinding the input
+ */
+static bool check_not_streaming(PyBobIoVideoReaderObject* self) {
+  if (!self->v->streaming()) return true;
+  PyErr_Format(PyExc_RuntimeError, "`%s' cannot index or slice frames of a forward-only stream (%s) - iterate over it or use load() instead", Py_TYPE(self)->tp_name, self->v->filename().c_str());
+  return false;
+}
+
+/**
+ * Resizes the first dimension of the given array
+ */
+static bool resize_frames(PyObject* array, npy_intp frames) {
+  PyArrayObject* a = (PyArrayObject*)array;
+  npy_intp shape[NPY_MAXDIMS];
+  for (int k=0; k<PyArray_NDIM(a); ++k) shape[k] = PyArray_DIM(a, k);
+  shape[0] = frames;
+  PyArray_Dims newshape;
+  newshape.ptr = shape;
+  newshape.len = PyArray_NDIM(a);
+  PyObject* ok = PyArray_Resize(a, &newshape, 1, NPY_ANYORDER);
+  if (!ok) return false;
+  Py_DECREF(ok);
+  return true;
+}
+
+/**
+ * The layout of the records in frame metadata arrays. It must match the
+ * (aligned) numpy dtype built by make_meta_dtype().
+ */
+struct FrameMetaRecord {
+  int64_t pts;
+  double time_s;
+  npy_bool keyframe;
+  char pict_type;
+  int32_t packet_size;
+};
+
+/**
+ * Returns a **new reference** to the dtype of frame metadata arrays
+ */
+static PyArray_Descr* make_meta_dtype() {
+  PyObject* fields = Py_BuildValue("[(ss)(ss)(ss)(ss)(ss)]",
+      "pts", "i8", "time_s", "f8", "keyframe", "?", "pict_type", "S1",
+      "packet_size", "i4");
+  if (!fields) return 0;
+  auto fields_ = make_safe(fields);
+  PyArray_Descr* retval = 0;
+  if (!PyArray_DescrAlignConverter(fields, &retval)) return 0;
+  if (retval->elsize != (int)sizeof(FrameMetaRecord)) {
+    Py_DECREF(retval);
+    PyErr_Format(PyExc_RuntimeError, "frame metadata records have %d bytes in numpy, but %d bytes in C++", retval->elsize, (int)sizeof(FrameMetaRecord));
+    return 0;
+  }
+  return retval;
+}
+
+/**
+ * Converts frame metadata into a 1D structured numpy array, with fields
+ * ``pts``, ``time_s``, ``keyframe``, ``pict_type`` and ``packet_size``.
+ * Returns a **new reference**.
+ */
+static PyObject* make_meta_array(const std::vector<bob::io::video::FrameInfo>& info) {
+  PyArray_Descr* dtype = make_meta_dtype();
+  if (!dtype) return 0;
+  npy_intp shape[1] = {(npy_intp)info.size()};
+  PyObject* retval = PyArray_Zeros(1, shape, dtype, 0); ///< steals dtype
+  if (!retval) return 0;
+  FrameMetaRecord* data = reinterpret_cast<FrameMetaRecord*>(PyArray_DATA((PyArrayObject*)retval));
+  for (size_t i=0; i<info.size(); ++i) {
+    data[i].pts = info[i].pts;
+    data[i].time_s = info[i].time;
+    data[i].keyframe = info[i].keyframe;
+    data[i].pict_type = info[i].pict_type;
+    data[i].packet_size = info[i].packet_size;
+  }
+  return retval;
+}
+
+/**
+ * Returns the video, or a (video, metadata) tuple if metadata was requested.
+ * Steals a reference to 'video'.
+ */
+static PyObject* with_meta_tuple(PyObject* video,
+    const std::vector<bob::io::video::FrameInfo>* meta) {
+  if (!meta) return video;
+  auto video_ = make_safe(video);
+  PyObject* array = make_meta_array(*meta);
+  if (!array) return 0;
+  return Py_BuildValue("(ON)", video, array);
+}
+
+/**
+ * Loads a forward-only stream, for which the number of frames is not known
+ * in advance: the output array grows geometrically while frames are decoded.
+ */
+static PyObject* load_stream(PyBobIoVideoReaderObject* self,
+    bool raise_on_error, std::vector<bob::io::video::FrameInfo>* meta) {
+
+  const bob::io::base::array::typeinfo& info = self->v->frame_type();
+
+  int type_num = output_typenum(*self->v);
+  if (type_num == NPY_NOTYPE) return 0; ///< failure
+
+  npy_intp shape[NPY_MAXDIMS];
+  shape[0] = std::max<npy_intp>(self->v->numberOfFrames(), 16);
+  for (size_t k=0; k<info.nd; ++k) shape[k+1] = info.shape[k];
+
+  PyObject* retval = PyArray_SimpleNew(info.nd+1, shape, type_num);
+  if (!retval) return 0;
+  auto retval_ = make_safe(retval);
+
+  npy_intp frames_read = 0;
+  for (auto it=self->v->begin(); it!=self->v->end();) {
+    Check_Interrupt();
+
+    if (frames_read == PyArray_DIM((PyArrayObject*)retval, 0)) {
+      if (!resize_frames(retval, 2*frames_read)) return 0;
+    }
+
+    PyObject* islice = Py_BuildValue("n", frames_read);
+    if (!islice) return 0;
+    auto islice_ = make_safe(islice);
+
+    PyObject* item = PyObject_GetItem(retval, islice);
+    if (!item) return 0;
+    auto item_ = make_safe(item);
+
+    bobskin skin((PyArrayObject*)item, info.dtype);
+    bob::io::video::FrameInfo frame_info;
+    bool ok = meta? it.read(skin, frame_info, raise_on_error) :
+      it.read(skin, raise_on_error);
+    if (PyErr_Occurred()) return 0; ///< raised by a file-like object
+    if (ok) {
+      ++frames_read;
+      if (meta) meta->push_back(frame_info);
+    }
+  }
+
+  if (frames_read != PyArray_DIM((PyArrayObject*)retval, 0)) {
+    if (!resize_frames(retval, frames_read)) return 0;
+  }
+
+  return Py_BuildValue("O", retval);
+}
+
+/**
+ * Loads frames first, first+step, ... (up to, but excluding, last) of a video
+ */
+static PyObject* load_range(PyBobIoVideoReaderObject* self, size_t first,
+    size_t last, size_t step, bool raise_on_error,
+    std::vector<bob::io::video::FrameInfo>* meta) {
+
+  const bob::io::base::array::typeinfo& info = self->v->frame_type();
+
+  int type_num = output_typenum(*self->v);
+  if (type_num == NPY_NOTYPE) return 0; ///< failure
+
+  npy_intp shape[NPY_MAXDIMS];
+  shape[0] = (last > first)? ((last - first - 1) / step + 1) : 0;
+  for (size_t k=0; k<info.nd; ++k) shape[k+1] = info.shape[k];
+
+  PyObject* retval = PyArray_SimpleNew(info.nd+1, shape, type_num);
+  if (!retval) return 0;
+  auto retval_ = make_safe(retval);
+
+  if (!shape[0]) return Py_BuildValue("O", retval);
+
+  npy_intp frames_read = 0;
+  bobskin skin((PyArrayObject*)retval, info.dtype);
+  if (meta) frames_read = self->v->load(skin, *meta, first, last, step,
+      raise_on_error, &Check_Interrupt);
+  else frames_read = self->v->load(skin, first, last, step, raise_on_error,
+      &Check_Interrupt);
+
+  if (frames_read != shape[0]) {
+    if (!resize_frames(retval, frames_read)) return 0;
+  }
+
+  return Py_BuildValue("O", retval);
+}
+
 static auto s_load = bob::extension::FunctionDoc(
   "load",
   "Loads all of the video stream in a numpy ndarray organized in this way: (frames, color-bands, height, width). "
@@ -298,12 +738,29 @@ static auto s_load = bob::extension::FunctionDoc(
   "  The flag ``raise_on_error``, which is set to ``False`` by default influences the error reporting in case problems are found with the video file. "
   "If you set it to ``True``, we will report problems raising exceptions. "
   "If you set it to ``False`` (the default), we will truncate the file at the frame with problems and will not report anything. "
-  "It is your task to verify if the number of frames returned matches the expected number of frames as reported by the :py:attr:`number_of_frames` (or ``len``) of this object.",
+  "It is your task to verify if the number of frames returned matches the expected number of frames as reported by the :py:attr:`number_of_frames` (or ``len``) of this object.\n\n"
+  "If ``start_s`` and/or ``end_s`` are given, only the frames presented in the time interval ``[start_s, end_s)``, in seconds since the first frame, are loaded. "
+  "Frames are located by their presentation timestamps (see :py:meth:`at_time`) and decoding starts at the keyframe before the first of them.\n\n"
+  "Alternatively, ``start``, ``stop`` and ``step`` select frames by number, with the semantics of ``reader[start:stop:step]`` (``step`` must be positive). "
+  "In both cases, the input is sought to the keyframe before the first frame and only the frames up to the last one are decoded, into an array of exactly the requested length. "
+  "Pictures are identified by their timestamps, so the file is not scanned first, unless the video has a variable frame rate (see :py:attr:`indexed`). "
+  "Time intervals and frame ranges cannot be used with streaming readers.\n\n"
+  "If ``with_meta`` is ``True``, a ``(video, meta)`` tuple is returned, where ``meta`` is a 1D structured :py:class:`numpy.ndarray` with one record per frame read and the fields ``pts`` (best effort presentation timestamp, in the stream time base), ``time_s`` (presentation time, in seconds since the stream start, ``NaN`` if unknown), ``keyframe`` (``True`` for keyframes), ``pict_type`` (the picture type: ``b'I'``, ``b'P'``, ``b'B'``, ...) and ``packet_size`` (in bytes). "
+  "Frames are then always decoded, as the decoded frame cache (see :py:func:`set_frame_cache_budget`) does not keep metadata.\n\n"
+  "For :py:attr:`streaming` readers, frames are decoded until the end of the stream, growing the output array as needed. "
+  "The stream is consumed by this call.",
   true
 )
-.add_prototype("raise_on_error", "video")
+.add_prototype("[raise_on_error], [start_s], [end_s], [with_meta], [start], [stop], [step]", "video")
 .add_parameter("raise_on_error", "bool", "[Default: ``False``] Raise an excpetion in case of errors?")
+.add_parameter("start_s", "float or None", "[Default: ``None``] Time of the first frame to load, in seconds since the first frame of the video; ``None`` starts at the first frame")
+.add_parameter("end_s", "float or None", "[Default: ``None``] Frames presented at or after this time, in seconds since the first frame of the video, are not loaded; ``None`` loads up to the last frame")
+.add_parameter("with_meta", "bool", "[Default: ``False``] Also return the metadata of each frame")
+.add_parameter("start", "int or None", "[Default: ``None``] The number of the first frame to load")
+.add_parameter("stop", "int or None", "[Default: ``None``] The number of the frame to stop at (it is not loaded)")
+.add_parameter("step", "int or None", "[Default: ``None``] Load one frame every ``step`` frames")
 .add_return("video", "3D or 4D :py:class:`numpy.ndarray`", "The video stream organized as: (frames, color-bands, height, width")
+.add_return("meta", "1D :py:class:`numpy.ndarray`", "The metadata of each frame, only returned if ``with_meta`` is ``True``")
 ;
 static PyObject* PyBobIoVideoReader_Load(PyBobIoVideoReaderObject* self, PyObject *args, PyObject* kwds) {
 BOB_TRY
@@ -311,16 +768,82 @@ BOB_TRY
   char** kwlist = s_load.kwlist();
 
   PyObject* raise = 0;
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &raise)) return 0;
+  PyObject* pystart = Py_None;
+  PyObject* pyend = Py_None;
+  PyObject* pymeta = 0;
+  PyObject* pyfirst = Py_None;
+  PyObject* pylast = Py_None;
+  PyObject* pystep = Py_None;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOOOOOO", kwlist, &raise,
+        &pystart, &pyend, &pymeta, &pyfirst, &pylast, &pystep)) return 0;
 
   bool raise_on_error = (raise && PyObject_IsTrue(raise));
 
+  //metadata is only collected if requested
+  std::vector<bob::io::video::FrameInfo> meta_;
+  std::vector<bob::io::video::FrameInfo>* meta =
+    (pymeta && PyObject_IsTrue(pymeta))? &meta_ : 0;
+
+  bool by_time = (pystart != Py_None || pyend != Py_None);
+  bool by_frame = (pyfirst != Py_None || pylast != Py_None || pystep != Py_None);
+
+  if (by_time && by_frame) {
+    PyErr_Format(PyExc_ValueError, "`%s.load()' accepts either a time interval (start_s, end_s) or a range of frames (start, stop, step), not both", Py_TYPE(self)->tp_name);
+    return 0;
+  }
+
+  if (by_frame) {
+    if (!check_not_streaming(self)) return 0;
+    PyObject* slice = PySlice_New(pyfirst, pylast, pystep);
+    if (!slice) return 0;
+    auto slice_ = make_safe(slice);
+    Py_ssize_t first, last, step, length;
+#if PY_VERSION_HEX < 0x03000000
+    if (PySlice_GetIndicesEx((PySliceObject*)slice,
+#else
+    if (PySlice_GetIndicesEx(slice,
+#endif
+          self->v->numberOfFrames(), &first, &last, &step, &length) < 0) return 0;
+    if (step < 0) {
+      PyErr_Format(PyExc_ValueError, "`%s.load()' only loads frames forward (step should be positive, not %" PY_FORMAT_SIZE_T "d) - use reversed() or a slice to go backwards", Py_TYPE(self)->tp_name, step);
+      return 0;
+    }
+    PyObject* retval = load_range(self, first, last, step, raise_on_error, meta);
+    if (!retval) return 0;
+    return with_meta_tuple(retval, meta);
+  }
+
+  if (by_time) {
+    if (!check_not_streaming(self)) return 0;
+    size_t first = 0;
+    size_t last = self->v->numberOfFrames();
+    if (pystart != Py_None) {
+      double start_s = PyFloat_AsDouble(pystart);
+      if (start_s == -1. && PyErr_Occurred()) return 0;
+      first = self->v->frame_at_time(start_s);
+    }
+    if (pyend != Py_None) {
+      double end_s = PyFloat_AsDouble(pyend);
+      if (end_s == -1. && PyErr_Occurred()) return 0;
+      last = self->v->frame_at_time(end_s);
+    }
+    PyObject* retval = load_range(self, first, last, 1, raise_on_error, meta);
+    if (!retval) return 0;
+    return with_meta_tuple(retval, meta);
+  }
+
+  if (self->v->streaming()) {
+    PyObject* retval = load_stream(self, raise_on_error, meta);
+    if (!retval) return 0;
+    return with_meta_tuple(retval, meta);
+  }
+
   const bob::io::base::array::typeinfo& info = self->v->video_type();
 
   npy_intp shape[NPY_MAXDIMS];
   for (size_t k=0; k<info.nd; ++k) shape[k] = info.shape[k];
 
-  int type_num = PyBobIo_AsTypenum(info.dtype);
+  int type_num = output_typenum(*self->v);
   if (type_num == NPY_NOTYPE) return 0; ///< failure
 
   PyObject* retval = PyArray_SimpleNew(info.nd, shape, type_num);
@@ -330,7 +853,8 @@ BOB_TRY
   Py_ssize_t frames_read = 0;
 
   bobskin skin((PyArrayObject*)retval, info.dtype);
-  frames_read = self->v->load(skin, raise_on_error, &Check_Interrupt);
+  if (meta) frames_read = self->v->load(skin, *meta, raise_on_error, &Check_Interrupt);
+  else frames_read = self->v->load(skin, raise_on_error, &Check_Interrupt);
 
   if (frames_read != shape[0]) {
     //resize
@@ -341,11 +865,310 @@ BOB_TRY
     PyArray_Resize((PyArrayObject*)retval, &newshape, 1, NPY_ANYORDER);
   }
 
-  return Py_BuildValue("O", retval);
+  return with_meta_tuple(Py_BuildValue("O", retval), meta);
 BOB_CATCH_MEMBER("load", 0)
 }
 
 
+static auto s_at_time = bob::extension::FunctionDoc(
+  "at_time",
+  "Reads the first frame presented at or after a given time",
+  "Frames are located by their presentation timestamps, so this is exact for videos with a variable frame rate, where frame numbers do not map to time. "
+  "The input is sought to the keyframe before the requested time, and decoding proceeds from there up to the first frame presented at or after it. "
+  "Only videos with a variable frame rate have an index of timestamps and keyframes built first, by reading (but not decoding) the whole file (see :py:attr:`indexed`). "
+  "If the timestamps in the file cannot be used, the frame is estimated from the average :py:attr:`frame_rate`. "
+  "Times are rounded to the microsecond. "
+  "Not available for :py:attr:`streaming` readers.",
+  true
+)
+.add_prototype("seconds", "frame")
+.add_parameter("seconds", "float", "The time of the frame to read, in seconds since the first frame of the video")
+.add_return("frame", "3D :py:class:`numpy.ndarray`", "The frame, organized as: (color-bands, height, width)")
+;
+static PyObject* PyBobIoVideoReader_AtTime(PyBobIoVideoReaderObject* self, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_at_time.kwlist();
+
+  double seconds = 0.;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "d", kwlist, &seconds)) return 0;
+
+  if (!check_not_streaming(self)) return 0;
+
+  size_t frame = self->v->frame_at_time(seconds);
+  if (frame >= self->v->numberOfFrames()) {
+    PyErr_Format(PyExc_IndexError, "no video frame is presented at or after %g seconds - `%s' lasts %g seconds", seconds, self->v->filename().c_str(), self->v->duration() / 1e6);
+    return 0;
+  }
+
+  const bob::io::base::array::typeinfo& info = self->v->frame_type();
+
+  npy_intp shape[NPY_MAXDIMS];
+  for (size_t k=0; k<info.nd; ++k) shape[k] = info.shape[k];
+
+  int type_num = output_typenum(*self->v);
+  if (type_num == NPY_NOTYPE) return 0; ///< failure
+
+  PyObject* retval = PyArray_SimpleNew(info.nd, shape, type_num);
+  if (!retval) return 0;
+  auto retval_ = make_safe(retval);
+
+  auto it = self->v->begin();
+  it.seek(frame);
+  bobskin skin((PyArrayObject*)retval, info.dtype);
+  if (!it.read(skin)) {
+    PyErr_Format(PyExc_IndexError, "could not read video frame %" PY_FORMAT_SIZE_T "d (at %g seconds) from `%s'", frame, seconds, self->v->filename().c_str());
+    return 0;
+  }
+
+  return Py_BuildValue("O", retval);
+BOB_CATCH_MEMBER("at_time", 0)
+}
+
+static PyObject* PyBobIoVideoReader_Iter (PyBobIoVideoReaderObject* self);
+
+static auto s_frames = bob::extension::FunctionDoc(
+  "frames",
+  "Returns an iterator over the frames of the video, optionally yielding their metadata as well",
+  "Without arguments, this is the same as ``iter(reader)``. "
+  "If ``with_meta`` is ``True``, the iterator yields ``(frame, meta)`` tuples, where ``meta`` is a record with the fields described in :py:meth:`load`. "
+  "Frames are then always decoded, as the decoded frame cache does not keep metadata.",
+  true
+)
+.add_prototype("[with_meta]", "iterator")
+.add_parameter("with_meta", "bool", "[Default: ``False``] Also yield the metadata of each frame")
+.add_return("iterator", "iterator", "An iterator yielding frames as 3D :py:class:`numpy.ndarray` objects or ``(frame, meta)`` tuples")
+;
+static PyObject* PyBobIoVideoReader_Frames(PyBobIoVideoReaderObject* self, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_frames.kwlist();
+
+  PyObject* pymeta = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &pymeta)) return 0;
+
+  PyObject* retval = PyBobIoVideoReader_Iter(self);
+  if (!retval) return 0;
+  ((PyBobIoVideoReaderIteratorObject*)retval)->with_meta =
+    (pymeta && PyObject_IsTrue(pymeta));
+  return retval;
+BOB_CATCH_MEMBER("frames", 0)
+}
+
+static auto s_reversed = bob::extension::FunctionDoc(
+  "__reversed__",
+  "Returns an iterator over the frames of the video, from the last one to the first one",
+  "The video is decoded one group of pictures (GOP) at a time: we seek to the keyframe before the current frame, decode from there on into a buffer and return the buffered frames back to front, before moving to the previous GOP. "
+  "This makes reverse traversals (and slices with negative steps, such as ``reader[::-1]``) about as expensive as forward ones. "
+  "Keyframes are found in the index of the container (e.g. in MP4 and AVI files), and decoded pictures are identified by their timestamps, estimated from the :py:attr:`frame_rate`. "
+  "Only videos with a variable frame rate have an index of keyframes built first, by reading (but not decoding) the whole file. "
+  "Not available for :py:attr:`streaming` readers.",
+  true
+)
+.add_prototype("", "iterator")
+.add_return("iterator", "iterator", "An iterator yielding frames as 3D :py:class:`numpy.ndarray` objects, in reverse order")
+;
+static PyObject* PyBobIoVideoReader_Reversed(PyBobIoVideoReaderObject* self) {
+BOB_TRY
+  if (!check_not_streaming(self)) return 0;
+
+  /* Allocates the python object itself */
+  PyBobIoVideoReaderIteratorObject* retval = (PyBobIoVideoReaderIteratorObject*)PyBobIoVideoReaderIterator_Type.tp_new(&PyBobIoVideoReaderIterator_Type, 0, 0);
+  if (!retval) return 0;
+
+  Py_INCREF(self);
+  retval->pyreader = self;
+  auto retval_ = make_safe(retval);
+  retval->riter.reset(new bob::io::video::Reader::const_reverse_iterator(self->v->rbegin()));
+  return Py_BuildValue("O", retval);
+BOB_CATCH_MEMBER("__reversed__", 0)
+}
+
+/**
+ * The layout of the records in motion arrays. It must match the (aligned)
+ * numpy dtype built in PyBobIoVideoReader_Motion().
+ */
+struct FrameMotionRecord {
+  double difference;
+  npy_bool scene_cut;
+};
+
+static auto s_motion = bob::extension::FunctionDoc(
+  "motion",
+  "Measures the motion between consecutive frames and flags scene cuts, without converting frames to RGB",
+  "Frames are decoded, but only their luma (brightness) plane is used: it is compared to the one of the previous frame, computing the mean absolute difference between pixels, from 0 (identical frames) to 255. "
+  "This is much cheaper than reading the frames, so it can be used to select the frames worth reading, e.g., skipping those whose ``difference`` is below a motion threshold. "
+  "A frame is flagged as a scene cut if its ``difference`` is at least ``threshold`` and not less than twice the one of the frame before, so steady, fast motion is not mistaken for cuts. "
+  "The ``difference`` of the first frame of the video is ``NaN`` and it is always flagged as a scene cut.\n\n"
+  "``start`` and ``stop`` select frames by number, like for :py:meth:`load` (the frame before ``start`` is decoded as well, for comparison). "
+  "For :py:attr:`streaming` readers, all frames are processed and the stream is consumed by this call.",
+  true
+)
+.add_prototype("[start], [stop], [threshold], [raise_on_error]", "motion")
+.add_parameter("start", "int or None", "[Default: ``None``] The number of the first frame to measure")
+.add_parameter("stop", "int or None", "[Default: ``None``] The number of the frame to stop at (it is not measured)")
+.add_parameter("threshold", "float", "[Default: ``30.``] The minimum ``difference`` of scene cuts")
+.add_parameter("raise_on_error", "bool", "[Default: ``False``] Raise an excpetion in case of errors?")
+.add_return("motion", "1D :py:class:`numpy.ndarray`", "A structured array with one record per frame and the fields ``difference`` (float) and ``scene_cut`` (bool)")
+;
+static PyObject* PyBobIoVideoReader_Motion(PyBobIoVideoReaderObject* self, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_motion.kwlist();
+
+  PyObject* pyfirst = Py_None;
+  PyObject* pylast = Py_None;
+  double threshold = 30.;
+  PyObject* raise = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOdO", kwlist, &pyfirst,
+        &pylast, &threshold, &raise)) return 0;
+
+  bool raise_on_error = (raise && PyObject_IsTrue(raise));
+
+  size_t first = 0;
+  size_t last = std::numeric_limits<size_t>::max();
+  if (pyfirst != Py_None || pylast != Py_None) {
+    if (!check_not_streaming(self)) return 0;
+    PyObject* slice = PySlice_New(pyfirst, pylast, 0);
+    if (!slice) return 0;
+    auto slice_ = make_safe(slice);
+    Py_ssize_t start, stop, step, length;
+#if PY_VERSION_HEX < 0x03000000
+    if (PySlice_GetIndicesEx((PySliceObject*)slice,
+#else
+    if (PySlice_GetIndicesEx(slice,
+#endif
+          self->v->numberOfFrames(), &start, &stop, &step, &length) < 0) return 0;
+    first = start;
+    last = stop;
+  }
+
+  std::vector<bob::io::video::FrameMotion> motion;
+  self->v->motion(motion, first, last, threshold, raise_on_error);
+  if (PyErr_Occurred()) return 0; ///< raised by a file-like object
+
+  PyObject* fields = Py_BuildValue("[(ss)(ss)]", "difference", "f8",
+      "scene_cut", "?");
+  if (!fields) return 0;
+  auto fields_ = make_safe(fields);
+  PyArray_Descr* dtype = 0;
+  if (!PyArray_DescrAlignConverter(fields, &dtype)) return 0;
+  if (dtype->elsize != (int)sizeof(FrameMotionRecord)) {
+    Py_DECREF(dtype);
+    PyErr_Format(PyExc_RuntimeError, "motion records have %d bytes in numpy, but %d bytes in C++", dtype->elsize, (int)sizeof(FrameMotionRecord));
+    return 0;
+  }
+
+  npy_intp shape[1] = {(npy_intp)motion.size()};
+  PyObject* retval = PyArray_Zeros(1, shape, dtype, 0); ///< steals dtype
+  if (!retval) return 0;
+  FrameMotionRecord* data = reinterpret_cast<FrameMotionRecord*>(PyArray_DATA((PyArrayObject*)retval));
+  for (size_t i=0; i<motion.size(); ++i) {
+    data[i].difference = motion[i].difference;
+    data[i].scene_cut = motion[i].scene_cut;
+  }
+  return retval;
+BOB_CATCH_MEMBER("motion", 0)
+}
+
+static auto s_motion_vectors = bob::extension::FunctionDoc(
+  "motion_vectors",
+  "Returns the motion vectors of the video codec, a cheap proxy for the optical flow",
+  "Decoders of codecs with motion compensation (e.g. H.264 or MPEG-4) are asked to export the motion vectors they use: frames are decoded, but not converted to RGB, so this costs about as much as decoding. "
+  "Each vector tells that the block of ``w`` x ``h`` pixels centered on (``dst_x``, ``dst_y``) in frame ``frame`` is predicted from the one centered on (``src_x``, ``src_y``) in a past (``source < 0``) or future (``source > 0``) reference frame. "
+  "Intra-coded blocks (and all blocks of intra-only codecs) have no vectors.\n\n"
+  "If ``flow`` is ``True``, the vectors are rasterized into a block-level flow field instead, organized as (frames, 2, ceil(height/block), ceil(width/block)), with the horizontal and vertical displacements, in pixels, from the past to the future. "
+  "Each cell averages the vectors covering it (weighted by the covered area) and is zero if there are none.\n\n"
+  "``start`` and ``stop`` select frames by number, like for :py:meth:`load`. "
+  "For :py:attr:`streaming` readers, all frames are processed and the stream is consumed by this call.",
+  true
+)
+.add_prototype("[start], [stop], [flow], [block], [raise_on_error]", "vectors")
+.add_parameter("start", "int or None", "[Default: ``None``] The number of the first frame to process")
+.add_parameter("stop", "int or None", "[Default: ``None``] The number of the frame to stop at (it is not processed)")
+.add_parameter("flow", "bool", "[Default: ``False``] Return a block-level flow field instead of the vectors")
+.add_parameter("block", "int", "[Default: ``16``] The size of the flow field cells, in pixels")
+.add_parameter("raise_on_error", "bool", "[Default: ``False``] Raise an excpetion in case of errors?")
+.add_return("vectors", ":py:class:`numpy.ndarray`", "A 1D structured array with the fields ``frame``, ``source``, ``w``, ``h``, ``src_x``, ``src_y``, ``dst_x`` and ``dst_y``, or, if ``flow`` is ``True``, a 4D float32 array")
+;
+static PyObject* PyBobIoVideoReader_MotionVectors(PyBobIoVideoReaderObject* self, PyObject *args, PyObject* kwds) {
+BOB_TRY
+  /* Parses input arguments in a single shot */
+  char** kwlist = s_motion_vectors.kwlist();
+
+  PyObject* pyfirst = Py_None;
+  PyObject* pylast = Py_None;
+  PyObject* pyflow = 0;
+  Py_ssize_t block = 16;
+  PyObject* raise = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOOnO", kwlist, &pyfirst,
+        &pylast, &pyflow, &block, &raise)) return 0;
+
+  bool raise_on_error = (raise && PyObject_IsTrue(raise));
+  bool flow = (pyflow && PyObject_IsTrue(pyflow));
+
+  if (block <= 0) {
+    PyErr_Format(PyExc_ValueError, "`%s.motion_vectors()' requires a positive block size (not %" PY_FORMAT_SIZE_T "d)", Py_TYPE(self)->tp_name, block);
+    return 0;
+  }
+
+  size_t first = 0;
+  size_t last = std::numeric_limits<size_t>::max();
+  if (pyfirst != Py_None || pylast != Py_None) {
+    if (!check_not_streaming(self)) return 0;
+    PyObject* slice = PySlice_New(pyfirst, pylast, 0);
+    if (!slice) return 0;
+    auto slice_ = make_safe(slice);
+    Py_ssize_t start, stop, step, length;
+#if PY_VERSION_HEX < 0x03000000
+    if (PySlice_GetIndicesEx((PySliceObject*)slice,
+#else
+    if (PySlice_GetIndicesEx(slice,
+#endif
+          self->v->numberOfFrames(), &start, &stop, &step, &length) < 0) return 0;
+    first = start;
+    last = stop;
+  }
+
+  std::vector<bob::io::video::MotionVector> vectors;
+  size_t frames = self->v->motion_vectors(vectors, first, last,
+      raise_on_error);
+  if (PyErr_Occurred()) return 0; ///< raised by a file-like object
+
+  if (flow) {
+    npy_intp shape[4] = {(npy_intp)frames, 2,
+      (npy_intp)((self->v->height() + block - 1) / block),
+      (npy_intp)((self->v->width() + block - 1) / block)};
+    PyObject* retval = PyArray_SimpleNew(4, shape, NPY_FLOAT32);
+    if (!retval) return 0;
+    bob::io::video::rasterize_motion_vectors(vectors, first, frames,
+        self->v->height(), self->v->width(), block,
+        static_cast<float*>(PyArray_DATA((PyArrayObject*)retval)));
+    return retval;
+  }
+
+  PyObject* fields = Py_BuildValue("[(ss)(ss)(ss)(ss)(ss)(ss)(ss)(ss)]",
+      "frame", "i4", "source", "i4", "w", "u1", "h", "u1", "src_x", "i2",
+      "src_y", "i2", "dst_x", "i2", "dst_y", "i2");
+  if (!fields) return 0;
+  auto fields_ = make_safe(fields);
+  PyArray_Descr* dtype = 0;
+  if (!PyArray_DescrAlignConverter(fields, &dtype)) return 0;
+  if (dtype->elsize != (int)sizeof(bob::io::video::MotionVector)) {
+    Py_DECREF(dtype);
+    PyErr_Format(PyExc_RuntimeError, "motion vector records have %d bytes in numpy, but %d bytes in C++", dtype->elsize, (int)sizeof(bob::io::video::MotionVector));
+    return 0;
+  }
+
+  npy_intp shape[1] = {(npy_intp)vectors.size()};
+  PyObject* retval = PyArray_Zeros(1, shape, dtype, 0); ///< steals dtype
+  if (!retval) return 0;
+  if (!vectors.empty()) std::memcpy(PyArray_DATA((PyArrayObject*)retval),
+      &vectors[0], vectors.size() * sizeof(bob::io::video::MotionVector));
+  return retval;
+BOB_CATCH_MEMBER("motion_vectors", 0)
+}
+
 static PyMethodDef PyBobIoVideoReader_Methods[] = {
     {
       s_load.name(),
@@ -353,11 +1176,43 @@ static PyMethodDef PyBobIoVideoReader_Methods[] = {
       METH_VARARGS|METH_KEYWORDS,
       s_load.doc(),
     },
+    {
+      s_at_time.name(),
+      (PyCFunction)PyBobIoVideoReader_AtTime,
+      METH_VARARGS|METH_KEYWORDS,
+      s_at_time.doc(),
+    },
+    {
+      s_frames.name(),
+      (PyCFunction)PyBobIoVideoReader_Frames,
+      METH_VARARGS|METH_KEYWORDS,
+      s_frames.doc(),
+    },
+    {
+      s_reversed.name(),
+      (PyCFunction)PyBobIoVideoReader_Reversed,
+      METH_NOARGS,
+      s_reversed.doc(),
+    },
+    {
+      s_motion.name(),
+      (PyCFunction)PyBobIoVideoReader_Motion,
+      METH_VARARGS|METH_KEYWORDS,
+      s_motion.doc(),
+    },
+    {
+      s_motion_vectors.name(),
+      (PyCFunction)PyBobIoVideoReader_MotionVectors,
+      METH_VARARGS|METH_KEYWORDS,
+      s_motion_vectors.doc(),
+    },
     {0}  /* Sentinel */
 };
 
 static PyObject* PyBobIoVideoReader_GetIndex (PyBobIoVideoReaderObject* self, Py_ssize_t i) {
 BOB_TRY
+  if (!check_not_streaming(self)) return 0;
+
   if (i < 0) i += self->v->numberOfFrames(); ///< adjust for negative indexing
 
   if (i < 0 || (size_t)i >= self->v->numberOfFrames()) {
@@ -370,7 +1225,7 @@ BOB_TRY
   npy_intp shape[NPY_MAXDIMS];
   for (size_t k=0; k<info.nd; ++k) shape[k] = info.shape[k];
 
-  int type_num = PyBobIo_AsTypenum(info.dtype);
+  int type_num = output_typenum(*self->v);
   if (type_num == NPY_NOTYPE) return 0; ///< failure
 
   PyObject* retval = PyArray_SimpleNew(info.nd, shape, type_num);
@@ -378,7 +1233,7 @@ BOB_TRY
   auto retval_ = make_safe(retval);
 
   auto it = self->v->begin();
-  it += i;
+  it.seek(i);
   bobskin skin((PyArrayObject*)retval, info.dtype);
   it.read(skin);
 
@@ -388,6 +1243,8 @@ BOB_CATCH_MEMBER("get_index", 0)
 
 static PyObject* PyBobIoVideoReader_GetSlice (PyBobIoVideoReaderObject* self, PySliceObject* slice) {
 BOB_TRY
+  if (!check_not_streaming(self)) return 0;
+
   Py_ssize_t start, stop, step, slicelength;
 #if PY_VERSION_HEX < 0x03000000
   if (PySlice_GetIndicesEx(slice,
@@ -399,11 +1256,15 @@ BOB_TRY
   //creates the return array
   const bob::io::base::array::typeinfo& info = self->v->frame_type();
 
-  int type_num = PyBobIo_AsTypenum(info.dtype);
+  int type_num = output_typenum(*self->v);
   if (type_num == NPY_NOTYPE) return 0; ///< failure
 
   if (slicelength <= 0) return PyArray_SimpleNew(0, 0, type_num);
 
+  //decodes only the frames in the slice, seeking to the keyframe before
+  //the first one
+  if (step > 0) return load_range(self, start, stop, step, false, 0);
+
   npy_intp shape[NPY_MAXDIMS];
   shape[0] = slicelength;
   for (size_t k=0; k<info.nd; ++k) shape[k+1] = info.shape[k];
@@ -412,23 +1273,16 @@ BOB_TRY
   if (!retval) return 0;
   auto retval_ = make_safe(retval);
 
-  Py_ssize_t counter;
-  Py_ssize_t lo, hi, st;
-  auto it = self->v->begin();
-  if (start <= stop) {
-    lo = start, hi = stop, st = step;
-    it += lo, counter = 0;
-  }
-  else {
-    lo = stop, hi = start, st = -step;
-    it += lo + (hi-lo)%st, counter = slicelength - 1;
-  }
+  //walks the video backwards, one group of pictures at a time
+  auto it = self->v->rbegin();
+  if ((size_t)start < it.cur()) it += it.cur() - start;
 
-  for (auto i=lo; i<hi; i+=st) {
+  Py_ssize_t frames_read = 0;
+  for (Py_ssize_t counter=0; counter<slicelength; ++counter) {
+    if (it == self->v->rend()) break;
 
     //get slice to fill
     PyObject* islice = Py_BuildValue("n", counter);
-    counter = (st == -step)? counter-1 : counter+1;
     if (!islice) return 0;
     auto islice_ = make_safe(islice);
 
@@ -437,8 +1291,14 @@ BOB_TRY
     auto item_ = make_safe(item);
 
     bobskin skin((PyArrayObject*)item, info.dtype);
-    it.read(skin);
-    it += (st-1);
+    if (!it.read(skin)) break;
+    ++frames_read;
+    if (counter < slicelength - 1) it += (-step-1);
+  }
+
+  //as load(), only returns the frames that could be read
+  if (frames_read != slicelength) {
+    if (!resize_frames(retval, frames_read)) return 0;
   }
 
   return Py_BuildValue("O", retval);
@@ -481,8 +1341,10 @@ static const char* s_videoreaderiterator(BOB_EXT_MODULE_PREFIX ".reader.iter");
 
 
 static void PyBobIoVideoReaderIterator_Delete (PyBobIoVideoReaderIteratorObject* self) {
-  self->iter->reset();
+  if (self->iter) self->iter->reset();
   self->iter.reset();
+  if (self->riter) self->riter->reset();
+  self->riter.reset();
   Py_XDECREF((PyObject*)self->pyreader);
 }
 
@@ -492,8 +1354,12 @@ static PyObject* PyBobIoVideoReaderIterator_Iter (PyBobIoVideoReaderIteratorObje
 
 static PyObject* PyBobIoVideoReaderIterator_Next (PyBobIoVideoReaderIteratorObject* self) {
 
-  if ((*self->iter == self->pyreader->v->end()) ||
-      (self->iter->cur() == self->pyreader->v->numberOfFrames())) {
+  if (self->riter) {
+    if (*self->riter == self->pyreader->v->rend()) return 0;
+  }
+  else if ((*self->iter == self->pyreader->v->end()) ||
+      (!self->pyreader->v->streaming() &&
+       self->iter->cur() == self->pyreader->v->numberOfFrames())) {
     return 0;
   }
 
@@ -502,26 +1368,44 @@ static PyObject* PyBobIoVideoReaderIterator_Next (PyBobIoVideoReaderIteratorObje
   npy_intp shape[NPY_MAXDIMS];
   for (size_t k=0; k<info.nd; ++k) shape[k] = info.shape[k];
 
-  int type_num = PyBobIo_AsTypenum(info.dtype);
+  int type_num = output_typenum(*self->pyreader->v);
   if (type_num == NPY_NOTYPE) return 0; ///< failure
 
   PyObject* retval = PyArray_SimpleNew(info.nd, shape, type_num);
   if (!retval) return 0;
   auto retval_ = make_safe(retval);
 
+  bob::io::video::FrameInfo frame_info;
   try {
     bobskin skin((PyArrayObject*)retval, info.dtype);
-    self->iter->read(skin);
+    bool ok;
+    if (self->riter) ok = self->riter->read(skin);
+    else if (self->with_meta) ok = self->iter->read(skin, frame_info);
+    else ok = self->iter->read(skin);
+    if (!ok) {
+      //the stream ended (or was truncated) before the announced number of
+      //frames: stops iterating, unless a file-like object raised
+      return 0;
+    }
   }
   catch (std::exception& e) {
     if (!PyErr_Occurred()) PyErr_SetString(PyExc_RuntimeError, e.what());
     return 0;
   }
   catch (...) {
-    if (!PyErr_Occurred()) PyErr_Format(PyExc_RuntimeError, "caught unknown exception while reading frame #%" PY_FORMAT_SIZE_T "d from file `%s'", self->iter->cur(), self->pyreader->v->filename().c_str());
+    if (!PyErr_Occurred()) PyErr_Format(PyExc_RuntimeError, "caught unknown exception while reading frame #%" PY_FORMAT_SIZE_T "d from file `%s'", self->riter? self->riter->cur() : self->iter->cur(), self->pyreader->v->filename().c_str());
     return 0;
   }
 
+  if (self->with_meta) {
+    PyObject* meta = make_meta_array(std::vector<bob::io::video::FrameInfo>(1, frame_info));
+    if (!meta) return 0;
+    auto meta_ = make_safe(meta);
+    PyObject* record = PySequence_GetItem(meta, 0);
+    if (!record) return 0;
+    return Py_BuildValue("(ON)", retval, record);
+  }
+
   Py_INCREF(retval);
   return retval;
 
@@ -539,7 +1423,14 @@ static PyObject* PyBobIoVideoReader_Iter (PyBobIoVideoReaderObject* self) {
 
   Py_INCREF(self);
   retval->pyreader = self;
-  retval->iter.reset(new bob::io::video::Reader::const_iterator(self->v->begin()));
+  try {
+    retval->iter.reset(new bob::io::video::Reader::const_iterator(self->v->begin()));
+  }
+  catch (std::exception& e) {
+    Py_DECREF(retval);
+    if (!PyErr_Occurred()) PyErr_SetString(PyExc_RuntimeError, e.what());
+    return 0;
+  }
   return Py_BuildValue("N", retval);
 }
 
@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+
+"""This program walks directories looking for video files and writes a
+manifest with their metadata (format, codec, size, number of frames, frame
+rate and duration), one line per file, in CSV format.
+
+Files are probed in parallel, without decoding any frame. If a cache file is
+given, results are saved to it and re-used on later runs for files whose
+path, size and modification time did not change, so re-scanning large
+collections only touches new or modified files.
+"""
+
+import os
+import sys
+import csv
+import argparse
+
+from .. import scan
+
+COLUMNS = [
+    'path',
+    'size',
+    'mtime',
+    'ok',
+    'error',
+    'format_name',
+    'codec_name',
+    'height',
+    'width',
+    'number_of_frames',
+    'frame_rate',
+    'duration',
+    ]
+
+__epilog__ = """Example usage:
+
+1. Scan a directory tree and print the manifest:
+
+  $ %(prog)s /path/to/videos
+
+2. Scan only AVI files using 8 threads, caching results and saving the
+manifest to a file:
+
+  $ %(prog)s --extension=.avi --threads=8 --cache=videos.cache --output=videos.csv /path/to/videos
+""" % {
+    'prog': os.path.basename(sys.argv[0]),
+    }
+
+def write_manifest(manifest, stream):
+  """Writes a manifest, as returned by :py:func:`bob.io.video.scan`, to a
+  stream in CSV format, one row per file"""
+
+  writer = csv.writer(stream)
+  writer.writerow(COLUMNS)
+  for i in range(len(manifest['path'])):
+    writer.writerow([manifest[k][i] for k in COLUMNS])
+
+def main(user_input=None):
+
+  from ..version import module as __version__
+
+  parser = argparse.ArgumentParser(description=__doc__, epilog=__epilog__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+
+  name = os.path.basename(os.path.splitext(sys.argv[0])[0])
+  version_info = 'Video Metadata Scanner v%s (%s)' % (__version__, name)
+  parser.add_argument('-V', '--version', action='version', version=version_info)
+
+  parser.add_argument("path", metavar='PATH', type=str, nargs='+',
+      help="The directories (or files) to scan")
+  parser.add_argument("-e", "--extension", metavar='EXT', type=str,
+      action='append', help="Only consider files with this extension inside directories (e.g. `.avi', may be repeated). If not given, consider common video file extensions")
+  parser.add_argument("-a", "--all-files", action="store_true", default=False,
+      help="Consider all files inside directories, regardless of their extension")
+  parser.add_argument("-n", "--no-recursive", action="store_true",
+      default=False, help="Do not descend into sub-directories")
+  parser.add_argument("-t", "--threads", metavar='INT', type=int, default=0,
+      help="The number of threads to probe files with (defaults to one per available core)")
+  parser.add_argument("-c", "--cache", metavar='FILE', type=str,
+      help="A file to load cached results from and save them to")
+  parser.add_argument("-o", "--output", metavar='FILE', type=str,
+      help="Write the manifest to this file instead of the standard output")
+  parser.add_argument("-v", "--verbose", action="store_true", default=False,
+      help="Print a summary of the scan to the standard error")
+
+  args = parser.parse_args(args=user_input)
+
+  extensions = args.extension
+  if args.all_files: extensions = []
+
+  manifest = scan(args.path, extensions=extensions,
+      recursive=not args.no_recursive, threads=args.threads, cache=args.cache)
+
+  if args.output:
+    with open(args.output, 'wt') as f: write_manifest(manifest, f)
+  else:
+    write_manifest(manifest, sys.stdout)
+
+  if args.verbose:
+    total = len(manifest['path'])
+    cached = int(manifest['cached'].sum())
+    failed = total - int(manifest['ok'].sum())
+    sys.stderr.write("Scanned %d file(s): %d probed, %d from cache, %d failed\n" % (total, total - cached, cached, failed))
+
+  return 0
@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+# vim: set fileencoding=utf-8 :
+
+"""This program cuts a range of frames out of a video file into a new file,
+without decoding them: the compressed frames are copied as they are, which is
+fast and lossless.
+
+As a video can only start at a keyframe, the output starts at the keyframe
+before the first frame requested, unless smart cutting is enabled: the frames
+up to the next keyframe are then encoded again, so the output starts exactly
+at the requested frame. This needs a codec without frame reordering and, in
+containers with global headers, encoder headers identical to the input ones:
+it works for MPEG-4 in AVI, but not for H.264 in MP4, which is then copied
+from the keyframe.
+"""
+
+import os
+import sys
+import argparse
+
+from .. import trim
+
+__epilog__ = """Example usage:
+
+1. Copy frames 100 to 199 of a video:
+
+  $ %(prog)s --start=100 --stop=200 input.avi output.avi
+
+2. Copy the frames presented between 10.5 and 20 seconds, starting exactly at
+10.5 seconds:
+
+  $ %(prog)s --start-time=10.5 --end-time=20 --smart input.avi output.avi
+""" % {
+    'prog': os.path.basename(sys.argv[0]),
+    }
+
+def main(user_input=None):
+
+  from ..version import module as __version__
+
+  parser = argparse.ArgumentParser(description=__doc__, epilog=__epilog__,
+      formatter_class=argparse.RawDescriptionHelpFormatter)
+
+  name = os.path.basename(os.path.splitext(sys.argv[0])[0])
+  version_info = 'Video Trimmer v%s (%s)' % (__version__, name)
+  parser.add_argument('-V', '--version', action='version', version=version_info)
+
+  parser.add_argument("input", metavar='INPUT', type=str,
+      help="The video file to cut frames from")
+  parser.add_argument("output", metavar='OUTPUT', type=str,
+      help="The video file to create")
+  parser.add_argument("-s", "--start", metavar='INT', type=int,
+      help="The number of the first frame to copy (defaults to the first frame)")
+  parser.add_argument("-e", "--stop", metavar='INT', type=int,
+      help="The number of the frame to stop at, which is not copied (defaults to the end of the video)")
+  parser.add_argument("-S", "--start-time", metavar='SECONDS', type=float,
+      help="The time of the first frame to copy, in seconds since the first frame")
+  parser.add_argument("-E", "--end-time", metavar='SECONDS', type=float,
+      help="Frames presented at or after this time, in seconds since the first frame, are not copied")
+  parser.add_argument("-m", "--smart", action="store_true", default=False,
+      help="Encode the frames before the first keyframe again, so the output starts at the requested frame (not possible for H.264 in MP4)")
+  parser.add_argument("-f", "--format", metavar='FORMAT', type=str,
+      help="The output format (defaults to the one of the output file extension)")
+  parser.add_argument("-v", "--verbose", action="store_true", default=False,
+      help="Print a summary of what was written to the standard error")
+
+  args = parser.parse_args(args=user_input)
+
+  by_time = args.start_time is not None or args.end_time is not None
+  if by_time and (args.start is not None or args.stop is not None):
+    parser.error("use either frame numbers (--start, --stop) or times (--start-time, --end-time), not both")
+
+  if by_time:
+    result = trim(args.input, args.output, start_s=args.start_time,
+        end_s=args.end_time, smart=args.smart, format=args.format)
+  else:
+    result = trim(args.input, args.output, start=args.start, stop=args.stop,
+        smart=args.smart, format=args.format)
+
+  if args.verbose:
+    sys.stderr.write("Wrote %d frame(s) from frame %d of `%s' to `%s' (%d encoded again)\n" % (result['frames'], result['start'], args.input, args.output, result['encoded']))
+
+  return 0
@@ -371,6 +371,132 @@ def test_slicing_4():
   assert numpy.allclose(s[3], f[len(f)-19])
 
 
+def test_reverse_iteration():
+
+  from . import reader
+  array = load(INPUT_VIDEO)
+  f = reader(INPUT_VIDEO)
+
+  frames = list(reversed(f))
+  nose.tools.eq_(len(frames), len(array))
+  for k, frame in enumerate(frames):
+    assert numpy.array_equal(frame, array[-1-k]), 'frame %d differs' % k
+
+  assert numpy.array_equal(f[::-1], array[::-1])
+  assert numpy.array_equal(f[::-7], array[::-7])
+  assert numpy.array_equal(f[-5::-25], array[-5::-25])
+
+
+def test_seeking_without_index():
+
+  from . import reader, writer
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    video = numpy.random.RandomState(0).randint(0, 256, (30, 3, 64, 96)).astype('uint8')
+    outv = writer(tmpname, 64, 96, codec='mpeg4', gop=6)
+    outv.append(video)
+    outv.close()
+    expected = reader(tmpname).load()
+
+    # constant frame rate: frames are located from their timestamps
+    f = reader(tmpname)
+    for k in (17, 3, 25, 0, 12, 13):
+      assert numpy.array_equal(f[k], expected[k]), 'frame %d differs' % k
+    assert numpy.array_equal(f[::-1], expected[::-1])
+    assert numpy.array_equal(f[-2::-5], expected[-2::-5])
+    assert not f.indexed
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_mmap_reading():
+
+  from . import reader
+  array = load(INPUT_VIDEO)
+  f = reader(INPUT_VIDEO, mmap=True)
+
+  nose.tools.eq_(len(f), len(array))
+  assert numpy.array_equal(f.load(), array)
+  for frame_id, frame in zip(range(5), f):
+    assert numpy.array_equal(array[frame_id], frame)
+  assert numpy.array_equal(f[len(f)-1], array[-1])
+
+
+def test_stream_reading():
+
+  import io
+  import subprocess
+  from . import test_utils
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+
+  from . import writer, reader
+
+  try:
+
+    outv = writer(tmpname, 32, 48, 25)
+    for i in range(10):
+      outv.append(numpy.random.randint(0, 256, (3, 32, 48)).astype('uint8'))
+    outv.close()
+    expected = reader(tmpname).load()
+
+    # file-like objects
+    with open(tmpname, 'rb') as f: data = f.read()
+    f = reader(io.BytesIO(data))
+    assert f.streaming
+    assert numpy.array_equal(f.load(), expected)
+    nose.tools.assert_raises(RuntimeError, f.load) # already consumed
+    nose.tools.assert_raises(RuntimeError, f.__getitem__, 0)
+
+    # file descriptors (a pipe)
+    p = subprocess.Popen(['cat', tmpname], stdout=subprocess.PIPE)
+    try:
+      f = reader(p.stdout.fileno())
+      frames = [k for k in f]
+      nose.tools.eq_(len(frames), len(expected))
+      for k, frame in enumerate(frames):
+        assert numpy.array_equal(frame, expected[k])
+    finally:
+      p.stdout.close()
+      p.wait()
+
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_frame_cache():
+
+  from . import reader, set_frame_cache_budget, frame_cache_stats, \
+      clear_frame_cache
+  array = load(INPUT_VIDEO)
+
+  set_frame_cache_budget(10 * array[0].nbytes)
+  try:
+    clear_frame_cache()
+    f = reader(INPUT_VIDEO)
+    assert numpy.array_equal(f[5], array[5])
+    stats = frame_cache_stats()
+    nose.tools.eq_(stats['misses'], 1)
+    nose.tools.eq_(stats['hits'], 0)
+    nose.tools.eq_(stats['frames'], 1)
+
+    # another reader on the same file shares the cache
+    assert numpy.array_equal(reader(INPUT_VIDEO)[5], array[5])
+    nose.tools.eq_(frame_cache_stats()['hits'], 1)
+
+    # the budget is respected
+    for frame_id, frame in enumerate(f):
+      assert numpy.array_equal(frame, array[frame_id])
+    stats = frame_cache_stats()
+    nose.tools.eq_(stats['frames'], 10)
+    assert stats['size'] <= stats['budget']
+
+  finally:
+    set_frame_cache_budget(0)
+    clear_frame_cache()
+
+  nose.tools.eq_(frame_cache_stats()['frames'], 0)
+
+
 def test_can_use_array_interface():
 
   from . import reader
@@ -473,3 +599,842 @@ def test_closed_video_writer_raises():
   finally:
     # And we erase both files after this
     if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_probe():
+
+  from . import reader, probe
+  f = reader(INPUT_VIDEO)
+  info = probe(INPUT_VIDEO)
+
+  nose.tools.eq_(info['filename'], INPUT_VIDEO)
+  nose.tools.eq_(info['format_name'], f.format_name)
+  nose.tools.eq_(info['codec_name'], f.codec_name)
+  nose.tools.eq_(info['height'], f.height)
+  nose.tools.eq_(info['width'], f.width)
+  nose.tools.eq_(info['number_of_frames'], f.number_of_frames)
+  nose.tools.eq_(info['duration'], f.duration)
+  assert abs(info['frame_rate'] - f.frame_rate) < 1e-6
+
+  # limits the amount of data analyzed
+  info = probe(INPUT_VIDEO, probesize=2048, analyzeduration=0)
+  nose.tools.eq_(info['width'], f.width)
+
+  nose.tools.assert_raises(RuntimeError, probe, 'does-not-exist.avi')
+
+
+def test_scan():
+
+  import shutil
+  import tempfile
+  from . import scan, probe
+  from .script.video_scan import main
+
+  tmpdir = tempfile.mkdtemp()
+  try:
+    os.makedirs(os.path.join(tmpdir, 'sub'))
+    shutil.copy(INPUT_VIDEO, os.path.join(tmpdir, 'a.mov'))
+    shutil.copy(INPUT_VIDEO, os.path.join(tmpdir, 'sub', 'b.MOV'))
+    with open(os.path.join(tmpdir, 'broken.avi'), 'wb') as f:
+      f.write(b'not a video')
+    with open(os.path.join(tmpdir, 'notes.txt'), 'wt') as f:
+      f.write('not considered')
+    cache = os.path.join(tmpdir, 'scan.cache')
+
+    m = scan(tmpdir, threads=2, cache=cache)
+    nose.tools.eq_([os.path.basename(k) for k in m['path']],
+        ['a.mov', 'broken.avi', 'b.MOV'])
+    nose.tools.eq_(list(m['ok']), [True, False, True])
+    nose.tools.eq_(list(m['cached']), [False, False, False])
+    assert m['error'][1]
+    info = probe(INPUT_VIDEO)
+    nose.tools.eq_(m['number_of_frames'][0], info['number_of_frames'])
+    nose.tools.eq_(m['width'][2], info['width'])
+    nose.tools.eq_(m['codec_name'][0], info['codec_name'])
+
+    # not recursive
+    m = scan(tmpdir, recursive=False, cache=cache)
+    nose.tools.eq_(len(m['path']), 2)
+
+    # only changed files are probed again
+    with open(os.path.join(tmpdir, 'broken.avi'), 'ab') as f:
+      f.write(b'!')
+    m = scan([tmpdir], cache=cache)
+    nose.tools.eq_(list(m['cached']), [True, False, True])
+
+    # the command line interface
+    output = os.path.join(tmpdir, 'manifest.csv')
+    main([tmpdir, '--cache', cache, '--output', output])
+    with open(output, 'rt') as f: lines = f.readlines()
+    nose.tools.eq_(len(lines), 4)
+    assert lines[0].startswith('path,')
+
+    nose.tools.assert_raises(RuntimeError, scan, os.path.join(tmpdir, 'nope'))
+
+  finally:
+    shutil.rmtree(tmpdir)
+
+
+def test_time_access():
+
+  from . import reader, writer
+  f = reader(INPUT_VIDEO)
+  array = f.load()
+  period = 1. / f.frame_rate
+
+  assert numpy.array_equal(f.at_time(0), array[0])
+  # times in between frames return the next one
+  assert numpy.array_equal(f.at_time(4.75 * period), array[5])
+  nose.tools.assert_raises(IndexError, f.at_time, 2 * f.duration / 1e6)
+
+  video = f.load(start_s=2.75 * period, end_s=7.75 * period)
+  nose.tools.eq_(video.shape[0], 5)
+  assert numpy.array_equal(video, array[3:8])
+  nose.tools.eq_(f.load(end_s=1.75 * period).shape[0], 2)
+  nose.tools.eq_(f.load(start_s=1.75 * period).shape[0], len(array) - 2)
+
+  # videos with a constant frame rate are sought without the frame index
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    video = numpy.random.RandomState(0).randint(0, 256, (20, 3, 64, 96)).astype('uint8')
+    outv = writer(tmpname, 64, 96, framerate=10, codec='mpeg4', gop=4)
+    outv.append(video)
+    outv.close()
+    expected = reader(tmpname).load()
+    f = reader(tmpname)
+    assert numpy.array_equal(f.at_time(1.25), expected[13])
+    assert numpy.array_equal(f.at_time(0.7), expected[7])
+    assert numpy.array_equal(f.load(start_s=0.55, end_s=1.5), expected[6:15])
+    nose.tools.assert_raises(IndexError, f.at_time, 2.)
+    assert not f.indexed
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_frame_meta():
+
+  from . import reader
+  f = reader(INPUT_VIDEO)
+  array = f.load()
+
+  video, meta = f.load(with_meta=True)
+  assert numpy.array_equal(video, array)
+  nose.tools.eq_(meta.shape, (len(array),))
+  nose.tools.eq_(set(meta.dtype.names),
+      set(('pts', 'time_s', 'keyframe', 'pict_type', 'packet_size')))
+  assert meta['keyframe'][0]
+  nose.tools.eq_(meta['pict_type'][0], b'I')
+  nose.tools.eq_(meta['time_s'][0], 0.)
+  assert numpy.all(numpy.diff(meta['pts']) > 0)
+  assert numpy.all(meta['packet_size'] > 0)
+  assert abs(meta['time_s'][1] - 1. / f.frame_rate) < 1e-3
+
+  # the iterator mode yields the same
+  for k, (frame, m) in enumerate(f.frames(with_meta=True)):
+    assert numpy.array_equal(frame, array[k])
+    nose.tools.eq_(m['pts'], meta['pts'][k])
+  nose.tools.eq_(k, len(array) - 1)
+
+  # and so do time intervals
+  period = 1. / f.frame_rate
+  video, m = f.load(start_s=2.75 * period, with_meta=True)
+  assert numpy.array_equal(m, meta[3:])
+
+
+def test_range_load():
+
+  from . import reader
+  f = reader(INPUT_VIDEO)
+  array = f.load()
+
+  assert numpy.array_equal(f.load(start=3, stop=9), array[3:9])
+  assert numpy.array_equal(f.load(start=2, stop=11, step=4), array[2:11:4])
+  assert numpy.array_equal(f.load(start=-4), array[-4:])
+  assert numpy.array_equal(f.load(stop=3), array[:3])
+  nose.tools.eq_(f.load(start=5, stop=5).shape[0], 0)
+  assert numpy.array_equal(f[4:12:3], array[4:12:3])
+  assert numpy.array_equal(f[7], array[7])
+
+  video, meta = f.load(start=1, stop=4, with_meta=True)
+  nose.tools.eq_(meta.shape, (3,))
+  nose.tools.assert_raises(ValueError, f.load, start=4, stop=1, step=-1)
+  nose.tools.assert_raises(ValueError, f.load, start=1, start_s=0.)
+
+
+def test_range_load_without_index():
+
+  from . import reader, writer
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    video = numpy.random.RandomState(0).randint(0, 256, (40, 3, 64, 96)).astype('uint8')
+    outv = writer(tmpname, 64, 96, codec='mpeg4', gop=8)
+    outv.append(video)
+    outv.close()
+    expected, meta = reader(tmpname).load(with_meta=True)
+
+    # range loads seek by timestamp and never scan the whole file
+    f = reader(tmpname)
+    assert numpy.array_equal(f.load(start=27, stop=33), expected[27:33])
+    assert numpy.array_equal(f.load(start=3, stop=40, step=9), expected[3:40:9])
+    loaded, m = f.load(start=10, stop=12, with_meta=True)
+    assert numpy.array_equal(m, meta[10:12])
+    assert not f.indexed
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_float_output():
+
+  from . import reader
+  array = reader(INPUT_VIDEO).load()
+
+  mean = numpy.array([0.485, 0.456, 0.406], 'float32').reshape(3, 1, 1)
+  std = numpy.array([0.229, 0.224, 0.225], 'float32').reshape(3, 1, 1)
+  scale = (1. / 255. / std).flatten()
+  offset = (-mean / std).flatten()
+
+  f = reader(INPUT_VIDEO, dtype='float32', scale=scale, offset=offset)
+  nose.tools.eq_(f.frame_type[0], numpy.dtype('float32'))
+  expected = array.astype('float32') * scale.reshape(3, 1, 1).astype('float32') + offset.reshape(3, 1, 1).astype('float32')
+  video = f.load()
+  nose.tools.eq_(video.dtype, numpy.float32)
+  assert numpy.array_equal(video, expected)
+  assert numpy.array_equal(f[5], expected[5])
+  assert numpy.array_equal(f[6:1:-2], expected[6:1:-2])
+  assert numpy.array_equal(next(iter(f)), expected[0])
+
+  f = reader(INPUT_VIDEO, dtype='float16', scale=1./255)
+  video = f.load()
+  nose.tools.eq_(video.dtype, numpy.float16)
+  assert numpy.array_equal(video, (array.astype('float32') * numpy.float32(1./255)).astype('float16'))
+
+  nose.tools.assert_raises(ValueError, reader, INPUT_VIDEO, scale=2.)
+  nose.tools.assert_raises(ValueError, reader, INPUT_VIDEO, dtype='float64')
+  nose.tools.assert_raises(TypeError, reader, INPUT_VIDEO, dtype='float32', scale=(1., 2.))
+
+
+def test_packed_layout():
+
+  from . import reader, writer
+  array = reader(INPUT_VIDEO).load()
+  packed = array.transpose(0, 2, 3, 1)
+
+  f = reader(INPUT_VIDEO, layout='packed')
+  nose.tools.eq_(f.layout, 'packed')
+  nose.tools.eq_(f.frame_type[1], packed.shape[1:])
+  assert numpy.array_equal(f.load(), packed)
+  assert numpy.array_equal(f[3], packed[3])
+  assert numpy.array_equal(f[8:2:-3], packed[8:2:-3])
+  assert numpy.array_equal(next(iter(f)), packed[0])
+
+  f = reader(INPUT_VIDEO, layout='packed', dtype='float32', scale=(1., 2., 3.))
+  expected = packed.astype('float32') * numpy.array([1., 2., 3.], 'float32')
+  assert numpy.array_equal(f.load(start=2, stop=5), expected[2:5])
+
+  nose.tools.assert_raises(ValueError, reader, INPUT_VIDEO, layout='nhwc')
+
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    outv = writer(tmpname, array.shape[2], array.shape[3], layout='packed')
+    nose.tools.eq_(outv.layout, 'packed')
+    outv.append(packed[:5])
+    outv.append(packed[5])
+    nose.tools.assert_raises(RuntimeError, outv.append, array[6])
+    outv.close()
+
+    written = reader(tmpname).load()
+    nose.tools.eq_(written.shape, (6,) + array.shape[1:])
+    assert abs(written.astype(float) - array[:6]).mean() < 10.
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_native_yuv():
+
+  from . import reader, conversion_isa, set_conversion_isa
+  array = reader(INPUT_VIDEO).load()
+  best = conversion_isa()
+  levels = ['scalar', 'sse2', 'sse4.1', 'avx2', 'avx512']
+  levels = levels[:levels.index(best) + 1]
+
+  try:
+    # the scalar kernels are the reference: close to the scaler's results
+    set_conversion_isa('scalar')
+    f = reader(INPUT_VIDEO, native_yuv=True)
+    assert f.native_yuv
+    expected = f.load()
+    nose.tools.eq_(expected.shape, array.shape)
+    difference = abs(expected.astype('int16') - array.astype('int16'))
+    assert difference.max() <= 8, difference.max()
+    assert difference.mean() < 1., difference.mean()
+
+    # all instruction sets output exactly the same frames
+    for isa in levels:
+      set_conversion_isa(isa)
+      nose.tools.eq_(conversion_isa(), isa)
+      f = reader(INPUT_VIDEO, native_yuv=True)
+      assert numpy.array_equal(f.load(), expected), isa
+      assert numpy.array_equal(f[4], expected[4]), isa
+      assert numpy.array_equal(f[7:1:-2], expected[7:1:-2]), isa
+      f = reader(INPUT_VIDEO, native_yuv=True, dtype='float32', scale=1./255)
+      assert numpy.array_equal(f.load(), expected.astype('float32') * numpy.float32(1./255)), isa
+
+    # packed frames are still converted by the scaler
+    f = reader(INPUT_VIDEO, native_yuv=True, layout='packed')
+    assert numpy.array_equal(f.load(), array.transpose(0, 2, 3, 1))
+
+  finally:
+    set_conversion_isa('')
+
+  nose.tools.eq_(conversion_isa(), best)
+  nose.tools.assert_raises(RuntimeError, set_conversion_isa, 'neon')
+
+
+def test_writer_native_yuv():
+
+  from . import reader, writer, conversion_isa, set_conversion_isa
+  array = reader(INPUT_VIDEO).load()[:8]
+  best = conversion_isa()
+  levels = ['scalar', 'sse2', 'sse4.1', 'avx2', 'avx512']
+  levels = levels[:levels.index(best) + 1]
+
+  def encode(**kwargs):
+    tmpname = test_utils.temporary_filename(suffix='.avi')
+    try:
+      outv = writer(tmpname, array.shape[2], array.shape[3], **kwargs)
+      native = outv.native_yuv
+      outv.append(array)
+      outv.close()
+      return native, reader(tmpname).load()
+    finally:
+      if os.path.exists(tmpname): os.unlink(tmpname)
+
+  try:
+    # all instruction sets feed exactly the same pictures to the encoder
+    set_conversion_isa('scalar')
+    native, expected = encode(native_yuv=True)
+    assert native
+    for isa in levels:
+      set_conversion_isa(isa)
+      assert numpy.array_equal(encode(native_yuv=True)[1], expected), isa
+  finally:
+    set_conversion_isa('')
+
+  # the scaler converts as our kernels do, and stays the default
+  native, scaled = encode()
+  assert not native
+  assert abs(expected.astype(float) - array).mean() < 10.
+  assert abs(expected.astype(float) - scaled).mean() < 2.
+
+  outv = writer(test_utils.temporary_filename(suffix='.avi'), 64, 64, matrix='bt709', full_range=True)
+  nose.tools.eq_(outv.matrix, 'bt709')
+  assert outv.full_range
+  outv.close()
+  os.unlink(outv.filename)
+  nose.tools.assert_raises(ValueError, writer, 'x.avi', 64, 64, matrix='bt2020')
+
+
+def test_motion():
+
+  from . import reader, writer, set_conversion_isa
+  f = reader(INPUT_VIDEO)
+  motion = f.motion()
+  nose.tools.eq_(len(motion), len(f))
+  nose.tools.eq_(motion.dtype.names, ('difference', 'scene_cut'))
+  assert numpy.isnan(motion['difference'][0])
+  assert motion['scene_cut'][0]
+  assert (motion['difference'][1:] >= 0).all()
+  assert (motion['difference'][1:] <= 255).all()
+
+  # ranges are compared to the frame before them
+  part = f.motion(start=5, stop=20)
+  nose.tools.eq_(len(part), 15)
+  assert numpy.array_equal(part['difference'], motion['difference'][5:20])
+
+  # all instruction sets measure the same differences
+  try:
+    set_conversion_isa('scalar')
+    assert numpy.array_equal(reader(INPUT_VIDEO).motion()['difference'][1:],
+        motion['difference'][1:])
+  finally:
+    set_conversion_isa('')
+
+  # a cut from black to white frames
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    video = numpy.zeros((10, 3, 64, 64), dtype='uint8')
+    video[5:] = 255
+    outv = writer(tmpname, 64, 64)
+    outv.append(video)
+    outv.close()
+    motion = reader(tmpname).motion(threshold=50.)
+    nose.tools.eq_(len(motion), 10)
+    assert motion['difference'][5] > 100, motion['difference'][5]
+    assert (motion['difference'][6:] < 5).all()
+    nose.tools.eq_(list(numpy.where(motion['scene_cut'])[0]), [0, 5])
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_motion_vectors():
+
+  from . import reader, writer
+  f = reader(INPUT_VIDEO)
+  vectors = f.motion_vectors()
+  nose.tools.eq_(vectors.dtype.names, ('frame', 'source', 'w', 'h', 'src_x', 'src_y', 'dst_x', 'dst_y'))
+  assert (vectors['frame'] >= 0).all()
+  assert (vectors['frame'] < len(f)).all()
+
+  # ranges select the vectors of their frames
+  part = f.motion_vectors(start=5, stop=20)
+  selected = vectors[(vectors['frame'] >= 5) & (vectors['frame'] < 20)]
+  assert numpy.array_equal(part, selected)
+
+  flow = f.motion_vectors(start=5, stop=20, flow=True, block=8)
+  nose.tools.eq_(flow.shape, (15, 2, (f.height + 7) // 8, (f.width + 7) // 8))
+  nose.tools.eq_(flow.dtype, numpy.float32)
+
+  # a texture moving right by 2 pixels per frame
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    texture = numpy.random.RandomState(0).randint(0, 256, (3, 64, 96)).astype('uint8')
+    texture = texture.repeat(4, axis=1).repeat(4, axis=2)[:, :128, :192]
+    video = numpy.array([numpy.roll(texture, 2 * k, axis=2) for k in range(10)])
+    outv = writer(tmpname, 128, 192)
+    outv.append(video)
+    outv.close()
+    flow = reader(tmpname).motion_vectors(flow=True)
+    nose.tools.eq_(flow.shape, (10, 2, 8, 12))
+    dx = flow[:, 0][flow[:, 0] != 0]
+    assert len(dx), 'the encoder did not predict any block'
+    nose.tools.eq_(numpy.median(dx), 2.)
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_append_remux():
+
+  from . import reader, writer
+  from bob.io.base import File
+
+  tmpname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    video = numpy.random.RandomState(0).randint(0, 256, (8, 3, 64, 96)).astype('uint8')
+    outv = writer(tmpname, 64, 96, codec='mpeg4')
+    outv.append(video[:5])
+    outv.close()
+    before = reader(tmpname).load()
+
+    f = File(tmpname, 'a')
+    f.append(video[5:])
+    del f
+
+    after = reader(tmpname)
+    nose.tools.eq_(len(after), 8)
+    loaded = after.load()
+    # the existing frames were copied, not encoded again
+    assert numpy.array_equal(loaded[:5], before)
+    nose.tools.eq_(after.codec_name, 'mpeg4')
+
+    # new frames are encoded with the group of pictures of the file
+    outv = writer(tmpname, 64, 96, codec='mpeg4', gop=3)
+    outv.append(video[:6])
+    outv.close()
+    f = File(tmpname, 'a')
+    f.append(video[:6])
+    del f
+    loaded, meta = reader(tmpname).load(with_meta=True)
+    nose.tools.eq_(len(loaded), 12)
+    nose.tools.eq_(list(numpy.where(meta['keyframe'])[0]), [0, 3, 6, 9])
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_trim():
+
+  from . import reader, writer, trim
+  from .script.video_trim import main
+
+  inname = test_utils.temporary_filename(suffix='.avi')
+  outname = test_utils.temporary_filename(suffix='.avi')
+  try:
+    video = numpy.random.RandomState(0).randint(0, 256, (20, 3, 64, 96)).astype('uint8')
+    outv = writer(inname, 64, 96, codec='mpeg4', gop=4)
+    outv.append(video)
+    outv.close()
+    original = reader(inname).load()
+
+    # copies from the keyframe before the first frame requested
+    result = trim(inname, outname, start=6, stop=14)
+    nose.tools.eq_(result, {'start': 4, 'frames': 10, 'encoded': 0})
+    assert numpy.array_equal(reader(outname).load(), original[4:14])
+
+    # smart cutting encodes the frames up to the next keyframe again
+    result = trim(inname, outname, start=6, stop=14, smart=True)
+    nose.tools.eq_(result, {'start': 6, 'frames': 8, 'encoded': 2})
+    cut = reader(outname).load()
+    nose.tools.eq_(len(cut), 8)
+    assert numpy.array_equal(cut[2:], original[8:14])
+    assert numpy.abs(cut[:2].astype(float) - original[6:8]).mean() < 30
+
+    nose.tools.assert_raises(ValueError, trim, inname, outname, start=2,
+        end_s=0.5)
+
+    # the command line interface
+    nose.tools.eq_(main([inname, outname, '--start=8']), 0)
+    assert numpy.array_equal(reader(outname).load(), original[8:])
+  finally:
+    for k in (inname, outname):
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_trim_default_codec():
+
+  from . import reader, writer, trim
+
+  video = numpy.random.RandomState(0).randint(0, 256, (30, 3, 64, 96)).astype('uint8')
+  for suffix in ('.avi', '.mp4'):
+    inname = test_utils.temporary_filename(suffix=suffix)
+    outname = test_utils.temporary_filename(suffix=suffix)
+    try:
+      # the writer defaults: one keyframe every 12 frames
+      outv = writer(inname, 64, 96)
+      outv.append(video)
+      outv.close()
+      original = reader(inname).load()
+
+      result = trim(inname, outname, start=5, stop=20, smart=True)
+      if suffix == '.avi':
+        # MPEG-4 in AVI: the output starts at the requested frame
+        nose.tools.eq_(result, {'start': 5, 'frames': 15, 'encoded': 7})
+      else:
+        # H.264 in MP4 cannot be concatenated: copied from the keyframe
+        if reader(inname).codec_name == 'h264':
+          nose.tools.eq_(result['encoded'], 0)
+        nose.tools.eq_(result['frames'], 20 - result['start'])
+
+      # frames after the encoded ones are copied as they are
+      cut = reader(outname).load()
+      assert len(cut) >= result['frames']
+      copied = result['start'] + result['encoded']
+      assert numpy.array_equal(cut[result['encoded']:result['frames']],
+          original[copied:20])
+    finally:
+      for k in (inname, outname):
+        if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_threads():
+
+  from . import reader, writer
+
+  video = numpy.random.RandomState(0).randint(0, 256, (6, 3, 64, 96)).astype('uint8')
+  single = test_utils.temporary_filename(suffix='.avi')
+  sliced = test_utils.temporary_filename(suffix='.avi')
+  try:
+    outv = writer(single, 64, 96, codec='ffv1', threads=1)
+    nose.tools.eq_(outv.threads, 1)
+    nose.tools.eq_(outv.thread_type, 'auto')
+    outv.append(video)
+    outv.close()
+
+    # ffv1 is lossless: slices encoded in parallel decode to the same frames
+    outv = writer(sliced, 64, 96, codec='ffv1', threads=2,
+        thread_type='slice', slices=4)
+    nose.tools.eq_(outv.thread_type, 'slice')
+    nose.tools.eq_(outv.slices, 4)
+    outv.append(video)
+    outv.close()
+    assert numpy.array_equal(reader(sliced).load(), reader(single).load())
+
+    nose.tools.assert_raises(ValueError, writer, sliced, 64, 96,
+        thread_type='fibers')
+  finally:
+    for k in (single, sliced):
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_options():
+
+  from . import reader, writer
+
+  video = numpy.random.RandomState(0).randint(0, 256, (10, 3, 64, 96)).astype('uint8')
+  tmpname = test_utils.temporary_filename(suffix='.mov')
+  try:
+    # codec options (here, the group of pictures) and muxer ones are used
+    outv = writer(tmpname, 64, 96, codec='mpeg4',
+        options={'g': 3, 'movflags': 'faststart'})
+    outv.append(video)
+    outv.close()
+    video, meta = reader(tmpname).load(with_meta=True)
+    nose.tools.eq_(list(numpy.where(meta['keyframe'])[0]), [0, 3, 6, 9])
+
+    # booleans are passed as FFmpeg takes them
+    data = []
+    for partitioned in (False, True):
+      outv = writer(tmpname, 64, 96, codec='mpeg4',
+          options={'data_partitioning': partitioned})
+      outv.append(video)
+      outv.close()
+      nose.tools.eq_(len(reader(tmpname).load()), len(video))
+      with open(tmpname, 'rb') as f: data.append(f.read())
+    assert data[0] != data[1]
+
+    # unknown options are reported
+    nose.tools.assert_raises(RuntimeError, writer, tmpname, 64, 96,
+        codec='mpeg4', options={'no_such_option': 1})
+    nose.tools.assert_raises(TypeError, writer, tmpname, 64, 96,
+        options=[('g', 3)])
+  finally:
+    if os.path.exists(tmpname): os.unlink(tmpname)
+
+
+def test_writer_queue():
+
+  from . import reader, writer
+
+  video = numpy.random.RandomState(0).randint(0, 256, (20, 3, 64, 96)).astype('uint8')
+  sync = test_utils.temporary_filename(suffix='.avi')
+  queued = test_utils.temporary_filename(suffix='.avi')
+  try:
+    outv = writer(sync, 64, 96, codec='mpeg4', threads=1)
+    outv.append(video)
+    outv.close()
+
+    outv = writer(queued, 64, 96, codec='mpeg4', threads=1, queue_size=4)
+    nose.tools.eq_(outv.queue_size, 4)
+    for frame in video: outv.append(frame)
+    nose.tools.eq_(len(outv), 20)
+    outv.close()
+
+    # frames are encoded the same way, on another thread
+    assert numpy.array_equal(reader(queued).load(), reader(sync).load())
+  finally:
+    for k in (sync, queued):
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_planes():
+
+  from . import reader, writer
+
+  luma = numpy.random.RandomState(0).randint(0, 256, (5, 64, 96)).astype('uint8')
+  neutral = numpy.full((32, 48), 128, dtype='uint8')
+  gray = test_utils.temporary_filename(suffix='.avi')
+  yuv = test_utils.temporary_filename(suffix='.avi')
+  try:
+    outv = writer(gray, 64, 96, codec='ffv1', full_range=True)
+    for frame in luma: outv.append(frame)
+    nose.tools.eq_(len(outv), 5)
+    outv.close()
+
+    # full range luma, with neutral chroma, decodes to the same gray levels
+    loaded = reader(gray).load().astype(int)
+    for band in range(3):
+      assert numpy.abs(loaded[:, band] - luma).max() <= 1
+
+    # Y, U and V planes go the same way, also through the queue
+    outv = writer(yuv, 64, 96, codec='ffv1', full_range=True, queue_size=2)
+    for frame in luma: outv.append((frame, neutral, neutral))
+    outv.close()
+    assert numpy.array_equal(reader(yuv).load(), reader(gray).load())
+
+    outv = writer(yuv, 64, 96, codec='ffv1')
+    nose.tools.assert_raises(RuntimeError, outv.append, luma[0][:32])
+    nose.tools.assert_raises(RuntimeError, outv.append,
+        (luma[0], neutral, neutral[:16]))
+    nose.tools.assert_raises(TypeError, outv.append, (luma[0], neutral))
+    outv.close()
+  finally:
+    for k in (gray, yuv):
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_strided():
+
+  from . import reader, writer
+
+  big = numpy.random.RandomState(0).randint(0, 256, (4, 3, 80, 120)).astype('uint8')
+  crop = big[:, :, 8:72, 10:106] # rows and bands apart, contiguous pixels
+  names = [test_utils.temporary_filename(suffix='.avi') for k in range(4)]
+  try:
+    for native in (True, False):
+      outv = writer(names[0], 64, 96, codec='mpeg4', threads=1, native_yuv=native)
+      outv.append(numpy.ascontiguousarray(crop))
+      outv.close()
+      expected = reader(names[0]).load()
+
+      # crops, views with the bands last and frames with scattered pixels
+      for name, video in zip(names[1:], (crop,
+          numpy.ascontiguousarray(crop.transpose(0, 2, 3, 1)).transpose(0, 3, 1, 2),
+          numpy.ascontiguousarray(crop[:, :, :, ::-1])[:, :, :, ::-1])):
+        outv = writer(name, 64, 96, codec='mpeg4', threads=1, native_yuv=native)
+        for frame in video: outv.append(frame)
+        outv.close()
+        assert numpy.array_equal(reader(name).load(), expected)
+  finally:
+    for k in names:
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_memory():
+
+  import io
+  from . import reader, writer
+
+  class Sink(object):
+    """A file-like object that cannot seek, as a pipe or a socket"""
+    def __init__(self): self.chunks = []
+    def write(self, data): self.chunks.append(bytes(data)); return len(data)
+
+  video = numpy.random.RandomState(0).randint(0, 256, (5, 3, 64, 96)).astype('uint8')
+  names = [test_utils.temporary_filename(suffix='.mp4') for k in range(3)]
+  try:
+    outv = writer(names[0], 64, 96, codec='mpeg4', threads=1)
+    for frame in video: outv.append(frame)
+    assert outv.close() is None
+    expected = reader(names[0]).load()
+
+    # in memory, the same bytes as in a file
+    outv = writer(None, 64, 96, codec='mpeg4', format='mp4', threads=1)
+    for frame in video: outv.append(frame)
+    data = outv.close()
+    assert isinstance(data, bytes)
+    with open(names[0], 'rb') as f: assert f.read() == data
+
+    # seekable file-like objects
+    buf = io.BytesIO()
+    outv = writer(buf, 64, 96, codec='mpeg4', format='mp4', threads=1)
+    for frame in video: outv.append(frame)
+    assert outv.close() is None
+    assert buf.getvalue() == data
+
+    # objects that cannot seek get a fragmented mp4
+    sink = Sink()
+    outv = writer(sink, 64, 96, codec='mpeg4', format='mp4', threads=1)
+    for frame in video: outv.append(frame)
+    outv.close()
+    with open(names[1], 'wb') as f: f.write(b''.join(sink.chunks))
+    assert numpy.array_equal(reader(names[1]).load(), expected)
+
+    # errors raised by the object are reported
+    class Broken(Sink):
+      def write(self, data): raise IOError("disk full")
+    def write_broken():
+      outv = writer(Broken(), 64, 96, codec='mpeg4', format='mp4')
+      for frame in video: outv.append(frame)
+      outv.close()
+    nose.tools.assert_raises((IOError, RuntimeError), write_broken)
+
+    # frames cannot be queued for python objects
+    nose.tools.assert_raises(ValueError, writer, Sink(), 64, 96,
+        codec='mpeg4', format='mp4', queue_size=2)
+  finally:
+    for k in names:
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_output_mode():
+
+  import io
+  from . import reader, writer
+
+  video = numpy.random.RandomState(0).randint(0, 256, (12, 3, 64, 96)).astype('uint8')
+  names = [test_utils.temporary_filename(suffix='.mp4') for k in range(3)]
+  try:
+    outv = writer(names[0], 64, 96, codec='mpeg4', gop=4, threads=1)
+    nose.tools.eq_(outv.output_mode, 'default')
+    for frame in video: outv.append(frame)
+    outv.close()
+    expected = reader(names[0]).load()
+    with open(names[0], 'rb') as f: data = f.read()
+    assert data.find(b'moov') > data.find(b'mdat') # index at the end
+
+    # fragmented files can be decoded while they are written
+    outv = writer(names[1], 64, 96, codec='mpeg4', gop=4, threads=1,
+        output_mode='fragmented')
+    nose.tools.eq_(outv.output_mode, 'fragmented')
+    for frame in video[:10]: outv.append(frame)
+    with open(names[1], 'rb') as f: partial = f.read()
+    frames = [k for k in reader(io.BytesIO(partial))]
+    assert len(frames) >= 4 # at least the first fragment
+    for k, frame in enumerate(frames):
+      assert numpy.array_equal(frame, expected[k])
+    for frame in video[10:]: outv.append(frame)
+    outv.close()
+    assert numpy.array_equal(reader(names[1]).load(), expected)
+
+    # faststart files have their index first
+    outv = writer(names[2], 64, 96, codec='mpeg4', gop=4, threads=1,
+        output_mode='faststart')
+    for frame in video: outv.append(frame)
+    outv.close()
+    with open(names[2], 'rb') as f: data = f.read()
+    assert data.find(b'moov') < data.find(b'mdat')
+    f = reader(io.BytesIO(data))
+    assert numpy.array_equal(f.load(), expected)
+
+    # only for MP4 and QuickTime files, and faststart only for files
+    avi = test_utils.temporary_filename(suffix='.avi')
+    try:
+      nose.tools.assert_raises(RuntimeError, writer, avi, 64, 96,
+          output_mode='fragmented')
+    finally:
+      if os.path.exists(avi): os.unlink(avi)
+    nose.tools.assert_raises(RuntimeError, writer, None, 64, 96,
+        codec='mpeg4', format='mp4', output_mode='faststart')
+    nose.tools.assert_raises(ValueError, writer, names[2], 64, 96,
+        output_mode='progressive')
+  finally:
+    for k in names:
+      if os.path.exists(k): os.unlink(k)
+
+
+def test_writer_segments():
+
+  import glob
+  from . import reader, writer
+
+  video = numpy.random.RandomState(0).randint(0, 256, (12, 3, 64, 96)).astype('uint8')
+  base = test_utils.temporary_filename(suffix='')
+  try:
+    # in frames, each segment starting with a keyframe
+    pattern = base + '-%02d.mp4'
+    outv = writer(pattern, 64, 96, codec='mpeg4', gop=12, threads=1,
+        segment_frames=4)
+    nose.tools.eq_(outv.segments, [base + '-00.mp4'])
+    for frame in video[:10]: outv.append(frame)
+    segments = outv.segments
+    nose.tools.eq_(segments, [base + '-%02d.mp4' % k for k in range(3)])
+    assert os.path.exists(segments[0]) and os.path.exists(segments[1])
+    outv.close()
+    lengths = []
+    for name in segments:
+      frames, meta = reader(name).load(with_meta=True)
+      assert meta['keyframe'][0]
+      lengths.append(len(frames))
+    nose.tools.eq_(lengths, [4, 4, 2])
+
+    # in seconds, from a queue: only files the muxer opened are listed
+    pattern = base + '-s%d.avi'
+    outv = writer(pattern, 64, 96, framerate=10, codec='mpeg4', threads=1,
+        segment_seconds=0.5, queue_size=4)
+    outv.append(video)
+    segments = outv.segments
+    nose.tools.eq_(segments, [base + '-s%d.avi' % k for k in range(len(segments))])
+    assert all(os.path.exists(k) for k in segments)
+    outv.close()
+    nose.tools.eq_(outv.segments, [base + '-s%d.avi' % k for k in range(3)])
+    nose.tools.eq_([len(reader(k)) for k in outv.segments], [5, 5, 2])
+
+    # not both lengths, only with patterns and files
+    nose.tools.assert_raises(RuntimeError, writer, pattern, 64, 96,
+        segment_frames=4, segment_seconds=1.)
+    nose.tools.assert_raises(RuntimeError, writer, base + '.avi', 64, 96,
+        segment_frames=4)
+    nose.tools.assert_raises(ValueError, writer, None, 64, 96,
+        format='avi', segment_frames=4)
+    nose.tools.assert_raises(ValueError, writer, pattern, 64, 96,
+        segment_frames=-1)
+  finally:
+    for k in glob.glob(base + '*'): os.unlink(k)
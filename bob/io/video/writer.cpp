@@ -23,8 +23,8 @@ static auto s_writer = bob::extension::ClassDoc(
     "If you set the ``check`` parameter to ``False``, though, we will ignore this check.",
     true
   )
-  .add_prototype("filename, height, width, [framerate], [bitrate], [gop], [codec], [format], [check]", "")
-  .add_parameter("filename", "str", "The file path to the file you want to write data to")
+  .add_prototype("target, height, width, [framerate], [bitrate], [gop], [codec], [format], [check], [layout], [matrix], [full_range], [native_yuv], [threads], [thread_type], [slices], [options], [queue_size], [output_mode], [segment_frames], [segment_seconds]", "")
+  .add_parameter("target", "str, file-like or None", "The file path to the file you want to write data to, a writable file-like object (with a ``write()`` method, and ``seek()`` if its ``seekable()`` method says so), or ``None`` to write the video in memory, which :py:meth:`close` returns. For targets other than files, ``format`` should be given, unless the ``name`` of the file-like object has a known extension. MP4 and QuickTime videos written to objects that cannot seek are fragmented, unless ``output_mode`` or the ``movflags`` option says otherwise")
   .add_parameter("height", "int", "The height of the video (must be a multiple of 2)")
   .add_parameter("width", "int", "The width of the video (must be a multiple of 2)")
   .add_parameter("framerate", "float", "[Default: 25.] The number of frames per second")
@@ -33,13 +33,138 @@ static auto s_writer = bob::extension::ClassDoc(
   .add_parameter("codec", "str", "[Default: ``''``] If you must, specify a valid FFmpeg codec name here and that will be used to encode the video stream on the output file")
   .add_parameter("format", "str", "[Default: ``''``] If you must, specify a valid FFmpeg output format name and that will be used to encode the video on the output file. Leave it empty to guess from the filename extension")
   .add_parameter("check", "bool", "[Default: ``True``] ")
+  .add_parameter("layout", "str", "[Default: ``'planar'``] The layout of the frames to append: ``'planar'``, as in (color-bands, height, width), or ``'packed'``, as in (height, width, color-bands), the one used by OpenCV, PIL or TensorFlow. Packed frames are fed to the encoder without reordering")
+  .add_parameter("matrix", "str", "[Default: ``'bt601'``] The colour matrix used to convert frames to the YUV pictures the encoder takes, ``'bt601'`` or ``'bt709'`` (for high definition videos), which is also recorded in the stream")
+  .add_parameter("full_range", "bool", "[Default: ``False``] If set, YUV pictures use the full range of values (as in JPEG), instead of the limited 16-235 range for luma. Encoders that only take full range pictures (e.g. MJPEG) always use it")
+  .add_parameter("native_yuv", "bool", "[Default: ``False``] If set, ``'planar'`` frames are converted to ``yuv420p`` or ``yuvj420p`` pictures by our own SIMD kernels instead of FFmpeg's software scaler, when the encoder takes such pictures. The kernels average chroma over 2x2 pixels, where the scaler filters it bicubically, so the pictures encoded differ slightly. See :py:func:`conversion_isa`")
+  .add_parameter("threads", "int", "[Default: 0] The number of threads the encoder runs on, or 0 to let it pick one per core")
+  .add_parameter("thread_type", "str", "[Default: ``'auto'``] How the encoder spreads its work over threads: ``'frame'`` encodes several frames at once (delaying the output by one frame per thread), ``'slice'`` several slices of each frame at once and ``'auto'`` uses the best method the encoder supports. Encoders that do not support the method requested run on a single thread")
+  .add_parameter("slices", "int", "[Default: 0] The number of slices each frame is split in, or 0 to keep the encoder default. FFV1 only encodes slices in parallel, and takes 4, 6, 9, 12, 16, 20, 24, 30... of them")
+  .add_parameter("options", "dict", "[Default: ``None``] Options for the encoder and the muxer, by name, as FFmpeg takes them on the command line (e.g. ``{'preset': 'ultrafast', 'crf': 23}`` for ``libx264`` or ``{'movflags': 'faststart'}`` for MP4 files). Values are converted to strings. Options that neither the encoder nor the muxer know, or values they reject, raise an exception")
+  .add_parameter("queue_size", "int", "[Default: 0] If positive, :py:meth:`append` copies frames into a queue of this size and returns, while a background thread converts, encodes and writes them: :py:meth:`append` only waits when the queue is full. Errors of the background thread are raised by the following calls to :py:meth:`append` and by :py:meth:`close`. If 0, frames are encoded by :py:meth:`append` itself")
+  .add_parameter("output_mode", "str", "[Default: ``'default'``] How MP4 and QuickTime files are laid out: ``'default'`` puts the index at the end, so readers must wait for the file to be closed and seek to its end, ``'fragmented'`` writes fragments indexed as they are written (one per ``gop`` frames), so readers can decode the file while it is written, without seeking, and ``'faststart'`` moves the index to the front when closing the file, so readers can decode it without seeking. Faststart is only available for files. Other formats raise an exception unless ``'default'``")
+  .add_parameter("segment_frames", "int", "[Default: 0] If positive, the video is split in files of this many frames as it is written, for instance to process long recordings in parallel: ``target`` is then a file name pattern with the number of each file, as in ``'video-%03d.mp4'``. The same encoder is used for all files, each starting with a keyframe (forced at the boundary) and timestamps restarting at zero. Files are closed as soon as the next one starts. See :py:attr:`segments`")
+  .add_parameter("segment_seconds", "float", "[Default: 0.] The same as ``segment_frames``, for files of this many seconds. Only one of them may be given")
 );
 static auto s_fullname = BOB_EXT_MODULE_PREFIX ".writer";
 
 
+/**
+ * Converts a dictionary of encoder and muxer options into strings, for use
+ * with the ``O&`` argument parser. Booleans become "1" or "0", which all
+ * FFmpeg options taking flags accept, other values are passed through
+ * ``str()``. ``None`` keeps no options. Returns 1 in case of success, 0 in
+ * case of failure.
+ */
+static int options_converter(PyObject* o, bob::io::video::Options* options) {
+  if (o == Py_None) return 1;
+  if (!PyDict_Check(o)) {
+    PyErr_Format(PyExc_TypeError, "encoder and muxer options should be given as a dictionary, not `%s'", Py_TYPE(o)->tp_name);
+    return 0;
+  }
+  PyObject* key = 0;
+  PyObject* value = 0;
+  Py_ssize_t pos = 0;
+  const char* k = 0;
+  const char* v = 0;
+  while (PyDict_Next(o, &pos, &key, &value)) {
+    if (!PyArg_Parse(key, "s", &k)) return 0;
+    if (PyBool_Check(value)) {
+      (*options)[k] = (value == Py_True)? "1" : "0";
+      continue;
+    }
+    PyObject* str = PyObject_Str(value);
+    if (!str) return 0;
+    auto str_ = make_safe(str);
+    if (!PyArg_Parse(str, "s", &v)) return 0;
+    (*options)[k] = v;
+  }
+  return 1;
+}
+
+/**
+ * Writes data to a Python file-like object, using its write() method, and
+ * seek() if its seekable() method returns true. If they raise, the Python
+ * error is kept set and FFmpeg sees an I/O error. Only used on the thread
+ * holding the GIL (writers with a queue cannot write to such objects).
+ */
+class PythonOutputStream: public bob::io::video::OutputStream {
+
+  public:
+
+    PythonOutputStream(PyObject* o, const std::string& name) :
+      bob::io::video::OutputStream(name),
+      m_object(o),
+      m_seekable(false)
+    {
+      Py_INCREF(m_object);
+      if (PyObject_HasAttrString(m_object, "seekable")) {
+        PyObject* r = PyObject_CallMethod(m_object,
+            const_cast<char*>("seekable"), 0);
+        if (r) m_seekable = PyObject_IsTrue(r) > 0;
+        else PyErr_Clear(); ///< considered not seekable
+        Py_XDECREF(r);
+      }
+    }
+
+    virtual ~PythonOutputStream() {
+      Py_DECREF(m_object);
+    }
+
+    virtual int write(const uint8_t* buffer, int size) {
+      if (PyErr_Occurred()) return AVERROR(EIO); ///< failed before
+      PyObject* r = PyObject_CallMethod(m_object, const_cast<char*>("write"),
+          const_cast<char*>("y#"), buffer, (Py_ssize_t)size);
+      if (!r) return AVERROR(EIO);
+      Py_DECREF(r);
+      return size;
+    }
+
+    virtual bool seekable() const {
+      return m_seekable;
+    }
+
+    virtual int64_t seek(int64_t offset, int whence) {
+      if (whence & AVSEEK_SIZE) return AVERROR(ENOSYS);
+      if (PyErr_Occurred()) return AVERROR(EIO); ///< failed before
+      PyObject* r = PyObject_CallMethod(m_object, const_cast<char*>("seek"),
+          const_cast<char*>("Li"), (long long)offset, whence & ~AVSEEK_FORCE);
+      if (!r) return AVERROR(EIO);
+      auto r_ = make_safe(r);
+      long long pos = PyLong_AsLongLong(r);
+      if (pos == -1 && PyErr_Occurred()) return AVERROR(EIO);
+      return pos;
+    }
+
+  private:
+
+    PyObject* m_object; ///< the file-like object we write to
+    bool m_seekable; ///< if seek() may be used
+
+};
+
+/**
+ * A name for a Python file-like object: its ``name`` attribute, if it is a
+ * string (so the output format can be guessed from it), or its type
+ */
+static std::string stream_name(PyObject* o) {
+  std::string retval = std::string("<") + Py_TYPE(o)->tp_name + ">";
+  PyObject* name = PyObject_GetAttrString(o, "name");
+  if (!name) {
+    PyErr_Clear();
+    return retval;
+  }
+  auto name_ = make_safe(name);
+  const char* c = 0;
+  if (PyUnicode_Check(name) && (c = PyUnicode_AsUTF8(name))) retval = c;
+  PyErr_Clear();
+  return retval;
+}
+
 static void PyBobIoVideoWriter_Delete (PyBobIoVideoWriterObject* o) {
 
   o->v.reset();
+  o->memory.reset();
   Py_TYPE(o)->tp_free((PyObject*)o);
 
 }
@@ -52,7 +177,7 @@ BOB_TRY
   /* Parses input arguments in a single shot */
   char** kwlist = s_writer.kwlist();
 
-  char* filename = 0;
+  PyObject* target = 0;
 
   Py_ssize_t height = 0;
   Py_ssize_t width = 0;
@@ -63,18 +188,80 @@ BOB_TRY
   char* codec = 0;
   char* format = 0;
   PyObject* pycheck = Py_True;
-
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "snn|ddnssO", kwlist,
-        &filename,
+  bob::io::video::WriterSettings settings;
+  PyObject* pyfull_range = Py_False;
+  PyObject* pynative = Py_False;
+  Py_ssize_t threads = 0;
+  Py_ssize_t slices = 0;
+  Py_ssize_t queue_size = 0;
+  Py_ssize_t segment_frames = 0;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "Onn|ddnssOO&O&OOnO&nO&nO&nd", kwlist,
+        &target,
         &height, &width, &framerate, &bitrate, &gop, &codec,
-        &format, &pycheck)) return -1;
+        &format, &pycheck, &PyBobIoVideo_LayoutConverter, &settings.layout,
+        &PyBobIoVideo_MatrixConverter, &settings.matrix, &pyfull_range,
+        &pynative, &threads, &PyBobIoVideo_ThreadTypeConverter,
+        &settings.thread_type, &slices, &options_converter, &settings.options,
+        &queue_size, &PyBobIoVideo_OutputModeConverter, &settings.output_mode,
+        &segment_frames, &settings.segment_seconds)) return -1;
+
+  if (threads < 0 || slices < 0) {
+    PyErr_Format(PyExc_ValueError, "`%s' constructor requires non-negative numbers of threads and slices, not %" PY_FORMAT_SIZE_T "d and %" PY_FORMAT_SIZE_T "d", Py_TYPE(self)->tp_name, threads, slices);
+    return -1;
+  }
+
+  if (segment_frames < 0 || settings.segment_seconds < 0.) {
+    PyErr_Format(PyExc_ValueError, "`%s' constructor requires non-negative segment lengths, not %" PY_FORMAT_SIZE_T "d frames and %g seconds", Py_TYPE(self)->tp_name, segment_frames, settings.segment_seconds);
+    return -1;
+  }
+
+  if (queue_size < 0) {
+    PyErr_Format(PyExc_ValueError, "`%s' constructor requires a non-negative queue size, not %" PY_FORMAT_SIZE_T "d", Py_TYPE(self)->tp_name, queue_size);
+    return -1;
+  }
 
   std::string codec_str = codec?codec:"";
   std::string format_str = format?format:"";
   bool check = PyObject_IsTrue(pycheck);
+  settings.full_range = PyObject_IsTrue(pyfull_range);
+  settings.threads = threads;
+  settings.slices = slices;
+  settings.segment_frames = segment_frames;
+
+  boost::shared_ptr<bob::io::video::OutputStream> stream;
+  if (target == Py_None) {
+    self->memory = boost::make_shared<bob::io::video::MemoryOutputStream>();
+    stream = self->memory;
+  }
+  else if (PyObject_HasAttrString(target, "write")) {
+    if (queue_size) {
+      PyErr_Format(PyExc_ValueError, "`%s' cannot queue frames when writing to a Python object (%s), as it is only called from the Python thread", Py_TYPE(self)->tp_name, Py_TYPE(target)->tp_name);
+      return -1;
+    }
+    stream.reset(new PythonOutputStream(target, stream_name(target)));
+  }
+
+  if (stream && (segment_frames || settings.segment_seconds > 0.)) {
+    PyErr_Format(PyExc_ValueError, "`%s' can only split videos written to files in segments, not videos written to `%s'", Py_TYPE(self)->tp_name, Py_TYPE(target)->tp_name);
+    return -1;
+  }
 
-  self->v = boost::make_shared<bob::io::video::Writer>(filename,
-      height, width, framerate, bitrate, gop, codec_str, format_str, check);
+  if (stream) {
+    self->v = boost::make_shared<bob::io::video::Writer>(stream,
+        height, width, framerate, bitrate, gop, codec_str, format_str, check,
+        settings);
+    if (PyErr_Occurred()) return -1; ///< raised while writing the header
+  }
+  else {
+    const char* filename = 0;
+    if (!PyArg_Parse(target, "s", &filename)) return -1;
+    self->v = boost::make_shared<bob::io::video::Writer>(filename,
+        height, width, framerate, bitrate, gop, codec_str, format_str, check,
+        settings);
+  }
+  self->v->set_native_yuv(PyObject_IsTrue(pynative));
+  self->v->set_queue_size(queue_size);
 
   return 0; ///< SUCCESS
 BOB_CATCH_MEMBER("constructor", -1)
@@ -89,6 +276,111 @@ PyObject* PyBobIoVideoWriter_Filename(PyBobIoVideoWriterObject* self) {
   return Py_BuildValue("s", self->v->filename().c_str());
 }
 
+static auto s_layout = bob::extension::VariableDoc(
+  "layout",
+  "str",
+  "The layout of the frames to append: ``'planar'`` (color-bands, height, width) or ``'packed'`` (height, width, color-bands)"
+);
+PyObject* PyBobIoVideoWriter_Layout(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("s", PyBobIoVideo_LayoutAsString(self->v->layout()));
+}
+
+static auto s_matrix = bob::extension::VariableDoc(
+  "matrix",
+  "str",
+  "The colour matrix of the encoded YUV pictures: ``'bt601'`` or ``'bt709'``"
+);
+PyObject* PyBobIoVideoWriter_Matrix(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("s", PyBobIoVideo_MatrixAsString(self->v->matrix()));
+}
+
+static auto s_full_range = bob::extension::VariableDoc(
+  "full_range",
+  "bool",
+  "``True`` if the encoded YUV pictures use the full range of values"
+);
+PyObject* PyBobIoVideoWriter_FullRange(PyBobIoVideoWriterObject* self) {
+  if (self->v->full_range()) Py_RETURN_TRUE;
+  Py_RETURN_FALSE;
+}
+
+static auto s_native_yuv = bob::extension::VariableDoc(
+  "native_yuv",
+  "bool",
+  "``True`` if frames are converted to YUV pictures by our own SIMD kernels instead of FFmpeg's software scaler"
+);
+PyObject* PyBobIoVideoWriter_NativeYUV(PyBobIoVideoWriterObject* self) {
+  if (self->v->native_yuv()) Py_RETURN_TRUE;
+  Py_RETURN_FALSE;
+}
+
+static auto s_threads = bob::extension::VariableDoc(
+  "threads",
+  "int",
+  "The number of threads the encoder runs on: 1 if it does not support the threading method requested, 0 for encoders that manage their threads themselves (e.g. libx264) and were left to pick their number"
+);
+PyObject* PyBobIoVideoWriter_Threads(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("n", self->v->threads());
+}
+
+static auto s_thread_type = bob::extension::VariableDoc(
+  "thread_type",
+  "str",
+  "The threading method requested for the encoder: ``'auto'``, ``'frame'`` or ``'slice'``"
+);
+PyObject* PyBobIoVideoWriter_ThreadType(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("s", PyBobIoVideo_ThreadTypeAsString(self->v->thread_type()));
+}
+
+static auto s_slices = bob::extension::VariableDoc(
+  "slices",
+  "int",
+  "The number of slices each frame is split in, or 0 for the encoder default"
+);
+PyObject* PyBobIoVideoWriter_Slices(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("n", self->v->slices());
+}
+
+static auto s_output_mode = bob::extension::VariableDoc(
+  "output_mode",
+  "str",
+  "How MP4 and QuickTime files are laid out: ``'default'`` (the index at the end), ``'fragmented'`` or ``'faststart'`` (the index at the front). Always ``'default'`` for other formats"
+);
+PyObject* PyBobIoVideoWriter_OutputMode(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("s", PyBobIoVideo_OutputModeAsString(self->v->output_mode()));
+}
+
+static auto s_segments = bob::extension::VariableDoc(
+  "segments",
+  "[str]",
+  "The names of the files the muxer has opened so far for a video split in segments (see ``segment_frames`` and ``segment_seconds``), or the name of the only file written. The last one is being written, and the ones before it are closed and complete. Frames still queued (see :py:attr:`queue_size`) or delayed by the encoder may go to files not listed yet: after :py:meth:`close`, all files are listed"
+);
+PyObject* PyBobIoVideoWriter_Segments(PyBobIoVideoWriterObject* self) {
+BOB_TRY
+  std::vector<std::string> segments = self->v->segments();
+  PyObject* retval = PyList_New(segments.size());
+  if (!retval) return 0;
+  for (size_t k=0; k<segments.size(); ++k) {
+    PyObject* name = Py_BuildValue("s", segments[k].c_str());
+    if (!name) {
+      Py_DECREF(retval);
+      return 0;
+    }
+    PyList_SET_ITEM(retval, k, name);
+  }
+  return retval;
+BOB_CATCH_MEMBER("segments", 0)
+}
+
+static auto s_queue_size = bob::extension::VariableDoc(
+  "queue_size",
+  "int",
+  "The number of frames :py:meth:`append` may queue for the background thread that encodes them, or 0 if frames are encoded by :py:meth:`append` itself"
+);
+PyObject* PyBobIoVideoWriter_QueueSize(PyBobIoVideoWriterObject* self) {
+  return Py_BuildValue("n", self->v->queue_size());
+}
+
 static auto s_height = bob::extension::VariableDoc(
   "height",
   "int",
@@ -261,6 +553,76 @@ static PyGetSetDef PyBobIoVideoWriter_getseters[] = {
       s_filename.doc(),
       0,
     },
+    {
+      s_layout.name(),
+      (getter)PyBobIoVideoWriter_Layout,
+      0,
+      s_layout.doc(),
+      0,
+    },
+    {
+      s_matrix.name(),
+      (getter)PyBobIoVideoWriter_Matrix,
+      0,
+      s_matrix.doc(),
+      0,
+    },
+    {
+      s_full_range.name(),
+      (getter)PyBobIoVideoWriter_FullRange,
+      0,
+      s_full_range.doc(),
+      0,
+    },
+    {
+      s_native_yuv.name(),
+      (getter)PyBobIoVideoWriter_NativeYUV,
+      0,
+      s_native_yuv.doc(),
+      0,
+    },
+    {
+      s_threads.name(),
+      (getter)PyBobIoVideoWriter_Threads,
+      0,
+      s_threads.doc(),
+      0,
+    },
+    {
+      s_thread_type.name(),
+      (getter)PyBobIoVideoWriter_ThreadType,
+      0,
+      s_thread_type.doc(),
+      0,
+    },
+    {
+      s_slices.name(),
+      (getter)PyBobIoVideoWriter_Slices,
+      0,
+      s_slices.doc(),
+      0,
+    },
+    {
+      s_queue_size.name(),
+      (getter)PyBobIoVideoWriter_QueueSize,
+      0,
+      s_queue_size.doc(),
+      0,
+    },
+    {
+      s_segments.name(),
+      (getter)PyBobIoVideoWriter_Segments,
+      0,
+      s_segments.doc(),
+      0,
+    },
+    {
+      s_output_mode.name(),
+      (getter)PyBobIoVideoWriter_OutputMode,
+      0,
+      s_output_mode.doc(),
+      0,
+    },
     {
       s_height.name(),
       (getter)PyBobIoVideoWriter_Height,
@@ -391,13 +753,18 @@ static auto s_append = bob::extension::FunctionDoc(
   "Writes a new frame or set of frames to the file.",
   "The frame should be setup as a array with 3 dimensions organized in this way (RGB color-bands, height, width). "
   "Sets of frames should be setup as a 4D array in this way: (frame-number, RGB color-bands, height, width). "
+  "For writers with a ``'packed'`` :py:attr:`layout`, color-bands come last instead: (height, width, RGB color-bands). "
   "Arrays should contain only unsigned integers of 8 bits.\n\n"
-  ".. note::\n"
-  "  At present time we only support arrays that have C-style storages (if you pass reversed arrays or arrays with Fortran-style storage, the result is undefined).",
+  "Grayscale frames may be given as 2D arrays (height, width): their values are used as the luma of the encoded pictures, with neutral chroma, so they should be in the range of the writer (see :py:attr:`full_range`). "
+  "Pictures already in YUV may be given as a tuple of their Y (height, width), U and V (height/2, width/2) planes, as in ``yuv420p`` pictures, in the colour matrix and range of the writer. "
+  "For encoders that take ``yuv420p`` or ``yuvj420p`` pictures, both are copied as they are, without converting them to RGB and back.\n\n"
+  "Writers with a positive :py:attr:`queue_size` copy the frames into their queue and return, waiting only if it is full; errors encoding previous frames are raised here.\n\n"
+  "Frames and planes are read in place if the pixels of their rows are contiguous, as in crops of larger arrays, whatever the distance between their rows and color-bands. "
+  "Others are copied first.",
   true
 )
 .add_prototype("frame")
-.add_parameter("frame", "3D or 4D :py:class:`numpy.ndarray` of ``uint8``", "The frame or set of frames to write")
+.add_parameter("frame", "2D, 3D or 4D :py:class:`numpy.ndarray` of ``uint8``, or a tuple of three 2D ones", "The frame or set of frames to write, a grayscale frame or the Y, U and V planes of a picture")
 ;
 static PyObject* PyBobIoVideoWriter_Append(PyBobIoVideoWriterObject* self, PyObject *args, PyObject* kwds) {
 BOB_TRY
@@ -409,12 +776,44 @@ BOB_TRY
 
   char** kwlist = s_append.kwlist();
 
+  PyObject* input = 0;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &input)) return 0;
+
+  // Y, U and V planes
+  if (PyTuple_Check(input)) {
+    PyBlitzArrayObject* y = 0;
+    PyBlitzArrayObject* u = 0;
+    PyBlitzArrayObject* v = 0;
+    if (!PyArg_ParseTuple(input, "O&O&O&", &PyBlitzArray_Converter, &y,
+          &PyBlitzArray_Converter, &u, &PyBlitzArray_Converter, &v)) {
+      Py_XDECREF(y);
+      Py_XDECREF(u);
+      return 0;
+    }
+    auto y_ = make_safe(y);
+    auto u_ = make_safe(u);
+    auto v_ = make_safe(v);
+    PyBlitzArrayObject* planes[] = {y, u, v};
+    for (int k=0; k<3; ++k) {
+      if (planes[k]->ndim != 2 || planes[k]->type_num != NPY_UINT8) {
+        PyErr_Format(PyExc_TypeError, "Y, U and V planes should be 2D arrays with dtype `uint8', but plane %d has %" PY_FORMAT_SIZE_T "d dimensions and dtype == `%s'", k, planes[k]->ndim, PyBlitzArray_TypenumAsString(planes[k]->type_num));
+        return 0;
+      }
+    }
+    self->v->append(*PyBlitzArrayCxx_AsBlitz<uint8_t,2>(y),
+        *PyBlitzArrayCxx_AsBlitz<uint8_t,2>(u),
+        *PyBlitzArrayCxx_AsBlitz<uint8_t,2>(v));
+    if (PyErr_Occurred()) return 0; ///< raised by a file-like target
+    Py_RETURN_NONE;
+  }
+
   PyBlitzArrayObject* frame = 0;
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "O&", kwlist, &PyBlitzArray_BehavedConverter, &frame)) return 0;
+  // arrays are taken as they are, the writer copies them only if needed
+  if (!PyBlitzArray_Converter(input, &frame)) return 0;
   auto frame_ = make_safe(frame);
 
-  if (frame->ndim != 3 && frame->ndim != 4) {
-    PyErr_Format(PyExc_ValueError, "input array should have 3 or 4 dimensions, but you passed an array with %" PY_FORMAT_SIZE_T "d dimensions", frame->ndim);
+  if (frame->ndim < 2 || frame->ndim > 4) {
+    PyErr_Format(PyExc_ValueError, "input array should have 2, 3 or 4 dimensions, but you passed an array with %" PY_FORMAT_SIZE_T "d dimensions", frame->ndim);
     return 0;
   }
 
@@ -423,12 +822,16 @@ BOB_TRY
     return 0;
   }
 
-  if (frame->ndim == 3) {
+  if (frame->ndim == 2) {
+    self->v->append(*PyBlitzArrayCxx_AsBlitz<uint8_t,2>(frame));
+  }
+  else if (frame->ndim == 3) {
     self->v->append(*PyBlitzArrayCxx_AsBlitz<uint8_t,3>(frame));
   }
   else {
     self->v->append(*PyBlitzArrayCxx_AsBlitz<uint8_t,4>(frame));
   }
+  if (PyErr_Occurred()) return 0; ///< raised by a file-like target
   Py_RETURN_NONE;
 BOB_CATCH_MEMBER("append", 0)
 }
@@ -437,14 +840,24 @@ BOB_CATCH_MEMBER("append", 0)
 static auto s_close = bob::extension::FunctionDoc(
   "close",
   "Closes the current video stream and forces writing the trailer.",
-  "After this point the video is finalized and cannot be written to anymore.",
+  "After this point the video is finalized and cannot be written to anymore. "
+  "Writers created with ``None`` as target return the video, which was kept in memory.",
   true
 )
-.add_prototype("")
+.add_prototype("", "data")
+.add_return("data", "bytes or None", "The video written, for writers that kept it in memory, ``None`` otherwise")
 ;
 static PyObject* PyBobIoVideoWriter_Close(PyBobIoVideoWriterObject* self) {
 BOB_TRY
   self->v->close();
+  if (PyErr_Occurred()) return 0; ///< raised while writing the trailer
+  if (self->memory) {
+    const std::vector<uint8_t>& data = self->memory->data();
+    PyObject* retval = PyBytes_FromStringAndSize(
+        reinterpret_cast<const char*>(data.data()), data.size());
+    self->memory.reset(); ///< returned once
+    return retval;
+  }
   Py_RETURN_NONE;
 BOB_CATCH_MEMBER("close", 0)
 }
@@ -67,6 +67,15 @@ setup(
       Extension("bob.io.video._library",
         [
           "bob/io/video/cpp/utils.cpp",
+          "bob/io/video/cpp/mapped_file.cpp",
+          "bob/io/video/cpp/input_stream.cpp",
+          "bob/io/video/cpp/output_stream.cpp",
+          "bob/io/video/cpp/frame_cache.cpp",
+          "bob/io/video/cpp/frame_index.cpp",
+          "bob/io/video/cpp/probe.cpp",
+          "bob/io/video/cpp/scanner.cpp",
+          "bob/io/video/cpp/trim.cpp",
+          "bob/io/video/cpp/convert.cpp",
           "bob/io/video/cpp/reader.cpp",
           "bob/io/video/cpp/writer.cpp",
           "bob/io/video/bobskin.cpp",
@@ -76,10 +85,12 @@ setup(
           "bob/io/video/main.cpp",
         ],
         packages = packages,
-        boost_modules = ['system'],
+        boost_modules = ['system', 'filesystem'],
         bob_packages = bob_packages,
         version = version,
         define_macros = define_macros,
+        extra_compile_args = ['-pthread'],
+        extra_link_args = ['-pthread'],
       ),
     ],
 
@@ -90,6 +101,8 @@ setup(
     entry_points={
       'console_scripts': [
         'bob_video_test.py = bob.io.video.script.video_test:main',
+        'bob_video_scan.py = bob.io.video.script.video_scan:main',
+        'bob_video_trim.py = bob.io.video.script.video_trim:main',
       ],
     },
 